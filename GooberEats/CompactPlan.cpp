@@ -0,0 +1,236 @@
+#include "provided.h"
+#include "CompactPlan.h"
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+using namespace std;
+
+// Words for every heading and turn, in the order of their enums
+const char* const HEADING_NAMES[] = { "east", "northeast", "north", "northwest", "west", "southwest", "south", "southeast" };
+const char* const TURN_NAMES[] = { "left", "right" };
+
+const char* headingName(Heading heading)
+{
+    return HEADING_NAMES[static_cast<int>(heading)];
+}
+
+const char* turnName(Turn turn)
+{
+    return TURN_NAMES[static_cast<int>(turn)];
+}
+
+//******************** CompactPlan functions **********************************
+
+CompactPlan::CompactPlan()
+{
+}
+
+void CompactPlan::clear()
+{
+    m_commands.clear();
+    m_text.clear();
+    m_textIds.clear();
+}
+
+void CompactPlan::addProceed(Heading heading, const string& streetName, float miles)
+{
+    CompactCommand command;
+    command.type = CompactCommand::PROCEED;
+    command.heading = heading;
+    command.turn = Turn::LEFT;
+    command.text = intern(streetName);
+    command.miles = miles;
+    m_commands.push_back(command);
+}
+
+void CompactPlan::addTurn(Turn turn, const string& streetName)
+{
+    CompactCommand command;
+    command.type = CompactCommand::TURN;
+    command.heading = Heading::EAST;
+    command.turn = turn;
+    command.text = intern(streetName);
+    command.miles = 0;
+    m_commands.push_back(command);
+}
+
+void CompactPlan::addDeliver(const string& item)
+{
+    CompactCommand command;
+    command.type = CompactCommand::DELIVER;
+    command.heading = Heading::EAST;
+    command.turn = Turn::LEFT;
+    command.text = intern(item);
+    command.miles = 0;
+    m_commands.push_back(command);
+}
+
+void CompactPlan::increaseDistance(float byThisMuch)
+{
+    m_commands.back().miles += byThisMuch;
+}
+
+size_t CompactPlan::size() const
+{
+    return m_commands.size();
+}
+
+const CompactCommand& CompactPlan::operator[](size_t i) const
+{
+    return m_commands[i];
+}
+
+const string& CompactPlan::text(int id) const
+{
+    return m_text[id];
+}
+
+int CompactPlan::numTexts() const
+{
+    return static_cast<int>(m_text.size());
+}
+
+/*
+ Renders a single command through a small writer of its own.
+ */
+string CompactPlan::description(size_t i) const
+{
+    ostringstream oss;
+    {
+        PlanTextWriter writer(oss, 256);
+        writer.writeCommand(*this, i);
+    }
+    return oss.str();
+}
+
+/*
+ Appends the DeliveryCommand for every command in the plan.
+ */
+void CompactPlan::toDeliveryCommands(vector<DeliveryCommand>& commands) const
+{
+    commands.reserve(commands.size() + m_commands.size());
+    for (auto it = m_commands.begin(); it != m_commands.end(); ++it)
+    {
+        DeliveryCommand command;
+        switch (it->type)
+        {
+          case CompactCommand::PROCEED:
+            command.initAsProceedCommand(headingName(it->heading), m_text[it->text], it->miles);
+            break;
+          case CompactCommand::TURN:
+            command.initAsTurnCommand(turnName(it->turn), m_text[it->text]);
+            break;
+          case CompactCommand::DELIVER:
+            command.initAsDeliverCommand(m_text[it->text]);
+            break;
+        }
+        commands.push_back(command);
+    }
+}
+
+/*
+ Returns the id of a string in the plan's table, adding it if it isn't there yet.
+ */
+int CompactPlan::intern(const string& s)
+{
+    auto found = m_textIds.find(s);
+    if (found != m_textIds.end())
+        return found->second;
+    int id = static_cast<int>(m_text.size());
+    m_text.push_back(s);
+    m_textIds[s] = id;
+    return id;
+}
+
+//******************** PlanTextWriter functions *******************************
+
+PlanTextWriter::PlanTextWriter(ostream& out, size_t capacity)
+    : m_out(out), m_buffer(capacity > 0 ? capacity : 1), m_used(0)
+{
+}
+
+/*
+ Destructor for PlanTextWriter; anything still in the buffer is written out.
+ */
+PlanTextWriter::~PlanTextWriter()
+{
+    flush();
+}
+
+/*
+ Formats a command the same way DeliveryCommand::description() does, piece by piece, straight into the buffer.
+ */
+void PlanTextWriter::writeCommand(const CompactPlan& plan, size_t i)
+{
+    const CompactCommand& command = plan[i];
+    const string& text = plan.text(command.text);
+    switch (command.type)
+    {
+      case CompactCommand::TURN:
+        append("Turn ", 5);
+        append(turnName(command.turn), strlen(turnName(command.turn)));
+        append(" on ", 4);
+        append(text.data(), text.size());
+        break;
+      case CompactCommand::PROCEED:
+      {
+        // the distance is printed with two decimal places, like DeliveryCommand's fixed-precision stream
+        char miles[32];
+        int length = snprintf(miles, sizeof(miles), "%.2f", static_cast<double>(command.miles));
+        append("Proceed ", 8);
+        append(headingName(command.heading), strlen(headingName(command.heading)));
+        append(" on ", 4);
+        append(text.data(), text.size());
+        append(" for ", 5);
+        append(miles, length);
+        append(" miles", 6);
+        break;
+      }
+      case CompactCommand::DELIVER:
+        append("DELIVER ", 8);
+        append(text.data(), text.size());
+        break;
+    }
+}
+
+void PlanTextWriter::writePlan(const CompactPlan& plan)
+{
+    for (size_t i = 0; i < plan.size(); ++i)
+    {
+        writeCommand(plan, i);
+        append("\n", 1);
+    }
+}
+
+void PlanTextWriter::writeText(const string& text)
+{
+    append(text.data(), text.size());
+}
+
+void PlanTextWriter::flush()
+{
+    if (m_used > 0)
+        m_out.write(m_buffer.data(), m_used);
+    m_used = 0;
+}
+
+/*
+ Copies text into the buffer, writing the buffer out first if the text doesn't fit. Text longer than the whole buffer
+ is written to the stream directly.
+ */
+void PlanTextWriter::append(const char* text, size_t length)
+{
+    if (m_used + length > m_buffer.size())
+    {
+        flush();
+        if (length > m_buffer.size())
+        {
+            m_out.write(text, length);
+            return;
+        }
+    }
+    memcpy(m_buffer.data() + m_used, text, length);
+    m_used += length;
+}
@@ -0,0 +1,140 @@
+#ifndef CompactPlan_h
+#define CompactPlan_h
+
+#include "provided.h"
+#include "DepotRouteCache.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <ostream>
+
+// CompactPlan.h
+
+// A delivery plan that holds no text of its own until it's asked for. Directions are enums, street names and items are
+// ids into a table that stores every distinct string once, and distances are floats. Text is produced on demand,
+// either one command at a time or by a PlanTextWriter, which formats every command into a single reusable buffer.
+
+enum class Heading : unsigned char { EAST, NORTHEAST, NORTH, NORTHWEST, WEST, SOUTHWEST, SOUTH, SOUTHEAST };
+enum class Turn : unsigned char { LEFT, RIGHT };
+
+  // The words DeliveryCommand uses for a heading ("northeast") or a turn ("left").
+const char* headingName(Heading heading);
+const char* turnName(Turn turn);
+
+struct CompactCommand
+{
+    enum Type : unsigned char { PROCEED, TURN, DELIVER };
+    Type type;
+    Heading heading;    // direction to proceed in; only meaningful for proceed commands
+    Turn turn;          // direction to turn; only meaningful for turn commands
+    int text;           // id of the street name (proceed and turn commands) or of the item (deliver commands)
+    float miles;        // distance to proceed; 0 for other commands
+};
+
+class CompactPlan
+{
+public:
+    CompactPlan();
+
+    void clear();
+
+      // Append commands to the plan; their text is added to the plan's table if it isn't there already.
+    void addProceed(Heading heading, const std::string& streetName, float miles);
+    void addTurn(Turn turn, const std::string& streetName);
+    void addDeliver(const std::string& item);
+
+      // Lengthens the last command, which must be a proceed command.
+    void increaseDistance(float byThisMuch);
+
+    size_t size() const;
+    const CompactCommand& operator[](size_t i) const;
+    const std::string& text(int id) const;
+    int numTexts() const;
+
+      // Renders a single command exactly like the equivalent DeliveryCommand's description().
+    std::string description(size_t i) const;
+
+      // Appends the equivalent DeliveryCommands, for code that still wants them.
+    void toDeliveryCommands(std::vector<DeliveryCommand>& commands) const;
+
+private:
+    std::vector<CompactCommand> m_commands;
+    std::vector<std::string> m_text;
+    std::unordered_map<std::string, int> m_textIds;
+
+    int intern(const std::string& s);
+};
+
+class PlanTextWriter
+{
+public:
+    PlanTextWriter(std::ostream& out, size_t capacity = 64 * 1024);
+    ~PlanTextWriter();
+
+      // Formats a command (without a newline), every command of a plan (one per line), or arbitrary text into the
+      // buffer; the buffer is only written to the stream when it fills up or is flushed.
+    void writeCommand(const CompactPlan& plan, size_t i);
+    void writePlan(const CompactPlan& plan);
+    void writeText(const std::string& text);
+
+    void flush();
+
+      // We prevent a PlanTextWriter object from being copied or assigned.
+    PlanTextWriter(const PlanTextWriter&) = delete;
+    PlanTextWriter& operator=(const PlanTextWriter&) = delete;
+private:
+    std::ostream& m_out;
+    std::vector<char> m_buffer;
+    size_t m_used;
+
+    void append(const char* text, size_t length);
+};
+
+class DeliveryPlannerImpl;
+class PlanStreamWriter;
+struct TurnCosts;
+struct TurnRestriction;
+
+class CompactDeliveryPlanner
+{
+public:
+    CompactDeliveryPlanner(const StreetMap* sm);
+
+      // Makes a planner that routes every leg with a TurnAwareRouter (see TurnAwareRouter.h) instead.
+    CompactDeliveryPlanner(const StreetMap* sm,
+                           const TurnCosts& turnCosts,
+                           const std::vector<TurnRestriction>& restrictions);
+    ~CompactDeliveryPlanner();
+
+      // Plans a route exactly like DeliveryPlanner does, storing the commands in plan (which is cleared first).
+    DeliveryResult generateDeliveryPlan(
+        const GeoCoord& depot,
+        const std::vector<DeliveryRequest>& deliveries,
+        CompactPlan& plan,
+        double& totalDistanceTravelled) const;
+
+      // Same as above, also handing every leg to writer as soon as it's routed. The caller begins and ends the
+      // writer's plan.
+    DeliveryResult generateDeliveryPlan(
+        const GeoCoord& depot,
+        const std::vector<DeliveryRequest>& deliveries,
+        CompactPlan& plan,
+        double& totalDistanceTravelled,
+        PlanStreamWriter& writer) const;
+
+      // Caches shortest-path trees for the depots of the plans made from now on, using at most maxBytes for them (see
+      // DepotRouteCache.h), so legs that leave or return to a depot aren't searched for again. Legs routed with turn
+      // costs aren't cached. Call this before planning starts on any thread.
+    void cacheDepotRoutes(size_t maxBytes = DEFAULT_DEPOT_CACHE_BYTES);
+
+      // Returns how the depot cache has done so far; every count is 0 if there's no cache.
+    DepotCacheStats depotCacheStats() const;
+
+      // We prevent a CompactDeliveryPlanner object from being copied or assigned.
+    CompactDeliveryPlanner(const CompactDeliveryPlanner&) = delete;
+    CompactDeliveryPlanner& operator=(const CompactDeliveryPlanner&) = delete;
+private:
+    DeliveryPlannerImpl* m_impl;
+};
+
+#endif /* CompactPlan_h */
@@ -0,0 +1,318 @@
+#include "provided.h"
+#include "DeliveryLoader.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+using namespace std;
+
+// Most digits a number can have and still be converted exactly by hand; longer ones are left to strtod
+const int MAX_EXACT_DIGITS = 15;
+// Powers of ten that doubles represent exactly, indexed by exponent
+const double POWERS_OF_TEN[MAX_EXACT_DIGITS + 1] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+                                                     1e13, 1e14, 1e15 };
+
+// Descriptions of problems, in the order of DeliveryProblem
+const char* const PROBLEM_DESCRIPTIONS[] = { "Missing colon", "Bad format", "Missing item", "Coordinate not on map" };
+
+const char* problemDescription(DeliveryProblem problem)
+{
+    return PROBLEM_DESCRIPTIONS[static_cast<int>(problem)];
+}
+
+/*
+ Read-only view of a whole file. Regular files are memory-mapped; anything that can't be mapped (a pipe, say) is read
+ into memory instead.
+ */
+class MappedFile
+{
+public:
+    MappedFile(const string& path)
+     : m_data(nullptr), m_size(0), m_mapped(false), m_open(false)
+    {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat info;
+        if (fstat(fd, &info) == 0  &&  S_ISREG(info.st_mode))
+        {
+            m_size = static_cast<size_t>(info.st_size);
+            m_open = true;
+            if (m_size > 0)
+            {
+                void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (data != MAP_FAILED)
+                {
+                    // the file is scanned once from front to back
+                    madvise(data, m_size, MADV_SEQUENTIAL);
+                    m_data = static_cast<const char*>(data);
+                    m_mapped = true;
+                }
+                else
+                    m_open = false;
+            }
+        }
+        if (!m_mapped  &&  !m_open)
+        {
+            char buffer[64 * 1024];
+            ssize_t n;
+            while ((n = read(fd, buffer, sizeof(buffer))) > 0)
+                m_contents.append(buffer, n);
+            m_open = n == 0;
+            m_data = m_contents.data();
+            m_size = m_contents.size();
+        }
+        close(fd);
+    }
+    
+    ~MappedFile()
+    {
+        if (m_mapped)
+            munmap(const_cast<char*>(m_data), m_size);
+    }
+    
+    bool isOpen() const { return m_open; }
+    const char* begin() const { return m_data; }
+    const char* end() const { return m_data + m_size; }
+    
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+private:
+    const char* m_data;
+    size_t m_size;
+    bool m_mapped;
+    bool m_open;
+    string m_contents;
+};
+
+/*
+ Converts the text from begin to end, which must be an optionally signed decimal number (e.g. "-118.4470263"), to
+ value; returns false if the text isn't one. Numbers with few enough digits are exactly a whole number divided by a
+ power of ten, so one division gives the same correctly rounded result strtod would.
+ */
+bool scanNumber(const char* begin, const char* end, double& value)
+{
+    const char* p = begin;
+    bool negative = p < end  &&  *p == '-';
+    if (p < end  &&  (*p == '-'  ||  *p == '+'))
+        ++p;
+    unsigned long long digits = 0;
+    int numDigits = 0;
+    int numFractionDigits = 0;
+    bool sawPoint = false;
+    for (; p < end; ++p)
+    {
+        if (*p >= '0'  &&  *p <= '9')
+        {
+            if (numDigits <= MAX_EXACT_DIGITS)
+                digits = digits * 10 + (*p - '0');
+            ++numDigits;
+            if (sawPoint)
+                ++numFractionDigits;
+        }
+        else if (*p == '.'  &&  !sawPoint)
+            sawPoint = true;
+        else
+            return false;
+    }
+    if (numDigits == 0)
+        return false;
+    if (numDigits <= MAX_EXACT_DIGITS)
+        value = (negative ? -1.0 : 1.0) * (static_cast<double>(digits) / POWERS_OF_TEN[numFractionDigits]);
+    else
+        value = strtod(string(begin, end).c_str(), nullptr);
+    return true;
+}
+
+/*
+ Finds the next whitespace-separated field between p and end, moving p past it; returns false if there isn't one.
+ */
+bool nextField(const char*& p, const char* end, const char*& fieldBegin, const char*& fieldEnd)
+{
+    while (p < end  &&  (*p == ' '  ||  *p == '\t'))
+        ++p;
+    fieldBegin = p;
+    while (p < end  &&  *p != ' '  &&  *p != '\t')
+        ++p;
+    fieldEnd = p;
+    return fieldBegin < fieldEnd;
+}
+
+/*
+ Parses the first two fields between begin and end as a latitude and longitude; returns false if they aren't numbers.
+ The coordinate is filled in directly so its text is never converted twice.
+ */
+bool parseCoordinate(const char* begin, const char* end, GeoCoord& coord)
+{
+    const char* p = begin;
+    const char* latBegin;
+    const char* latEnd;
+    const char* lonBegin;
+    const char* lonEnd;
+    if (!nextField(p, end, latBegin, latEnd)  ||  !nextField(p, end, lonBegin, lonEnd))
+        return false;
+    if (!scanNumber(latBegin, latEnd, coord.latitude)  ||  !scanNumber(lonBegin, lonEnd, coord.longitude))
+        return false;
+    coord.latitudeText.assign(latBegin, latEnd);
+    coord.longitudeText.assign(lonBegin, lonEnd);
+    return true;
+}
+
+/*
+ Definition of DeliveryLoaderImpl.
+ */
+class DeliveryLoaderImpl
+{
+public:
+    DeliveryLoaderImpl(const StreetMap* sm);
+    ~DeliveryLoaderImpl();
+    bool load(string deliveriesFile, GeoCoord& depot, vector<DeliveryRequest>& deliveries,
+              vector<DeliveryFileError>& errors) const;
+private:
+    const StreetMap* STREET_MAP;
+    
+    // where a kept line came from, so a bad coordinate can be reported with its line
+    struct LineSpan
+    {
+        int line;
+        const char* begin;
+        const char* end;
+    };
+    
+    void checkCoordinates(const GeoCoord& depot, const LineSpan& depotLine, const vector<DeliveryRequest>& deliveries,
+                          const vector<LineSpan>& deliveryLines, vector<DeliveryFileError>& errors) const;
+};
+
+DeliveryLoaderImpl::DeliveryLoaderImpl(const StreetMap* sm)
+ : STREET_MAP(sm)
+{
+}
+
+DeliveryLoaderImpl::~DeliveryLoaderImpl()
+{
+}
+
+bool DeliveryLoaderImpl::load(string deliveriesFile, GeoCoord& depot, vector<DeliveryRequest>& deliveries,
+                              vector<DeliveryFileError>& errors) const
+{
+    MappedFile file(deliveriesFile);
+    if (!file.isOpen())
+        return false;
+    
+    vector<LineSpan> deliveryLines;
+    LineSpan depotLine = { 0, file.begin(), file.begin() };
+    int line = 0;
+    for (const char* p = file.begin(); p < file.end(); )
+    {
+        // find the end of the line, leaving out its newline and any carriage return before it
+        const char* newline = static_cast<const char*>(memchr(p, '\n', file.end() - p));
+        const char* lineBegin = p;
+        const char* lineEnd = newline != nullptr ? newline : file.end();
+        p = newline != nullptr ? newline + 1 : file.end();
+        if (lineEnd > lineBegin  &&  lineEnd[-1] == '\r')
+            --lineEnd;
+        ++line;
+        
+        // the first line is the depot's coordinate
+        if (line == 1)
+        {
+            depotLine = { line, lineBegin, lineEnd };
+            if (!parseCoordinate(lineBegin, lineEnd, depot))
+            {
+                errors.push_back({ line, DeliveryProblem::BAD_FORMAT, string(lineBegin, lineEnd) });
+                return false;
+            }
+            continue;
+        }
+        
+        // blank lines (such as one at the very end) aren't deliveries
+        if (lineEnd == lineBegin)
+            continue;
+        
+        // every other line is "latitude longitude:item"
+        const char* colon = static_cast<const char*>(memchr(lineBegin, ':', lineEnd - lineBegin));
+        DeliveryRequest delivery("", GeoCoord());
+        if (colon == nullptr)
+            errors.push_back({ line, DeliveryProblem::MISSING_COLON, string(lineBegin, lineEnd) });
+        else if (!parseCoordinate(lineBegin, colon, delivery.location))
+            errors.push_back({ line, DeliveryProblem::BAD_FORMAT, string(lineBegin, lineEnd) });
+        else if (colon + 1 == lineEnd)
+            errors.push_back({ line, DeliveryProblem::MISSING_ITEM, string(lineBegin, lineEnd) });
+        else
+        {
+            delivery.item.assign(colon + 1, lineEnd);
+            deliveries.push_back(std::move(delivery));
+            deliveryLines.push_back({ line, lineBegin, lineEnd });
+        }
+    }
+    if (line == 0)
+    {
+        errors.push_back({ 1, DeliveryProblem::BAD_FORMAT, "" });
+        return false;
+    }
+    
+    // the lines are still mapped, so bad coordinates can be reported with their text
+    if (STREET_MAP != nullptr)
+        checkCoordinates(depot, depotLine, deliveries, deliveryLines, errors);
+    return true;
+}
+
+/*
+ Looks up every distinct coordinate of the depot and deliveries in the map exactly once, however many lines share it,
+ and adds an error for every line whose coordinate isn't on the map. Errors end up sorted by line.
+ */
+void DeliveryLoaderImpl::checkCoordinates(const GeoCoord& depot, const LineSpan& depotLine,
+                                          const vector<DeliveryRequest>& deliveries,
+                                          const vector<LineSpan>& deliveryLines,
+                                          vector<DeliveryFileError>& errors) const
+{
+    unordered_map<string, bool> onMap;
+    vector<StreetSegment> segments;
+    string key;
+    size_t numParseErrors = errors.size();
+    for (size_t i = 0; i <= deliveries.size(); ++i)
+    {
+        // the depot is checked first, then every delivery
+        const GeoCoord& coord = i == 0 ? depot : deliveries[i - 1].location;
+        const LineSpan& span = i == 0 ? depotLine : deliveryLines[i - 1];
+        key.assign(coord.latitudeText);
+        key += ' ';
+        key += coord.longitudeText;
+        auto found = onMap.find(key);
+        if (found == onMap.end())
+            found = onMap.emplace(key, STREET_MAP->getSegmentsThatStartWith(coord, segments)).first;
+        if (!found->second)
+            errors.push_back({ span.line, DeliveryProblem::BAD_COORD, string(span.begin, span.end) });
+    }
+    
+    // parse errors and coordinate errors are each in line order, so one merge puts them all in order
+    if (numParseErrors > 0  &&  errors.size() > numParseErrors)
+        inplace_merge(errors.begin(), errors.begin() + numParseErrors, errors.end(),
+                      [](const DeliveryFileError& a, const DeliveryFileError& b) { return a.line < b.line; });
+}
+
+//******************** DeliveryLoader functions ********************************
+
+// These functions simply delegate to DeliveryLoaderImpl's functions.
+
+DeliveryLoader::DeliveryLoader(const StreetMap* sm)
+{
+    m_impl = new DeliveryLoaderImpl(sm);
+}
+
+DeliveryLoader::~DeliveryLoader()
+{
+    delete m_impl;
+}
+
+bool DeliveryLoader::load(string deliveriesFile, GeoCoord& depot, vector<DeliveryRequest>& deliveries,
+                          vector<DeliveryFileError>& errors) const
+{
+    return m_impl->load(deliveriesFile, depot, deliveries, errors);
+}
@@ -0,0 +1,48 @@
+#ifndef DeliveryLoader_h
+#define DeliveryLoader_h
+
+#include "provided.h"
+#include <string>
+#include <vector>
+
+// DeliveryLoader.h
+
+// Loads deliveries files fast enough for batches with millions of lines. The file is memory-mapped and scanned in
+// place, and every problem is collected with its line number instead of being printed, so callers decide how to
+// report them. Once a file is parsed, every distinct coordinate in it is looked up in the map in one pass, so a file
+// with a location that isn't on the map is rejected before any routing starts.
+
+enum class DeliveryProblem { MISSING_COLON, BAD_FORMAT, MISSING_ITEM, BAD_COORD };
+
+  // Returns a short description of a problem, e.g. "Missing colon".
+const char* problemDescription(DeliveryProblem problem);
+
+struct DeliveryFileError
+{
+    int line;                   // line number in the file, starting at 1 (the depot's line)
+    DeliveryProblem problem;
+    std::string text;           // the whole line
+};
+
+class DeliveryLoaderImpl;
+
+class DeliveryLoader
+{
+public:
+    DeliveryLoader(const StreetMap* sm);
+    ~DeliveryLoader();
+
+      // Reads the depot and deliveries in a deliveries file. Lines that can't be parsed are left out of deliveries,
+      // and coordinates that aren't on the map are kept; both are added to errors in line order. Returns false if the
+      // file couldn't be read or its depot line couldn't be parsed.
+    bool load(std::string deliveriesFile, GeoCoord& depot, std::vector<DeliveryRequest>& deliveries,
+              std::vector<DeliveryFileError>& errors) const;
+
+      // We prevent a DeliveryLoader object from being copied or assigned.
+    DeliveryLoader(const DeliveryLoader&) = delete;
+    DeliveryLoader& operator=(const DeliveryLoader&) = delete;
+private:
+    DeliveryLoaderImpl* m_impl;
+};
+
+#endif /* DeliveryLoader_h */
@@ -1,10 +1,171 @@
 #include "provided.h"
+#include "TimedDelivery.h"
+#include "TourSolvers.h"
+#include "Trace.h"
 #include <vector>
 #include <algorithm>
 #include <random>
 #include <utility>
+#include <limits>
+#include <bitset>
+#include <thread>
 using namespace std;
 
+// Largest batch that is solved exactly with Held-Karp dynamic programming; its table grows as 2^n * n floats
+const int MAX_HELD_KARP_DELIVERIES = 15;
+// Largest batch that branch and bound searches exactly, starting from the annealer's best order
+const int MAX_BRANCH_AND_BOUND_DELIVERIES = 24;
+// Most partial tours branch and bound expands before settling for the best tour it has found
+const long MAX_BRANCH_AND_BOUND_NODES = 2000000;
+// Fewest subsets of a Held-Karp layer that are worth handing to a thread of their own
+const size_t MIN_SUBSETS_PER_THREAD = 1024;
+// Smallest difference in crow distance (in miles) that branch and bound counts as an improvement
+const float EXACT_EPSILON = 1e-5f;
+
+// Largest number of improving moves the time-window local search makes before settling on its current order
+const int MAX_TIMED_MOVES = 10000;
+// Longest run of consecutive deliveries that the time-window local search moves as a block
+const int MAX_MOVED_SEGMENT = 3;
+// Smallest difference in minutes or miles that the time-window local search counts as an improvement
+const double TIMED_EPSILON = 1e-9;
+
+/*
+ Returns whether a tour with the first lateness and distance is better than one with the second; lateness comes first.
+ */
+inline
+bool isBetterTimedTour(double warp, double miles, double otherWarp, double otherMiles)
+{
+    if (warp < otherWarp - TIMED_EPSILON)
+        return true;
+    return warp <= otherWarp + TIMED_EPSILON  &&  miles < otherMiles - TIMED_EPSILON;
+}
+
+/*
+ Depth-first branch and bound over the order of deliveries. Node 0 of the distance matrix is the depot and nodes 1 to n
+ are the deliveries. Every partial tour is bounded with the path version of a 1-tree: a minimum spanning tree of the
+ unvisited deliveries plus the cheapest edges joining it to the tour's current end and to the depot.
+ */
+struct BranchAndBound
+{
+    // distance matrix, its width, and the number of deliveries
+    const vector<float>& m_miles;
+    const int m_stride;
+    const int m_numDeliveries;
+    // the partial tour being extended and which nodes are on it
+    vector<int> m_path;
+    vector<char> m_visited;
+    // best complete tour found so far (delivery nodes only) and its length
+    vector<int> m_bestPath;
+    float m_bestLength;
+    // number of partial tours expanded so far
+    long m_expansions;
+    // scratch space reused by every expansion: the children of each depth of the search, and the unvisited
+    // deliveries with their Prim keys and tree flags for the lower bound
+    vector<vector<pair<float, int>>> m_children;
+    vector<int> m_unvisited;
+    vector<float> m_key;
+    vector<char> m_inTree;
+    
+    BranchAndBound(const vector<float>& miles, int numDeliveries, float initialLength)
+        : m_miles(miles), m_stride(numDeliveries + 1), m_numDeliveries(numDeliveries),
+          m_visited(numDeliveries + 1, false), m_bestLength(initialLength), m_expansions(0),
+          m_children(numDeliveries), m_key(numDeliveries), m_inTree(numDeliveries)
+    {
+        m_visited[0] = true;
+        m_path.reserve(numDeliveries);
+        m_unvisited.reserve(numDeliveries);
+        for (auto it = m_children.begin(); it != m_children.end(); ++it)
+            it->reserve(numDeliveries);
+    }
+    
+    float miles(int a, int b) const
+    {
+        return m_miles[a * m_stride + b];
+    }
+    
+    /// Extends the partial tour ending at node current, which is length miles long, in every promising way.
+    void search(int current, float length)
+    {
+        if (++m_expansions > MAX_BRANCH_AND_BOUND_NODES)
+            return;
+        
+        // a complete tour only has to return to the depot
+        if (static_cast<int>(m_path.size()) == m_numDeliveries)
+        {
+            float total = length + miles(current, 0);
+            if (total < m_bestLength - EXACT_EPSILON)
+            {
+                m_bestLength = total;
+                m_bestPath = m_path;
+            }
+            return;
+        }
+        
+        // give up on tours that can't beat the best one
+        if (length + lowerBound(current) >= m_bestLength - EXACT_EPSILON)
+            return;
+        
+        // try the closest deliveries first so that good tours are found early; deeper calls use the later buffers
+        vector<pair<float, int>>& children = m_children[m_path.size()];
+        children.clear();
+        for (int next = 1; next <= m_numDeliveries; ++next)
+            if (!m_visited[next])
+                children.push_back(make_pair(miles(current, next), next));
+        sort(children.begin(), children.end());
+        for (auto it = children.begin(); it != children.end(); ++it)
+        {
+            m_visited[it->second] = true;
+            m_path.push_back(it->second);
+            search(it->second, length + it->first);
+            m_path.pop_back();
+            m_visited[it->second] = false;
+        }
+    }
+    
+    /// Returns a lower bound on the distance left to travel from node current, through every unvisited delivery,
+    /// to the depot.
+    float lowerBound(int current)
+    {
+        vector<int>& unvisited = m_unvisited;
+        unvisited.clear();
+        for (int node = 1; node <= m_numDeliveries; ++node)
+            if (!m_visited[node])
+                unvisited.push_back(node);
+        
+        // cheapest ways to join the unvisited deliveries to the current end of the tour and to the depot
+        float toCurrent = numeric_limits<float>::infinity();
+        float toDepot = numeric_limits<float>::infinity();
+        for (auto it = unvisited.begin(); it != unvisited.end(); ++it)
+        {
+            toCurrent = min(toCurrent, miles(current, *it));
+            toDepot = min(toDepot, miles(0, *it));
+        }
+        
+        // Prim's algorithm for the minimum spanning tree of the unvisited deliveries
+        const int SIZE = static_cast<int>(unvisited.size());
+        float* key = m_key.data();
+        char* inTree = m_inTree.data();
+        fill(key, key + SIZE, numeric_limits<float>::infinity());
+        fill(inTree, inTree + SIZE, 0);
+        float treeLength = 0;
+        key[0] = 0;
+        for (int added = 0; added < SIZE; ++added)
+        {
+            int closest = -1;
+            for (int k = 0; k < SIZE; ++k)
+                if (!inTree[k]  &&  (closest < 0  ||  key[k] < key[closest]))
+                    closest = k;
+            inTree[closest] = true;
+            treeLength += key[closest];
+            const float* row = &m_miles[unvisited[closest] * m_stride];
+            for (int k = 0; k < SIZE; ++k)
+                if (!inTree[k])
+                    key[k] = min(key[k], row[unvisited[k]]);
+        }
+        return treeLength + toCurrent + toDepot;
+    }
+};
+
 /*
  Definition of DeliveryOptimizerImpl; private members were added to spec's skeleton code.
  */
@@ -18,10 +179,35 @@ public:
         vector<DeliveryRequest>& deliveries,
         double& oldCrowDistance,
         double& newCrowDistance) const;
+    bool optimizeTimedDeliveryOrder(
+        const GeoCoord& depot,
+        double departureTime,
+        double milesPerHour,
+        vector<TimedDeliveryRequest>& deliveries,
+        double& oldCrowDistance,
+        double& newCrowDistance) const;
 private:
     const StreetMap* STREET_MAP;
     
     double getCrowDistance(const vector<DeliveryRequest>& deliveries, const GeoCoord& origin) const;
+    void getCrowMatrix(const GeoCoord& depot, const vector<DeliveryRequest>& deliveries, vector<float>& miles) const;
+    void reorder(vector<DeliveryRequest>& deliveries, const vector<int>& order) const;
+    void computeTimeWindowData(const vector<int>& tour,
+                               const vector<TimeWindowData>& stops,
+                               const vector<double>& miles,
+                               double minutesPerMile,
+                               vector<TimeWindowData>& prefix,
+                               vector<TimeWindowData>& suffix) const;
+    double getTourMiles(const vector<int>& tour, const vector<double>& miles) const;
+    void insertByDeadline(const vector<TimedDeliveryRequest>& deliveries,
+                          const vector<TimeWindowData>& stops,
+                          const vector<double>& miles,
+                          double minutesPerMile,
+                          vector<int>& tour) const;
+    void improveTimedTour(const vector<TimeWindowData>& stops,
+                          const vector<double>& miles,
+                          double minutesPerMile,
+                          vector<int>& tour) const;
 };
 
 /*
@@ -43,7 +229,8 @@ DeliveryOptimizerImpl::~DeliveryOptimizerImpl()
 
 /*
  Finds a closer-to-optimal solution to the TSP applied to the list of delivery locations through a modification
- of simulated annealing.
+ of simulated annealing. Small batches are solved exactly instead: the smallest with Held-Karp, and slightly larger
+ ones with branch and bound starting from the annealer's best order.
  */
 void DeliveryOptimizerImpl::optimizeDeliveryOrder(
     const GeoCoord& depot,
@@ -51,6 +238,8 @@ void DeliveryOptimizerImpl::optimizeDeliveryOrder(
     double& oldCrowDistance,
     double& newCrowDistance) const
 {
+    TraceScope trace("optimizeDeliveryOrder", "deliveries", deliveries.size());
+    
     // constants used multiple times in this function
     const double PCT_HEAT_RETAINED = 0.95;
     const int NUM_DELIVERIES = static_cast<int>(deliveries.size());
@@ -59,6 +248,21 @@ void DeliveryOptimizerImpl::optimizeDeliveryOrder(
     // store old distance-as-the-crow-flies between all locations
     oldCrowDistance = getCrowDistance(deliveries, depot);
     
+    // small batches are solved exactly, which is both faster and better than annealing them
+    if (NUM_DELIVERIES <= MAX_HELD_KARP_DELIVERIES)
+    {
+        vector<float> miles;
+        vector<int> order;
+        getCrowMatrix(depot, deliveries, miles);
+        solveHeldKarp(miles, NUM_DELIVERIES, order);
+        vector<DeliveryRequest> solved = deliveries;
+        reorder(solved, order);
+        if (getCrowDistance(solved, depot) < oldCrowDistance)
+            deliveries = solved;
+        newCrowDistance = getCrowDistance(deliveries, depot);
+        return;
+    }
+    
     // vectors that will be used to store states of the delivery request order
         // current: the vector representing the algorithm's current ordering of the deliveries,
             // will search away from local minimums during the loop
@@ -88,7 +292,8 @@ void DeliveryOptimizerImpl::optimizeDeliveryOrder(
     std::uniform_real_distribution<double> randZeroToOne(0, 1);
     
     // variables that keep track of our three vectors' distances (direct between coordinates in vector's order)
-    double currentDistance = oldCrowDistance;
+    // current was just shuffled, so its distance has to be recomputed; lowest still has the original order
+    double currentDistance = getCrowDistance(current, depot);
     double modifiedDistance; // will always been initialized before its use in later code
     double lowestDistance = oldCrowDistance;
     
@@ -131,6 +336,19 @@ void DeliveryOptimizerImpl::optimizeDeliveryOrder(
         }
     }
     
+    // if the batch is small enough, search for the best order exactly, using the annealer's best as the one to beat
+    if (NUM_DELIVERIES <= MAX_BRANCH_AND_BOUND_DELIVERIES)
+    {
+        vector<float> miles;
+        vector<int> order;
+        getCrowMatrix(depot, lowest, miles);
+        if (searchBranchAndBound(miles, NUM_DELIVERIES, order))
+        {
+            reorder(lowest, order);
+            lowestDistance = getCrowDistance(lowest, depot);
+        }
+    }
+    
     // if the lowest distance that we found is lower than the original distance, copy the best-found vector into the
         // deliveries vector argument
     if (lowestDistance < oldCrowDistance)
@@ -159,6 +377,434 @@ double DeliveryOptimizerImpl::getCrowDistance(const vector<DeliveryRequest>& del
     return distance;
 }
 
+/*
+ Fills miles with a matrix of crow distances between the depot (node 0) and every delivery (nodes 1 to n), stored
+ row by row as floats to keep the exact solvers' working set small.
+ */
+void DeliveryOptimizerImpl::getCrowMatrix(const GeoCoord& depot,
+                                          const vector<DeliveryRequest>& deliveries,
+                                          vector<float>& miles) const
+{
+    const int STRIDE = static_cast<int>(deliveries.size()) + 1;
+    miles.assign(STRIDE * STRIDE, 0);
+    for (int a = 0; a < STRIDE; ++a)
+    {
+        const GeoCoord& from = a == 0 ? depot : deliveries[a - 1].location;
+        for (int b = a + 1; b < STRIDE; ++b)
+            miles[a * STRIDE + b] = miles[b * STRIDE + a] =
+                static_cast<float>(distanceEarthMiles(from, deliveries[b - 1].location));
+    }
+}
+
+/*
+ Finds the shortest order of the deliveries with Held-Karp dynamic programming: the cheapest path from the depot
+ through every subset of deliveries, ending at each delivery in the subset, is built from the cheapest paths through
+ subsets with one fewer delivery. Subsets of the same size don't depend on each other, so each size is split between
+ threads. Passes back the order as indices into the deliveries.
+ */
+void solveHeldKarp(const vector<float>& miles, int numDeliveries, vector<int>& order)
+{
+    const int N = numDeliveries;
+    const int STRIDE = N + 1;
+    const unsigned int FULL = (1u << N) - 1;
+    const float UNREACHED = numeric_limits<float>::infinity();
+    order.clear();
+    if (N == 0)
+        return;
+    
+    // cost[subset * N + last] is the cheapest path from the depot through subset that ends at delivery last;
+        // costs of deliveries outside of the subset stay unreached, which lets the inner loop skip membership checks
+    vector<float> cost(static_cast<size_t>(FULL + 1) * N, UNREACHED);
+    for (int last = 0; last < N; ++last)
+        cost[(1u << last) * N + last] = miles[last + 1];
+    
+    // group the subsets into layers by their size
+    vector<vector<unsigned int>> layers(N + 1);
+    for (unsigned int subset = 1; subset <= FULL; ++subset)
+        layers[bitset<32>(subset).count()].push_back(subset);
+    
+    // fills in the costs of a range of subsets in a layer from the costs of the layer before it
+    auto relaxSubsets = [&](const vector<unsigned int>& layer, size_t begin, size_t end)
+    {
+        for (size_t k = begin; k < end; ++k)
+        {
+            unsigned int subset = layer[k];
+            for (int last = 0; last < N; ++last)
+            {
+                if (!(subset & (1u << last)))
+                    continue;
+                // the distance matrix is symmetric, so distances into last are read from its contiguous row
+                const float* previousCost = &cost[(subset ^ (1u << last)) * N];
+                const float* intoLast = &miles[(last + 1) * STRIDE + 1];
+                float best = UNREACHED;
+                for (int previous = 0; previous < N; ++previous)
+                    best = min(best, previousCost[previous] + intoLast[previous]);
+                cost[subset * N + last] = best;
+            }
+        }
+    };
+    const size_t NUM_THREADS = max(1u, thread::hardware_concurrency());
+    for (int size = 2; size <= N; ++size)
+    {
+        const vector<unsigned int>& layer = layers[size];
+        size_t numWorkers = min(NUM_THREADS, layer.size() / MIN_SUBSETS_PER_THREAD + 1);
+        size_t chunk = (layer.size() + numWorkers - 1) / numWorkers;
+        vector<thread> workers;
+        for (size_t w = 1; w < numWorkers; ++w)
+            workers.push_back(thread(relaxSubsets, cref(layer), w * chunk, min(layer.size(), (w + 1) * chunk)));
+        relaxSubsets(layer, 0, min(layer.size(), chunk));
+        for (auto it = workers.begin(); it != workers.end(); ++it)
+            it->join();
+    }
+    
+    // pick the best delivery to finish on, then walk backwards through the table to recover the order
+    int last = 0;
+    for (int candidate = 1; candidate < N; ++candidate)
+        if (cost[FULL * N + candidate] + miles[(candidate + 1) * STRIDE] < cost[FULL * N + last] + miles[(last + 1) * STRIDE])
+            last = candidate;
+    order.assign(N, 0);
+    unsigned int subset = FULL;
+    for (int position = N - 1; position >= 0; --position)
+    {
+        order[position] = last;
+        unsigned int previousSubset = subset ^ (1u << last);
+        if (previousSubset == 0)
+            break;
+        // the previous delivery is whichever one the best path to last came through
+        int previous = -1;
+        float bestCost = UNREACHED;
+        for (int candidate = 0; candidate < N; ++candidate)
+        {
+            float candidateCost = cost[previousSubset * N + candidate] + miles[(last + 1) * STRIDE + candidate + 1];
+            if (candidateCost < bestCost)
+            {
+                previous = candidate;
+                bestCost = candidateCost;
+            }
+        }
+        subset = previousSubset;
+        last = previous;
+    }
+}
+
+/*
+ Searches for an order shorter than the deliveries' current one with branch and bound. Returns whether one was found,
+ in which case its indices into the deliveries are passed back through order.
+ */
+bool searchBranchAndBound(const vector<float>& miles, int numDeliveries, vector<int>& order)
+{
+    // the current order is the one to beat
+    const int STRIDE = numDeliveries + 1;
+    float currentLength = miles[numDeliveries * STRIDE];
+    for (int node = 1; node <= numDeliveries; ++node)
+        currentLength += miles[(node - 1) * STRIDE + node];
+    
+    BranchAndBound search(miles, numDeliveries, currentLength);
+    search.search(0, 0);
+    if (search.m_bestPath.empty())
+        return false;
+    order.clear();
+    for (auto it = search.m_bestPath.begin(); it != search.m_bestPath.end(); ++it)
+        order.push_back(*it - 1);
+    return true;
+}
+
+/*
+ Rearranges deliveries into the order given by a list of their indices.
+ */
+void DeliveryOptimizerImpl::reorder(vector<DeliveryRequest>& deliveries, const vector<int>& order) const
+{
+    vector<DeliveryRequest> reordered;
+    reordered.reserve(order.size());
+    for (auto it = order.begin(); it != order.end(); ++it)
+        reordered.push_back(deliveries[*it]);
+    deliveries = reordered;
+}
+
+/*
+ Orders deliveries with time windows. Every stop's window is summarized with TimeWindowData, so that the lateness of a
+ changed order can be found by concatenating the summaries of the unchanged parts of the tour instead of re-simulating
+ it. An initial order is built by inserting deliveries by deadline and is then improved with 2-opt and or-opt moves,
+ preferring less lateness first and less distance second.
+ */
+bool DeliveryOptimizerImpl::optimizeTimedDeliveryOrder(
+    const GeoCoord& depot,
+    double departureTime,
+    double milesPerHour,
+    vector<TimedDeliveryRequest>& deliveries,
+    double& oldCrowDistance,
+    double& newCrowDistance) const
+{
+    TraceScope trace("optimizeTimedDeliveryOrder", "deliveries", deliveries.size());
+    
+    // node 0 is the depot at the start of the tour, nodes 1 to n are the deliveries, and node n + 1 is the depot again
+    const int NUM_DELIVERIES = static_cast<int>(deliveries.size());
+    const int NUM_NODES = NUM_DELIVERIES + 2;
+    const double MINUTES_PER_MILE = 60 / milesPerHour;
+    const double INFINITE_TIME = numeric_limits<double>::infinity();
+    
+    // build a matrix of crow distances between every pair of nodes
+    vector<const GeoCoord*> locations;
+    locations.push_back(&depot);
+    for (auto it = deliveries.begin(); it != deliveries.end(); ++it)
+        locations.push_back(&it->location);
+    locations.push_back(&depot);
+    vector<double> miles(NUM_NODES * NUM_NODES, 0);
+    for (int a = 0; a < NUM_NODES; ++a)
+        for (int b = a + 1; b < NUM_NODES; ++b)
+            miles[a * NUM_NODES + b] = miles[b * NUM_NODES + a] = distanceEarthMiles(*locations[a], *locations[b]);
+    
+    // the driver leaves the depot at the departure time and can get back to it whenever they're done
+    vector<TimeWindowData> stops(NUM_NODES);
+    stops[0] = TimeWindowData{0, 0, departureTime, departureTime};
+    for (int i = 1; i <= NUM_DELIVERIES; ++i)
+    {
+        const TimedDeliveryRequest& delivery = deliveries[i - 1];
+        stops[i] = TimeWindowData{delivery.serviceMinutes, 0, delivery.earliestArrival, delivery.latestArrival};
+    }
+    stops[NUM_NODES - 1] = TimeWindowData{0, 0, -INFINITE_TIME, INFINITE_TIME};
+    
+    // the original order is the one to beat
+    vector<TimeWindowData> prefix;
+    vector<TimeWindowData> suffix;
+    vector<int> original(NUM_NODES);
+    for (int i = 0; i < NUM_NODES; ++i)
+        original[i] = i;
+    computeTimeWindowData(original, stops, miles, MINUTES_PER_MILE, prefix, suffix);
+    double originalWarp = prefix.back().timeWarp;
+    oldCrowDistance = getTourMiles(original, miles);
+    
+    // build an order by deadline, improve it, and keep it only if it beats the original order
+    vector<int> tour;
+    insertByDeadline(deliveries, stops, miles, MINUTES_PER_MILE, tour);
+    improveTimedTour(stops, miles, MINUTES_PER_MILE, tour);
+    computeTimeWindowData(tour, stops, miles, MINUTES_PER_MILE, prefix, suffix);
+    double warp = prefix.back().timeWarp;
+    double tourMiles = getTourMiles(tour, miles);
+    if (isBetterTimedTour(warp, tourMiles, originalWarp, oldCrowDistance))
+    {
+        vector<TimedDeliveryRequest> ordered;
+        ordered.reserve(NUM_DELIVERIES);
+        for (int i = 1; i <= NUM_DELIVERIES; ++i)
+            ordered.push_back(deliveries[tour[i] - 1]);
+        deliveries = ordered;
+    }
+    else
+    {
+        warp = originalWarp;
+        tourMiles = oldCrowDistance;
+    }
+    
+    newCrowDistance = tourMiles;
+    return warp <= TIMED_EPSILON;
+}
+
+/*
+ Fills prefix and suffix with the time window data of every beginning and every ending of a tour of nodes; prefix[k]
+ summarizes the tour up to and including position k, and suffix[k] summarizes it from position k onward.
+ */
+void DeliveryOptimizerImpl::computeTimeWindowData(const vector<int>& tour,
+                                                  const vector<TimeWindowData>& stops,
+                                                  const vector<double>& miles,
+                                                  double minutesPerMile,
+                                                  vector<TimeWindowData>& prefix,
+                                                  vector<TimeWindowData>& suffix) const
+{
+    const int NUM_NODES = static_cast<int>(stops.size());
+    const int LENGTH = static_cast<int>(tour.size());
+    prefix.resize(LENGTH);
+    suffix.resize(LENGTH);
+    
+    // build the beginnings forwards and the endings backwards, one stop at a time
+    prefix[0] = stops[tour[0]];
+    for (int k = 1; k < LENGTH; ++k)
+        prefix[k] = concatenate(prefix[k - 1], miles[tour[k - 1] * NUM_NODES + tour[k]] * minutesPerMile, stops[tour[k]]);
+    suffix[LENGTH - 1] = stops[tour[LENGTH - 1]];
+    for (int k = LENGTH - 2; k >= 0; --k)
+        suffix[k] = concatenate(stops[tour[k]], miles[tour[k] * NUM_NODES + tour[k + 1]] * minutesPerMile, suffix[k + 1]);
+}
+
+/*
+ Returns the crow distance travelled along a tour of nodes.
+ */
+double DeliveryOptimizerImpl::getTourMiles(const vector<int>& tour, const vector<double>& miles) const
+{
+    // every node appears exactly once in a complete tour
+    const int NUM_NODES = static_cast<int>(tour.size());
+    double distance = 0;
+    for (int k = 1; k < static_cast<int>(tour.size()); ++k)
+        distance += miles[tour[k - 1] * NUM_NODES + tour[k]];
+    return distance;
+}
+
+/*
+ Builds a tour by taking deliveries in order of their deadlines and inserting each one wherever it adds the least
+ lateness, or the least distance when lateness is tied.
+ */
+void DeliveryOptimizerImpl::insertByDeadline(const vector<TimedDeliveryRequest>& deliveries,
+                                             const vector<TimeWindowData>& stops,
+                                             const vector<double>& miles,
+                                             double minutesPerMile,
+                                             vector<int>& tour) const
+{
+    const int NUM_NODES = static_cast<int>(stops.size());
+    
+    // sort the deliveries' nodes by deadline, breaking ties by when their windows open
+    vector<int> byDeadline;
+    for (int i = 1; i < NUM_NODES - 1; ++i)
+        byDeadline.push_back(i);
+    stable_sort(byDeadline.begin(), byDeadline.end(), [&deliveries](int lhs, int rhs)
+    {
+        const TimedDeliveryRequest& left = deliveries[lhs - 1];
+        const TimedDeliveryRequest& right = deliveries[rhs - 1];
+        if (left.latestArrival != right.latestArrival)
+            return left.latestArrival < right.latestArrival;
+        return left.earliestArrival < right.earliestArrival;
+    });
+    
+    // start with a tour that goes straight back to the depot
+    tour.clear();
+    tour.push_back(0);
+    tour.push_back(NUM_NODES - 1);
+    vector<TimeWindowData> prefix;
+    vector<TimeWindowData> suffix;
+    for (auto it = byDeadline.begin(); it != byDeadline.end(); ++it)
+    {
+        computeTimeWindowData(tour, stops, miles, minutesPerMile, prefix, suffix);
+        
+        // try every gap in the tour; each try is O(1) thanks to the prefix and suffix data
+        int bestGap = 1;
+        double bestWarp = 0;
+        double bestMiles = 0;
+        for (int gap = 1; gap < static_cast<int>(tour.size()); ++gap)
+        {
+            int before = tour[gap - 1];
+            int after = tour[gap];
+            double toStop = miles[before * NUM_NODES + *it];
+            double fromStop = miles[*it * NUM_NODES + after];
+            TimeWindowData result = concatenate(concatenate(prefix[gap - 1], toStop * minutesPerMile, stops[*it]),
+                                                fromStop * minutesPerMile,
+                                                suffix[gap]);
+            double addedMiles = toStop + fromStop - miles[before * NUM_NODES + after];
+            if (gap == 1  ||  isBetterTimedTour(result.timeWarp, addedMiles, bestWarp, bestMiles))
+            {
+                bestGap = gap;
+                bestWarp = result.timeWarp;
+                bestMiles = addedMiles;
+            }
+        }
+        tour.insert(tour.begin() + bestGap, *it);
+    }
+}
+
+/*
+ Improves a tour with 2-opt moves (reversing a stretch of the tour) and or-opt moves (moving up to MAX_MOVED_SEGMENT
+ consecutive deliveries elsewhere). While a move's position is scanned, the data of the part of the tour it jumps
+ over is grown one stop at a time, so every move is checked in O(1) amortized time.
+ */
+void DeliveryOptimizerImpl::improveTimedTour(const vector<TimeWindowData>& stops,
+                                             const vector<double>& miles,
+                                             double minutesPerMile,
+                                             vector<int>& tour) const
+{
+    const int NUM_NODES = static_cast<int>(stops.size());
+    const int LAST = static_cast<int>(tour.size()) - 1;
+    auto dist = [&](int a, int b)
+    {
+        return miles[tour[a] * NUM_NODES + tour[b]];
+    };
+    auto travel = [&](int a, int b)
+    {
+        return miles[tour[a] * NUM_NODES + tour[b]] * minutesPerMile;
+    };
+    auto stopAt = [&](int k) -> const TimeWindowData&
+    {
+        return stops[tour[k]];
+    };
+    
+    vector<TimeWindowData> prefix;
+    vector<TimeWindowData> suffix;
+    bool improved = true;
+    for (int moves = 0; improved  &&  moves < MAX_TIMED_MOVES; ++moves)
+    {
+        improved = false;
+        computeTimeWindowData(tour, stops, miles, minutesPerMile, prefix, suffix);
+        double currentWarp = prefix[LAST].timeWarp;
+        double currentMiles = getTourMiles(tour, miles);
+        
+        // 2-opt: reverse the deliveries from position i through position j
+        for (int i = 1; i < LAST - 1  &&  !improved; ++i)
+        {
+            TimeWindowData reversed = stopAt(i);
+            for (int j = i + 1; j < LAST; ++j)
+            {
+                reversed = concatenate(stopAt(j), travel(j, j - 1), reversed);
+                double newMiles = currentMiles + dist(i - 1, j) + dist(i, j + 1) - dist(i - 1, i) - dist(j, j + 1);
+                TimeWindowData result = concatenate(concatenate(prefix[i - 1], travel(i - 1, j), reversed),
+                                                    travel(i, j + 1),
+                                                    suffix[j + 1]);
+                if (isBetterTimedTour(result.timeWarp, newMiles, currentWarp, currentMiles))
+                {
+                    std::reverse(tour.begin() + i, tour.begin() + j + 1);
+                    improved = true;
+                    break;
+                }
+            }
+        }
+        
+        // or-opt: move the segment of deliveries from position i through i + length - 1
+        for (int length = 1; length <= MAX_MOVED_SEGMENT  &&  !improved; ++length)
+        {
+            for (int i = 1; i + length - 1 < LAST  &&  !improved; ++i)
+            {
+                const int END = i + length - 1;
+                TimeWindowData segment = stopAt(i);
+                for (int k = i + 1; k <= END; ++k)
+                    segment = concatenate(segment, travel(k - 1, k), stopAt(k));
+                double removedMiles = dist(i - 1, i) + dist(END, END + 1) - dist(i - 1, END + 1);
+                
+                // forwards: put the segment right after position q
+                TimeWindowData skipped = stopAt(END + 1);
+                for (int q = END + 1; q < LAST; ++q)
+                {
+                    if (q > END + 1)
+                        skipped = concatenate(skipped, travel(q - 1, q), stopAt(q));
+                    double newMiles = currentMiles - removedMiles + dist(q, i) + dist(END, q + 1) - dist(q, q + 1);
+                    TimeWindowData result = concatenate(prefix[i - 1], travel(i - 1, END + 1), skipped);
+                    result = concatenate(result, travel(q, i), segment);
+                    result = concatenate(result, travel(END, q + 1), suffix[q + 1]);
+                    if (isBetterTimedTour(result.timeWarp, newMiles, currentWarp, currentMiles))
+                    {
+                        rotate(tour.begin() + i, tour.begin() + END + 1, tour.begin() + q + 1);
+                        improved = true;
+                        break;
+                    }
+                }
+                if (improved  ||  i == 1)
+                    continue;
+                
+                // backwards: put the segment right before position q
+                skipped = stopAt(i - 1);
+                for (int q = i - 1; q >= 1; --q)
+                {
+                    if (q < i - 1)
+                        skipped = concatenate(stopAt(q), travel(q, q + 1), skipped);
+                    double newMiles = currentMiles - removedMiles + dist(q - 1, i) + dist(END, q) - dist(q - 1, q);
+                    TimeWindowData result = concatenate(prefix[q - 1], travel(q - 1, i), segment);
+                    result = concatenate(result, travel(END, q), skipped);
+                    result = concatenate(result, travel(i - 1, END + 1), suffix[END + 1]);
+                    if (isBetterTimedTour(result.timeWarp, newMiles, currentWarp, currentMiles))
+                    {
+                        rotate(tour.begin() + q, tour.begin() + i, tour.begin() + END + 1);
+                        improved = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
+
 //******************** DeliveryOptimizer functions ****************************
 
 // These functions simply delegate to DeliveryOptimizerImpl's functions.
@@ -182,3 +828,33 @@ void DeliveryOptimizer::optimizeDeliveryOrder(
 {
     return m_impl->optimizeDeliveryOrder(depot, deliveries, oldCrowDistance, newCrowDistance);
 }
+
+//******************** TimedDeliveryOptimizer functions ***********************
+
+// These functions simply delegate to DeliveryOptimizerImpl's functions.
+
+TimedDeliveryOptimizer::TimedDeliveryOptimizer(const StreetMap* sm)
+{
+    m_impl = new DeliveryOptimizerImpl(sm);
+}
+
+TimedDeliveryOptimizer::~TimedDeliveryOptimizer()
+{
+    delete m_impl;
+}
+
+bool TimedDeliveryOptimizer::optimizeDeliveryOrder(
+        const GeoCoord& depot,
+        double departureTime,
+        double milesPerHour,
+        vector<TimedDeliveryRequest>& deliveries,
+        double& oldCrowDistance,
+        double& newCrowDistance) const
+{
+    return m_impl->optimizeTimedDeliveryOrder(depot,
+                                              departureTime,
+                                              milesPerHour,
+                                              deliveries,
+                                              oldCrowDistance,
+                                              newCrowDistance);
+}
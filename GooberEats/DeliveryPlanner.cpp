@@ -1,7 +1,19 @@
 #include "provided.h"
+#include "TimedDelivery.h"
+#include "CompactPlan.h"
+#include "PlanStreamWriter.h"
+#include "TurnAwareRouter.h"
+#include "GraphRouter.h"
+#include "DepotRouteCache.h"
+#include "StreetGraph.h"
+#include "Trace.h"
 #include <vector>
+#include <algorithm>
 using namespace std;
 
+// Smallest change in bearing that counts as a turn (one degree)
+const int MIN_TURN_UNITS = BEARING_UNITS / 360;
+
 /*
  Definition of DeliveryPlannerImpl; private members were added to spec's skeleton code.
  */
@@ -9,35 +21,91 @@ class DeliveryPlannerImpl
 {
 public:
     DeliveryPlannerImpl(const StreetMap* sm);
+    DeliveryPlannerImpl(const StreetMap* sm, const TurnCosts& turnCosts, const vector<TurnRestriction>& restrictions);
     ~DeliveryPlannerImpl();
     DeliveryResult generateDeliveryPlan(
         const GeoCoord& depot,
         const vector<DeliveryRequest>& deliveries,
         vector<DeliveryCommand>& commands,
         double& totalDistanceTravelled) const;
+    DeliveryResult generateTimedDeliveryPlan(
+        const GeoCoord& depot,
+        double departureTime,
+        double milesPerHour,
+        const vector<TimedDeliveryRequest>& deliveries,
+        vector<DeliveryCommand>& commands,
+        vector<DeliveryArrival>& arrivals,
+        double& totalDistanceTravelled) const;
+    DeliveryResult generateCompactDeliveryPlan(
+        const GeoCoord& depot,
+        const vector<DeliveryRequest>& deliveries,
+        CompactPlan& plan,
+        double& totalDistanceTravelled,
+        PlanStreamWriter* writer) const;
+    void cacheDepotRoutes(size_t maxBytes);
+    DepotCacheStats depotCacheStats() const;
 private:
+    const StreetMap* STREET_MAP;
     DeliveryOptimizer optimizer;
-    PointToPointRouter pathfinder;
+    TimedDeliveryOptimizer timedOptimizer;
+    GraphRouter pathfinder;
+    // router that takes turns into account; nullptr unless the planner was made with turn costs
+    TurnAwareRouter* turnRouter;
+    // the map's graph, whose bearing table turns edges into directions without any trigonometry
+    const StreetGraph* graph;
+    // trees of routes out of and back into depots; nullptr unless caching was asked for
+    DepotRouteCache* depotCache;
     
-    void addCommands(const list<StreetSegment>& segments, vector<DeliveryCommand>& commands) const;
-    string cardinalDirection(const StreetSegment& segment) const;
-    bool streetRequiresTurn(const StreetSegment& seg1, const StreetSegment& seg2, string& direction) const;
+    DeliveryResult route(const GeoCoord& start, const GeoCoord& end, vector<int>& edges, double& distance) const;
+    DeliveryResult addCompactLeg(const GeoCoord& start,
+                                 const GeoCoord& end,
+                                 const string* item,
+                                 CompactPlan& plan,
+                                 double& distance,
+                                 PlanStreamWriter* writer) const;
+    void addCommands(const vector<int>& edges, vector<DeliveryCommand>& commands) const;
+    void addCommands(const vector<int>& edges, CompactPlan& plan) const;
+    Heading cardinalDirection(unsigned short bearing) const;
+    bool streetRequiresTurn(unsigned short bearing1, unsigned short bearing2, Turn& direction) const;
 };
 
 /*
- Constructor for DeliveryPlannerImpl; passes in StreetMap arguments for DeliveryOptimizer and PointToPointRouter.
+ Constructor for DeliveryPlannerImpl; passes in StreetMap arguments for the optimizers and router.
  */
 DeliveryPlannerImpl::DeliveryPlannerImpl(const StreetMap* sm)
-    : optimizer(sm), pathfinder(sm)
+    : STREET_MAP(sm),
+      optimizer(sm),
+      timedOptimizer(sm),
+      pathfinder(sm),
+      turnRouter(nullptr),
+      graph(getStreetGraph(sm)),
+      depotCache(nullptr)
+{
+}
+
+/*
+ Constructor for a DeliveryPlannerImpl whose legs are routed with turn costs (and restrictions).
+ */
+DeliveryPlannerImpl::DeliveryPlannerImpl(const StreetMap* sm,
+                                         const TurnCosts& turnCosts,
+                                         const vector<TurnRestriction>& restrictions)
+    : STREET_MAP(sm),
+      optimizer(sm),
+      timedOptimizer(sm),
+      pathfinder(sm),
+      turnRouter(new TurnAwareRouter(sm, turnCosts, restrictions)),
+      graph(getStreetGraph(sm)),
+      depotCache(nullptr)
 {
 }
 
 /*
- Destructor for PointToPointRouterImpl; class has none of its own dynamically-allocated objects,
- so this destructor does nothing.
+ Destructor for DeliveryPlannerImpl; deletes the turn-aware router and depot cache if there are any.
  */
 DeliveryPlannerImpl::~DeliveryPlannerImpl()
 {
+    delete turnRouter;
+    delete depotCache;
 }
 
 /*
@@ -49,6 +117,8 @@ DeliveryResult DeliveryPlannerImpl::generateDeliveryPlan(
     vector<DeliveryCommand>& commands,
     double& totalDistanceTravelled) const
 {
+    TraceScope trace("generateDeliveryPlan", "deliveries", deliveries.size());
+    
     // place the deliveries vector into a separate vector so as to not modify the reference variable.
     vector<DeliveryRequest> optimizedDeliveries = deliveries;
     double originalCrowDistance;
@@ -56,7 +126,7 @@ DeliveryResult DeliveryPlannerImpl::generateDeliveryPlan(
     optimizer.optimizeDeliveryOrder(depot, optimizedDeliveries, originalCrowDistance, optimizedCrowDistance);
     
     // set up variables for the loop below
-    list<StreetSegment> deliveryRoute;
+    vector<int> deliveryRoute;
     double deliveryDistance;
     totalDistanceTravelled = 0;
     DeliveryCommand routeFinished;
@@ -67,14 +137,13 @@ DeliveryResult DeliveryPlannerImpl::generateDeliveryPlan(
     // process every delivery in the delivery vector + the beginning delivery from the depot
     for (auto it = optimizedDeliveries.begin(); it != optimizedDeliveries.end(); ++it)
     {
+        TraceScope legTrace("leg", "index", it - optimizedDeliveries.begin());
+        
         // update the ending coordinate of this delivery
         endCoord = it->location;
         
-        // find a path of segments to reach the ending coordinate
-        result = pathfinder.generatePointToPointRoute(startCoord,
-                                                      endCoord,
-                                                      deliveryRoute,
-                                                      deliveryDistance);
+        // find a path of edges to reach the ending coordinate
+        result = route(startCoord, endCoord, deliveryRoute, deliveryDistance);
         // if a route wasn't found, end the function
         if (result != DELIVERY_SUCCESS)
             return result;
@@ -92,7 +161,8 @@ DeliveryResult DeliveryPlannerImpl::generateDeliveryPlan(
     }
     
     // generate a path back to the depot
-    result = pathfinder.generatePointToPointRoute(startCoord, depot, deliveryRoute, deliveryDistance);
+    TraceScope legTrace("leg", "index", optimizedDeliveries.size());
+    result = route(startCoord, depot, deliveryRoute, deliveryDistance);
     
     // if a route wasn't found, end the function
     if (result != DELIVERY_SUCCESS)
@@ -107,90 +177,275 @@ DeliveryResult DeliveryPlannerImpl::generateDeliveryPlan(
 }
 
 /*
- Adds commands corresponding to a list of StreetSegments for a delivery to the passed-in vector.
+ Plans a route for deliveries with time windows, ordering them with the timed optimizer and reporting when each
+ delivery is reached based on the street distance of every leg.
+ */
+DeliveryResult DeliveryPlannerImpl::generateTimedDeliveryPlan(
+    const GeoCoord& depot,
+    double departureTime,
+    double milesPerHour,
+    const vector<TimedDeliveryRequest>& deliveries,
+    vector<DeliveryCommand>& commands,
+    vector<DeliveryArrival>& arrivals,
+    double& totalDistanceTravelled) const
+{
+    TraceScope trace("generateTimedDeliveryPlan", "deliveries", deliveries.size());
+    
+    // order a copy of the deliveries so as to not modify the reference variable
+    vector<TimedDeliveryRequest> orderedDeliveries = deliveries;
+    double originalCrowDistance;
+    double optimizedCrowDistance;
+    timedOptimizer.optimizeDeliveryOrder(depot,
+                                         departureTime,
+                                         milesPerHour,
+                                         orderedDeliveries,
+                                         originalCrowDistance,
+                                         optimizedCrowDistance);
+    
+    // set up variables for the loop below; the clock starts when the driver leaves the depot
+    const double MINUTES_PER_MILE = 60 / milesPerHour;
+    vector<int> deliveryRoute;
+    double deliveryDistance;
+    totalDistanceTravelled = 0;
+    arrivals.clear();
+    double clock = departureTime;
+    DeliveryCommand routeFinished;
+    DeliveryResult result;
+    GeoCoord startCoord = depot;
+    
+    // route every leg, keeping track of the time as the driver goes
+    for (auto it = orderedDeliveries.begin(); it != orderedDeliveries.end(); ++it)
+    {
+        TraceScope legTrace("leg", "index", it - orderedDeliveries.begin());
+        result = route(startCoord, it->location, deliveryRoute, deliveryDistance);
+        if (result != DELIVERY_SUCCESS)
+            return result;
+        totalDistanceTravelled += deliveryDistance;
+        addCommands(deliveryRoute, commands);
+        routeFinished.initAsDeliverCommand(it->item);
+        commands.push_back(routeFinished);
+        
+        // the driver waits for the window to open if they're early, then spends the service time at the stop
+        DeliveryArrival arrival;
+        arrival.item = it->item;
+        arrival.arrivalTime = clock + deliveryDistance * MINUTES_PER_MILE;
+        arrival.serviceStart = max(arrival.arrivalTime, it->earliestArrival);
+        arrival.onTime = arrival.serviceStart <= it->latestArrival;
+        arrivals.push_back(arrival);
+        clock = arrival.serviceStart + it->serviceMinutes;
+        
+        startCoord = it->location;
+    }
+    
+    // generate a path back to the depot
+    TraceScope legTrace("leg", "index", orderedDeliveries.size());
+    result = route(startCoord, depot, deliveryRoute, deliveryDistance);
+    if (result != DELIVERY_SUCCESS)
+        return result;
+    totalDistanceTravelled += deliveryDistance;
+    addCommands(deliveryRoute, commands);
+    return result;
+}
+
+/*
+ Plans a route exactly like generateDeliveryPlan does, storing compact commands instead of DeliveryCommands. If there's
+ a writer, every leg is handed to it as soon as it's routed.
+ */
+DeliveryResult DeliveryPlannerImpl::generateCompactDeliveryPlan(
+    const GeoCoord& depot,
+    const vector<DeliveryRequest>& deliveries,
+    CompactPlan& plan,
+    double& totalDistanceTravelled,
+    PlanStreamWriter* writer) const
+{
+    TraceScope trace("generateCompactDeliveryPlan", "deliveries", deliveries.size());
+    
+    // order a copy of the deliveries so as to not modify the reference variable
+    vector<DeliveryRequest> optimizedDeliveries = deliveries;
+    double originalCrowDistance;
+    double optimizedCrowDistance;
+    optimizer.optimizeDeliveryOrder(depot, optimizedDeliveries, originalCrowDistance, optimizedCrowDistance);
+    
+    // route every leg, ending each one with a deliver command, then the way back to the depot (the first and last legs
+    // come from the depot's trees if it's cached)
+    if (depotCache != nullptr  &&  turnRouter == nullptr)
+        depotCache->addDepot(depot);
+    double deliveryDistance;
+    totalDistanceTravelled = 0;
+    plan.clear();
+    DeliveryResult result;
+    GeoCoord startCoord = depot;
+    for (auto it = optimizedDeliveries.begin(); it != optimizedDeliveries.end(); ++it)
+    {
+        TraceScope legTrace("leg", "index", it - optimizedDeliveries.begin());
+        result = addCompactLeg(startCoord, it->location, &it->item, plan, deliveryDistance, writer);
+        if (result != DELIVERY_SUCCESS)
+            return result;
+        totalDistanceTravelled += deliveryDistance;
+        startCoord = it->location;
+    }
+    TraceScope legTrace("leg", "index", optimizedDeliveries.size());
+    result = addCompactLeg(startCoord, depot, nullptr, plan, deliveryDistance, writer);
+    if (result != DELIVERY_SUCCESS)
+        return result;
+    totalDistanceTravelled += deliveryDistance;
+    return result;
+}
+
+/*
+ Routes one leg as edges of the map's graph, with the turn-aware router if the planner has one, or from a depot's
+ trees if the leg leaves or returns to a cached depot.
+ */
+DeliveryResult DeliveryPlannerImpl::route(const GeoCoord& start,
+                                          const GeoCoord& end,
+                                          vector<int>& edges,
+                                          double& distance) const
+{
+    TraceScope trace("generatePointToPointRoute");
+    if (turnRouter != nullptr)
+        return turnRouter->generatePointToPointRoute(start, end, edges, distance);
+    DeliveryResult result;
+    if (depotCache != nullptr  &&  depotCache->findRoute(start, end, edges, distance, result))
+        return result;
+    return pathfinder.generatePointToPointRoute(start, end, edges, distance);
+}
+
+/*
+ Sets up a depot cache for the planner, replacing any it had.
+ */
+void DeliveryPlannerImpl::cacheDepotRoutes(size_t maxBytes)
+{
+    delete depotCache;
+    depotCache = new DepotRouteCache(STREET_MAP, maxBytes);
+}
+
+DepotCacheStats DeliveryPlannerImpl::depotCacheStats() const
+{
+    return depotCache != nullptr ? depotCache->stats() : DepotCacheStats();
+}
+
+/*
+ Routes one leg of a compact plan and adds its commands to the plan, followed by a deliver command if there's an item,
+ then hands the leg to the writer if there is one. Legs stay edge ids, so their commands and geometry come straight
+ from the graph's tables.
+ */
+DeliveryResult DeliveryPlannerImpl::addCompactLeg(const GeoCoord& start,
+                                                  const GeoCoord& end,
+                                                  const string* item,
+                                                  CompactPlan& plan,
+                                                  double& distance,
+                                                  PlanStreamWriter* writer) const
+{
+    size_t firstCommand = plan.size();
+    vector<int> edges;
+    DeliveryResult result = route(start, end, edges, distance);
+    if (result != DELIVERY_SUCCESS)
+        return result;
+    addCommands(edges, plan);
+    if (item != nullptr)
+        plan.addDeliver(*item);
+    if (writer != nullptr)
+        writer->writeLeg(plan, firstCommand, *graph, edges, distance);
+    return result;
+}
+
+/*
+ Adds commands corresponding to a route's edges for a delivery to the passed-in vector.
  */
-void DeliveryPlannerImpl::addCommands(const list<StreetSegment>& segments, vector<DeliveryCommand>& commands) const
+void DeliveryPlannerImpl::addCommands(const vector<int>& edges, vector<DeliveryCommand>& commands) const
 {
+    TraceScope trace("addCommands", "edges", edges.size());
+    // a delivery at the same location as the previous stop needs no travel, so there are no commands to add
+    if (edges.empty())
+        return;
+    
     // every delivery starts with a proceed command, so we initialize one first
-    auto itPrevious = segments.begin();
+    auto itPrevious = edges.begin();
     DeliveryCommand command;
-    command.initAsProceedCommand(cardinalDirection(*itPrevious), itPrevious->name, 0);
+    command.initAsProceedCommand(headingName(cardinalDirection(graph->edgeBearing(*itPrevious))),
+                                 graph->edgeName(*itPrevious),
+                                 0);
     
-    // process every street segment that's passed in
-    for (auto itCurrent = segments.begin(); itCurrent != segments.end(); ++itCurrent)
+    // process every edge that's passed in
+    for (auto itCurrent = edges.begin(); itCurrent != edges.end(); ++itCurrent)
     {
-        // if the street segment is a continuation of the last one, just increase the distance of the last street
-        if (itCurrent->name == itPrevious->name)
-            command.increaseDistance(distanceEarthMiles(itCurrent->start, itCurrent->end));
+        // if the edge is a continuation of the last one's street, just increase the distance of the last street
+        if (graph->edgeNameId(*itCurrent) == graph->edgeNameId(*itPrevious))
+            command.increaseDistance(graph->edgeMiles(*itCurrent));
         else
         {
-            // add the previous street segment to the vector of commands
+            // add the previous street to the vector of commands
             commands.push_back(command);
             
             // if the next street requires a turn, add a turn command in the proper direction to the command vector
-            string turnToTake;
-            if (streetRequiresTurn(*itPrevious, *itCurrent, turnToTake))
+            Turn turnToTake;
+            if (streetRequiresTurn(graph->edgeBearing(*itPrevious), graph->edgeBearing(*itCurrent), turnToTake))
             {
-                command.initAsTurnCommand(turnToTake, itCurrent->name);
+                command.initAsTurnCommand(turnName(turnToTake), graph->edgeName(*itCurrent));
                 commands.push_back(command);
             }
             
-            // initialize a proceed command in the proper direction for the next StreetSegment
-            command.initAsProceedCommand(cardinalDirection(*itCurrent),
-                                         itCurrent->name,
-                                         distanceEarthMiles(itCurrent->start, itCurrent->end));
+            // initialize a proceed command in the proper direction for the next street
+            command.initAsProceedCommand(headingName(cardinalDirection(graph->edgeBearing(*itCurrent))),
+                                         graph->edgeName(*itCurrent),
+                                         graph->edgeMiles(*itCurrent));
         }
-        // update the iterator to the previous segment
+        // update the iterator to the previous edge
         itPrevious = itCurrent;
     }
-    // if the route has at least one segment, add the last segment that was processed
-    if (!segments.empty())
-        commands.push_back(command);
+    // add the last street that was processed
+    commands.push_back(command);
 }
 
 /*
- Returns a cardinal direction for a StreetSegment's angle per the spec.
+ Adds compact commands for a route given as graph edges, merging edges of the same street exactly like the
+ DeliveryCommand version does. Streets are compared by name id and directions come from the bearing table, so the only
+ string work is looking up a street's name when a command for it is added.
  */
-string DeliveryPlannerImpl::cardinalDirection(const StreetSegment& segment) const
-{
-    // get the angle of the street segment and return the corresponding cardinal direction
-    double dir = angleOfLine(segment);
-    if (dir >= 0  &&  dir < 22.5)
-        return "east";
-    if (dir < 67.5)
-        return "northeast";
-    if (dir < 112.5)
-        return "north";
-    if (dir < 157.5)
-        return "northwest";
-    if (dir < 202.5)
-        return "west";
-    if (dir < 247.5)
-        return "southwest";
-    if (dir < 292.5)
-        return "south";
-    if (dir < 337.5)
-        return "southeast";
-    return "east";
+void DeliveryPlannerImpl::addCommands(const vector<int>& edges, CompactPlan& plan) const
+{
+    TraceScope trace("addCommands", "edges", edges.size());
+    if (edges.empty())
+        return;
+    
+    auto itPrevious = edges.begin();
+    plan.addProceed(cardinalDirection(graph->edgeBearing(*itPrevious)), graph->edgeName(*itPrevious), 0);
+    for (auto itCurrent = edges.begin(); itCurrent != edges.end(); ++itCurrent)
+    {
+        float miles = static_cast<float>(graph->edgeMiles(*itCurrent));
+        if (graph->edgeNameId(*itCurrent) == graph->edgeNameId(*itPrevious))
+            plan.increaseDistance(miles);
+        else
+        {
+            Turn turnToTake;
+            if (streetRequiresTurn(graph->edgeBearing(*itPrevious), graph->edgeBearing(*itCurrent), turnToTake))
+                plan.addTurn(turnToTake, graph->edgeName(*itCurrent));
+            plan.addProceed(cardinalDirection(graph->edgeBearing(*itCurrent)), graph->edgeName(*itCurrent), miles);
+        }
+        itPrevious = itCurrent;
+    }
 }
 
 /*
- Returns whether a turn is required for two StreetSegments and, if one is, pass the direction through a parameter.
+ Returns the cardinal direction of a bearing from the graph. Each direction covers an eighth of a circle centered on
+ it, so shifting the bearing by a sixteenth of a circle makes the direction its top three bits.
  */
-bool DeliveryPlannerImpl::streetRequiresTurn(const StreetSegment& seg1, const StreetSegment& seg2, string& direction) const
+Heading DeliveryPlannerImpl::cardinalDirection(unsigned short bearing) const
 {
-    // get the angle between the two StreetSegments
-    double dir = angleBetween2Lines(seg1, seg2);
-    
-    // if the angle difference is small enough, a turn isn't needed
-    if (dir < 1  ||  dir > 359)
+    return static_cast<Heading>(static_cast<unsigned short>(bearing + BEARING_UNITS / 16) >> 13);
+}
+
+/*
+ Returns whether a turn is required between two edges with the given bearings and, if one is, passes the direction
+ through a parameter. The change in bearing wraps around as an unsigned short, and anything under a degree either way
+ isn't a turn.
+ */
+bool DeliveryPlannerImpl::streetRequiresTurn(unsigned short bearing1, unsigned short bearing2, Turn& direction) const
+{
+    int change = static_cast<unsigned short>(bearing2 - bearing1);
+    if (change < MIN_TURN_UNITS  ||  change > BEARING_UNITS - MIN_TURN_UNITS)
         return false;
-    
-    // return the corresponding direction for the angle's turn and return that a turn is needed
-    if (dir >= 1  &&  dir < 180)
-        direction = "left";
-    else
-        direction = "right";
+    direction = change < BEARING_UNITS / 2 ? Turn::LEFT : Turn::RIGHT;
     return true;
 }
 
@@ -217,3 +472,85 @@ DeliveryResult DeliveryPlanner::generateDeliveryPlan(
 {
     return m_impl->generateDeliveryPlan(depot, deliveries, commands, totalDistanceTravelled);
 }
+
+//******************** TimedDeliveryPlanner functions *************************
+
+// These functions simply delegate to DeliveryPlannerImpl's functions.
+
+TimedDeliveryPlanner::TimedDeliveryPlanner(const StreetMap* sm)
+{
+    m_impl = new DeliveryPlannerImpl(sm);
+}
+
+TimedDeliveryPlanner::~TimedDeliveryPlanner()
+{
+    delete m_impl;
+}
+
+DeliveryResult TimedDeliveryPlanner::generateDeliveryPlan(
+    const GeoCoord& depot,
+    double departureTime,
+    double milesPerHour,
+    const vector<TimedDeliveryRequest>& deliveries,
+    vector<DeliveryCommand>& commands,
+    vector<DeliveryArrival>& arrivals,
+    double& totalDistanceTravelled) const
+{
+    return m_impl->generateTimedDeliveryPlan(depot,
+                                             departureTime,
+                                             milesPerHour,
+                                             deliveries,
+                                             commands,
+                                             arrivals,
+                                             totalDistanceTravelled);
+}
+
+//******************** CompactDeliveryPlanner functions ***********************
+
+// These functions simply delegate to DeliveryPlannerImpl's functions.
+
+CompactDeliveryPlanner::CompactDeliveryPlanner(const StreetMap* sm)
+{
+    m_impl = new DeliveryPlannerImpl(sm);
+}
+
+CompactDeliveryPlanner::CompactDeliveryPlanner(const StreetMap* sm,
+                                               const TurnCosts& turnCosts,
+                                               const vector<TurnRestriction>& restrictions)
+{
+    m_impl = new DeliveryPlannerImpl(sm, turnCosts, restrictions);
+}
+
+CompactDeliveryPlanner::~CompactDeliveryPlanner()
+{
+    delete m_impl;
+}
+
+DeliveryResult CompactDeliveryPlanner::generateDeliveryPlan(
+    const GeoCoord& depot,
+    const vector<DeliveryRequest>& deliveries,
+    CompactPlan& plan,
+    double& totalDistanceTravelled) const
+{
+    return m_impl->generateCompactDeliveryPlan(depot, deliveries, plan, totalDistanceTravelled, nullptr);
+}
+
+DeliveryResult CompactDeliveryPlanner::generateDeliveryPlan(
+    const GeoCoord& depot,
+    const vector<DeliveryRequest>& deliveries,
+    CompactPlan& plan,
+    double& totalDistanceTravelled,
+    PlanStreamWriter& writer) const
+{
+    return m_impl->generateCompactDeliveryPlan(depot, deliveries, plan, totalDistanceTravelled, &writer);
+}
+
+void CompactDeliveryPlanner::cacheDepotRoutes(size_t maxBytes)
+{
+    m_impl->cacheDepotRoutes(maxBytes);
+}
+
+DepotCacheStats CompactDeliveryPlanner::depotCacheStats() const
+{
+    return m_impl->depotCacheStats();
+}
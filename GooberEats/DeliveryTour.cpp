@@ -0,0 +1,346 @@
+#include "provided.h"
+#include "DeliveryTour.h"
+#include <vector>
+#include <algorithm>
+using namespace std;
+
+// Slot that the depot's location is kept in
+const int DEPOT_SLOT = 0;
+// Number of positions on either side of a change that the local repair is allowed to touch
+const int REPAIR_RADIUS = 12;
+// Largest number of improving moves a single repair makes
+const int MAX_REPAIR_MOVES = 200;
+// Longest run of consecutive deliveries that the repair moves as a block
+const int MAX_REPAIR_SEGMENT = 3;
+// Smallest change in crow distance (in miles) that counts as an improvement
+const double REPAIR_EPSILON = 1e-9;
+
+/*
+ Definition of DeliveryTourImpl.
+ Every location (the depot and each delivery) is kept in a slot; crow distances between slots are cached in a matrix
+ as slots are filled, so no distance is ever computed twice. Slots of cancelled deliveries are reused.
+ */
+class DeliveryTourImpl
+{
+public:
+    DeliveryTourImpl(const StreetMap* sm);
+    ~DeliveryTourImpl();
+    void setTour(const GeoCoord& depot, const vector<DeliveryRequest>& orderedDeliveries);
+    void markCompleted(int numCompleted);
+    int addDelivery(const DeliveryRequest& delivery);
+    bool cancelDelivery(int position);
+    const vector<DeliveryRequest>& deliveries() const;
+    double crowDistance() const;
+private:
+    const StreetMap* STREET_MAP;
+    
+    // location of every slot, whether the slot is in use, and slots that can be reused
+    vector<GeoCoord> m_locations;
+    vector<bool> m_used;
+    vector<int> m_freeSlots;
+    // cached crow distances between slots; the matrix is m_stride slots wide
+    vector<double> m_miles;
+    int m_stride;
+    
+    // slots of the tour's deliveries in delivery order, alongside the deliveries themselves
+    vector<int> m_tour;
+    vector<DeliveryRequest> m_ordered;
+    int m_numCompleted;
+    double m_distance;
+    
+    int acquireSlot(const GeoCoord& location);
+    void releaseSlot(int slot);
+    void repair(int center);
+    
+    /// Returns the cached crow distance between two slots.
+    double miles(int a, int b) const
+    {
+        return m_miles[a * m_stride + b];
+    }
+    
+    /// Returns the slot at a position in the tour, treating positions before the first delivery and after the last
+    /// delivery as the depot.
+    int slotAt(int position) const
+    {
+        if (position < 0  ||  position >= static_cast<int>(m_tour.size()))
+            return DEPOT_SLOT;
+        return m_tour[position];
+    }
+};
+
+/*
+ Constructor for DeliveryTourImpl; the tour starts out empty, with the depot's slot reserved.
+ */
+DeliveryTourImpl::DeliveryTourImpl(const StreetMap* sm)
+    : STREET_MAP(sm), m_stride(0), m_numCompleted(0), m_distance(0)
+{
+    setTour(GeoCoord(), vector<DeliveryRequest>());
+}
+
+/*
+ Destructor for DeliveryTourImpl; class has none of its own dynamically-allocated objects, so this destructor does nothing.
+ */
+DeliveryTourImpl::~DeliveryTourImpl()
+{
+}
+
+/*
+ Replaces the tour with an already-ordered list of deliveries, throwing away every cached distance.
+ */
+void DeliveryTourImpl::setTour(const GeoCoord& depot, const vector<DeliveryRequest>& orderedDeliveries)
+{
+    // clear every slot, then put the depot in the first one
+    m_locations.clear();
+    m_used.clear();
+    m_freeSlots.clear();
+    m_miles.clear();
+    m_stride = 0;
+    acquireSlot(depot);
+    
+    // fill a slot for every delivery and add up the tour's distance
+    m_tour.clear();
+    m_ordered = orderedDeliveries;
+    m_numCompleted = 0;
+    m_distance = 0;
+    for (auto it = orderedDeliveries.begin(); it != orderedDeliveries.end(); ++it)
+    {
+        int previous = m_tour.empty() ? DEPOT_SLOT : m_tour.back();
+        m_tour.push_back(acquireSlot(it->location));
+        m_distance += miles(previous, m_tour.back());
+    }
+    m_distance += miles(slotAt(static_cast<int>(m_tour.size()) - 1), DEPOT_SLOT);
+}
+
+/*
+ Locks the first numCompleted deliveries in place.
+ */
+void DeliveryTourImpl::markCompleted(int numCompleted)
+{
+    // deliveries that were made stay made, and there can't be more made than there are in the tour
+    m_numCompleted = max(m_numCompleted, min(numCompleted, static_cast<int>(m_tour.size())));
+}
+
+/*
+ Inserts a delivery into the cheapest gap after the completed deliveries, repairs the tour around it, and returns
+ where the delivery ended up.
+ */
+int DeliveryTourImpl::addDelivery(const DeliveryRequest& delivery)
+{
+    int slot = acquireSlot(delivery.location);
+    
+    // find the gap (the position the delivery would take) that adds the least distance
+    int bestGap = m_numCompleted;
+    double bestCost = 0;
+    for (int gap = m_numCompleted; gap <= static_cast<int>(m_tour.size()); ++gap)
+    {
+        int before = slotAt(gap - 1);
+        int after = slotAt(gap);
+        double cost = miles(before, slot) + miles(slot, after) - miles(before, after);
+        if (gap == m_numCompleted  ||  cost < bestCost)
+        {
+            bestGap = gap;
+            bestCost = cost;
+        }
+    }
+    m_tour.insert(m_tour.begin() + bestGap, slot);
+    m_ordered.insert(m_ordered.begin() + bestGap, delivery);
+    m_distance += bestCost;
+    
+    // tidy up the neighborhood of the new delivery, then report where it is now
+    repair(bestGap);
+    return static_cast<int>(find(m_tour.begin(), m_tour.end(), slot) - m_tour.begin());
+}
+
+/*
+ Removes a delivery that hasn't been made yet and repairs the tour around the gap it left.
+ */
+bool DeliveryTourImpl::cancelDelivery(int position)
+{
+    if (position < m_numCompleted  ||  position >= static_cast<int>(m_tour.size()))
+        return false;
+    
+    // join the stops on either side of the delivery directly
+    int before = slotAt(position - 1);
+    int after = slotAt(position + 1);
+    int slot = m_tour[position];
+    m_distance += miles(before, after) - miles(before, slot) - miles(slot, after);
+    m_tour.erase(m_tour.begin() + position);
+    m_ordered.erase(m_ordered.begin() + position);
+    releaseSlot(slot);
+    
+    repair(position);
+    return true;
+}
+
+const vector<DeliveryRequest>& DeliveryTourImpl::deliveries() const
+{
+    return m_ordered;
+}
+
+double DeliveryTourImpl::crowDistance() const
+{
+    return m_distance;
+}
+
+/*
+ Puts a location into a free slot (growing the distance matrix if every slot is taken), caches its distance to every
+ other slot in use, and returns the slot.
+ */
+int DeliveryTourImpl::acquireSlot(const GeoCoord& location)
+{
+    int slot;
+    if (!m_freeSlots.empty())
+    {
+        slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+        m_locations[slot] = location;
+    }
+    else
+    {
+        slot = static_cast<int>(m_locations.size());
+        m_locations.push_back(location);
+        m_used.push_back(false);
+        
+        // double the width of the matrix when it runs out of room, copying over the distances cached so far
+        if (slot >= m_stride)
+        {
+            int newStride = max(2 * m_stride, 8);
+            vector<double> newMiles(newStride * newStride, 0);
+            for (int a = 0; a < m_stride; ++a)
+                copy(m_miles.begin() + a * m_stride, m_miles.begin() + (a + 1) * m_stride, newMiles.begin() + a * newStride);
+            m_miles.swap(newMiles);
+            m_stride = newStride;
+        }
+    }
+    m_used[slot] = true;
+    
+    // cache the distance between this slot and every other one in use
+    for (int other = 0; other < static_cast<int>(m_locations.size()); ++other)
+        if (m_used[other])
+            m_miles[slot * m_stride + other] = m_miles[other * m_stride + slot] =
+                distanceEarthMiles(m_locations[slot], m_locations[other]);
+    return slot;
+}
+
+/*
+ Marks a slot as free so that the next added delivery can reuse it.
+ */
+void DeliveryTourImpl::releaseSlot(int slot)
+{
+    m_used[slot] = false;
+    m_freeSlots.push_back(slot);
+}
+
+/*
+ Improves the tour with 2-opt and or-opt moves that stay within REPAIR_RADIUS positions of a change and never touch
+ completed deliveries. Every move is checked in O(1) with cached distances.
+ */
+void DeliveryTourImpl::repair(int center)
+{
+    const int LOW = max(m_numCompleted, center - REPAIR_RADIUS);
+    const int HIGH = min(static_cast<int>(m_tour.size()) - 1, center + REPAIR_RADIUS);
+    
+    bool improved = true;
+    for (int moves = 0; improved  &&  moves < MAX_REPAIR_MOVES; ++moves)
+    {
+        improved = false;
+        
+        // 2-opt: reverse the deliveries from position i through position j
+        for (int i = LOW; i < HIGH  &&  !improved; ++i)
+        {
+            for (int j = i + 1; j <= HIGH; ++j)
+            {
+                double change = miles(slotAt(i - 1), slotAt(j)) + miles(slotAt(i), slotAt(j + 1))
+                                - miles(slotAt(i - 1), slotAt(i)) - miles(slotAt(j), slotAt(j + 1));
+                if (change < -REPAIR_EPSILON)
+                {
+                    std::reverse(m_tour.begin() + i, m_tour.begin() + j + 1);
+                    std::reverse(m_ordered.begin() + i, m_ordered.begin() + j + 1);
+                    m_distance += change;
+                    improved = true;
+                    break;
+                }
+            }
+        }
+        
+        // or-opt: move the deliveries from position i through position end elsewhere in the window
+        for (int length = 1; length <= MAX_REPAIR_SEGMENT  &&  !improved; ++length)
+        {
+            for (int i = LOW; i + length - 1 <= HIGH  &&  !improved; ++i)
+            {
+                const int END = i + length - 1;
+                double removed = miles(slotAt(i - 1), slotAt(i)) + miles(slotAt(END), slotAt(END + 1))
+                                 - miles(slotAt(i - 1), slotAt(END + 1));
+                for (int q = LOW - 1; q <= HIGH; ++q)
+                {
+                    if (q >= i - 1  &&  q <= END)
+                        continue;
+                    // the segment goes between position q and the position after it
+                    int before = slotAt(q);
+                    int after = slotAt(q + 1);
+                    double change = miles(before, slotAt(i)) + miles(slotAt(END), after) - miles(before, after) - removed;
+                    if (change < -REPAIR_EPSILON)
+                    {
+                        if (q > END)
+                        {
+                            rotate(m_tour.begin() + i, m_tour.begin() + END + 1, m_tour.begin() + q + 1);
+                            rotate(m_ordered.begin() + i, m_ordered.begin() + END + 1, m_ordered.begin() + q + 1);
+                        }
+                        else
+                        {
+                            rotate(m_tour.begin() + q + 1, m_tour.begin() + i, m_tour.begin() + END + 1);
+                            rotate(m_ordered.begin() + q + 1, m_ordered.begin() + i, m_ordered.begin() + END + 1);
+                        }
+                        m_distance += change;
+                        improved = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
+
+//******************** DeliveryTour functions *********************************
+
+// These functions simply delegate to DeliveryTourImpl's functions.
+
+DeliveryTour::DeliveryTour(const StreetMap* sm)
+{
+    m_impl = new DeliveryTourImpl(sm);
+}
+
+DeliveryTour::~DeliveryTour()
+{
+    delete m_impl;
+}
+
+void DeliveryTour::setTour(const GeoCoord& depot, const vector<DeliveryRequest>& orderedDeliveries)
+{
+    m_impl->setTour(depot, orderedDeliveries);
+}
+
+void DeliveryTour::markCompleted(int numCompleted)
+{
+    m_impl->markCompleted(numCompleted);
+}
+
+int DeliveryTour::addDelivery(const DeliveryRequest& delivery)
+{
+    return m_impl->addDelivery(delivery);
+}
+
+bool DeliveryTour::cancelDelivery(int position)
+{
+    return m_impl->cancelDelivery(position);
+}
+
+const vector<DeliveryRequest>& DeliveryTour::deliveries() const
+{
+    return m_impl->deliveries();
+}
+
+double DeliveryTour::crowDistance() const
+{
+    return m_impl->crowDistance();
+}
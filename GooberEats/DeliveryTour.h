@@ -0,0 +1,45 @@
+#ifndef DeliveryTour_h
+#define DeliveryTour_h
+
+#include "provided.h"
+#include <vector>
+
+// DeliveryTour.h
+
+// A driver's tour that changes while it's under way. Deliveries that are added or cancelled are fixed up with a
+// cheapest insertion and a short repair of the stops around the change instead of re-optimizing the whole tour, and
+// deliveries that have already been made are never moved.
+
+class DeliveryTourImpl;
+
+class DeliveryTour
+{
+public:
+    DeliveryTour(const StreetMap* sm);
+    ~DeliveryTour();
+
+      // Replaces the tour with deliveries that are already in delivery order (e.g. from DeliveryOptimizer);
+      // none of them have been made yet.
+    void setTour(const GeoCoord& depot, const std::vector<DeliveryRequest>& orderedDeliveries);
+
+      // Marks the first numCompleted deliveries of the tour as made; they stay at the front of the tour and are
+      // never moved again. Deliveries can't be marked as not made.
+    void markCompleted(int numCompleted);
+
+      // Adds a delivery to the part of the tour that hasn't been made yet and returns its position in the tour.
+    int addDelivery(const DeliveryRequest& delivery);
+
+      // Removes the delivery at a position in the tour; returns false if there's no such delivery or it was made.
+    bool cancelDelivery(int position);
+
+    const std::vector<DeliveryRequest>& deliveries() const;
+    double crowDistance() const;
+
+      // We prevent a DeliveryTour object from being copied or assigned.
+    DeliveryTour(const DeliveryTour&) = delete;
+    DeliveryTour& operator=(const DeliveryTour&) = delete;
+private:
+    DeliveryTourImpl* m_impl;
+};
+
+#endif /* DeliveryTour_h */
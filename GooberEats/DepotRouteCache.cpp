@@ -0,0 +1,301 @@
+#include "provided.h"
+#include "DepotRouteCache.h"
+#include "StreetGraph.h"
+#include "MapUpdates.h"
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <functional>
+#include <utility>
+#include <iterator>
+#include <algorithm>
+using namespace std;
+
+/*
+ The two shortest-path trees of one depot. toNode[n] is the last edge of the best route from the depot to node n, and
+ fromNode[n] is the first edge of the best route from n back to the depot; both are -1 at the depot itself and for
+ nodes that can't be reached. version is that of the edge costs they were grown over.
+ */
+struct DepotTrees
+{
+    int depot;
+    long long version;
+    vector<int> toNode;
+    vector<int> fromNode;
+    
+    size_t bytes() const { return (toNode.capacity() + fromNode.capacity()) * sizeof(int); }
+    bool uses(int edge, const StreetGraph& graph) const
+    {
+        return toNode[graph.edgeTo(edge)] == edge  ||  fromNode[graph.edgeFrom(edge)] == edge;
+    }
+};
+
+/*
+ Definition of DepotRouteCacheImpl.
+ */
+class DepotRouteCacheImpl
+{
+public:
+    DepotRouteCacheImpl(const StreetMap* sm, size_t maxBytes);
+    ~DepotRouteCacheImpl();
+    bool addDepot(const GeoCoord& depot);
+    bool findRoute(const GeoCoord& start,
+                   const GeoCoord& end,
+                   vector<int>& edges,
+                   double& totalDistanceTravelled,
+                   DeliveryResult& result);
+    DepotCacheStats stats() const;
+private:
+    const StreetGraph* GRAPH;
+    
+    // cached depots by node, and the same depots from most to least recently used; trees are shared so a leg can keep
+    // walking one after another thread has dropped it from the cache
+    unordered_map<int, list<shared_ptr<const DepotTrees>>::iterator> m_depots;
+    list<shared_ptr<const DepotTrees>> m_recent;
+    DepotCacheStats m_stats;
+    mutable mutex m_mutex;
+    int m_watcher;
+    
+    void growTree(int depot, bool towardDepot, const EdgeCosts& costs, vector<int>& tree) const;
+    shared_ptr<const DepotTrees> find(int node);
+    void drop(list<shared_ptr<const DepotTrees>>::iterator it);
+    void costsChanged(const EdgeCostChange& change);
+};
+
+DepotRouteCacheImpl::DepotRouteCacheImpl(const StreetMap* sm, size_t maxBytes)
+    : GRAPH(getStreetGraph(sm))
+{
+    m_stats.maxBytes = maxBytes;
+    m_watcher = watchEdgeCosts(GRAPH, [this](const EdgeCostChange& change) { costsChanged(change); });
+}
+
+/*
+ Once unwatchEdgeCosts returns, the cache is never told about another change, so it's safe to destroy.
+ */
+DepotRouteCacheImpl::~DepotRouteCacheImpl()
+{
+    unwatchEdgeCosts(m_watcher);
+}
+
+/*
+ Grows a depot's trees without holding the lock, so other threads keep routing meanwhile; if another thread cached the
+ same depot in the meantime, its trees are the ones kept. If the costs changed while the trees were growing, they
+ aren't cached at all, since the change may have gone by before they were there to be dropped.
+ */
+bool DepotRouteCacheImpl::addDepot(const GeoCoord& depot)
+{
+    int node = GRAPH->findNode(depot);
+    if (node == NO_NODE)
+        return false;
+    {
+        lock_guard<mutex> lock(m_mutex);
+        auto found = m_depots.find(node);
+        if (found != m_depots.end())
+        {
+            m_recent.splice(m_recent.begin(), m_recent, found->second);
+            return true;
+        }
+        if (static_cast<size_t>(GRAPH->numNodes()) * 2 * sizeof(int) > m_stats.maxBytes)
+            return false;
+    }
+    
+    shared_ptr<const EdgeCosts> costs = GRAPH->costs();
+    shared_ptr<DepotTrees> trees = make_shared<DepotTrees>();
+    trees->depot = node;
+    trees->version = costs->version;
+    growTree(node, false, *costs, trees->toNode);
+    growTree(node, true, *costs, trees->fromNode);
+    
+    lock_guard<mutex> lock(m_mutex);
+    if (m_depots.find(node) != m_depots.end()  ||  GRAPH->costs()->version != trees->version)
+        return true;
+    ++m_stats.builds;
+    while (!m_recent.empty()  &&  m_stats.bytes + trees->bytes() > m_stats.maxBytes)
+    {
+        drop(prev(m_recent.end()));
+        ++m_stats.evictions;
+    }
+    m_recent.push_front(trees);
+    m_depots[node] = m_recent.begin();
+    m_stats.bytes += trees->bytes();
+    m_stats.depots = static_cast<int>(m_depots.size());
+    return true;
+}
+
+/*
+ Walks to the depot from the leg's end (when the leg leaves the depot) or from its start (when it returns there). Both
+ walks follow the tree from the far end of the leg, so the edges of an outbound leg are collected backwards and then
+ reversed once.
+ */
+bool DepotRouteCacheImpl::findRoute(const GeoCoord& start,
+                                    const GeoCoord& end,
+                                    vector<int>& edges,
+                                    double& totalDistanceTravelled,
+                                    DeliveryResult& result)
+{
+    int startNode = GRAPH->findNode(start);
+    int endNode = GRAPH->findNode(end);
+    if (startNode == NO_NODE  ||  endNode == NO_NODE)
+        return false;
+    shared_ptr<const DepotTrees> trees = find(startNode);
+    bool outbound = trees != nullptr;
+    if (!outbound)
+        trees = find(endNode);
+    {
+        lock_guard<mutex> lock(m_mutex);
+        ++(trees != nullptr ? m_stats.hits : m_stats.misses);
+    }
+    if (trees == nullptr)
+        return false;
+    
+    edges.clear();
+    totalDistanceTravelled = 0;
+    result = DELIVERY_SUCCESS;
+    if (startNode == endNode)
+        return true;
+    int node = outbound ? endNode : startNode;
+    const vector<int>& tree = outbound ? trees->toNode : trees->fromNode;
+    if (tree[node] == -1)
+    {
+        result = NO_ROUTE;
+        return true;
+    }
+    for (; node != trees->depot; node = outbound ? GRAPH->edgeFrom(tree[node]) : GRAPH->edgeTo(tree[node]))
+        edges.push_back(tree[node]);
+    if (outbound)
+        reverse(edges.begin(), edges.end());
+    
+    // add up the distance from the destination back, the same order a search's walk back adds it
+    for (auto it = edges.rbegin(); it != edges.rend(); ++it)
+        totalDistanceTravelled += GRAPH->edgeMiles(*it);
+    return true;
+}
+
+DepotCacheStats DepotRouteCacheImpl::stats() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_stats;
+}
+
+/*
+ Grows a shortest-path tree from a depot with Dijkstra's algorithm. Going away from the depot, a node is reached by the
+ edges leaving the nodes already settled; going toward it, a node is reached by the edges arriving at them, which leave
+ it for a settled node that's already on its way to the depot. Those are found in the graph's index of arriving edges
+ rather than as reverses of leaving ones, since a one-way segment added to the map has no reverse.
+ */
+void DepotRouteCacheImpl::growTree(int depot, bool towardDepot, const EdgeCosts& costs, vector<int>& tree) const
+{
+    vector<double> cost(GRAPH->numNodes(), -1);
+    vector<bool> settled(GRAPH->numNodes(), false);
+    tree.assign(GRAPH->numNodes(), -1);
+    
+    typedef pair<double, int> QueueEntry;
+    priority_queue<QueueEntry, vector<QueueEntry>, greater<QueueEntry>> open;
+    cost[depot] = 0;
+    open.push(QueueEntry(0, depot));
+    while (!open.empty())
+    {
+        int node = open.top().second;
+        open.pop();
+        if (settled[node])
+            continue;
+        settled[node] = true;
+        int first = towardDepot ? GRAPH->firstInEdge(node) : GRAPH->firstEdge(node);
+        int last = towardDepot ? GRAPH->endInEdge(node) : GRAPH->endEdge(node);
+        for (int position = first; position != last; ++position)
+        {
+            int treeEdge = towardDepot ? GRAPH->inEdge(position) : position;
+            int next = towardDepot ? GRAPH->edgeFrom(treeEdge) : GRAPH->edgeTo(treeEdge);
+            if (settled[next]  ||  costs.edgeCost[treeEdge] == CLOSED_COST)
+                continue;
+            double nextCost = cost[node] + costs.edgeCost[treeEdge];
+            if (cost[next] >= 0  &&  cost[next] <= nextCost)
+                continue;
+            cost[next] = nextCost;
+            tree[next] = treeEdge;
+            open.push(QueueEntry(nextCost, next));
+        }
+    }
+}
+
+/*
+ Returns the trees of the depot at a node, marking it as the most recently used, or nullptr if it isn't cached.
+ */
+shared_ptr<const DepotTrees> DepotRouteCacheImpl::find(int node)
+{
+    lock_guard<mutex> lock(m_mutex);
+    auto found = m_depots.find(node);
+    if (found == m_depots.end())
+        return nullptr;
+    m_recent.splice(m_recent.begin(), m_recent, found->second);
+    return *found->second;
+}
+
+/*
+ Drops a cached depot; the caller holds the lock.
+ */
+void DepotRouteCacheImpl::drop(list<shared_ptr<const DepotTrees>>::iterator it)
+{
+    m_stats.bytes -= (*it)->bytes();
+    m_depots.erase((*it)->depot);
+    m_recent.erase(it);
+    m_stats.depots = static_cast<int>(m_depots.size());
+}
+
+/*
+ Edges that only got dearer leave a tree that doesn't use them the best there is, so only depots with a changed edge
+ on a tree are dropped; an edge that got cheaper could belong on any tree.
+ */
+void DepotRouteCacheImpl::costsChanged(const EdgeCostChange& change)
+{
+    lock_guard<mutex> lock(m_mutex);
+    for (auto it = m_recent.begin(); it != m_recent.end(); )
+    {
+        auto next = std::next(it);
+        bool affected = change.cheaper;
+        for (auto edge = change.edges.begin(); !affected  &&  edge != change.edges.end(); ++edge)
+            affected = (*it)->uses(*edge, *GRAPH);
+        if (affected)
+        {
+            drop(it);
+            ++m_stats.invalidations;
+        }
+        it = next;
+    }
+}
+
+//******************** DepotRouteCache functions ******************************
+
+// These functions simply delegate to DepotRouteCacheImpl's functions.
+
+DepotRouteCache::DepotRouteCache(const StreetMap* sm, size_t maxBytes)
+{
+    m_impl = new DepotRouteCacheImpl(sm, maxBytes);
+}
+
+DepotRouteCache::~DepotRouteCache()
+{
+    delete m_impl;
+}
+
+bool DepotRouteCache::addDepot(const GeoCoord& depot)
+{
+    return m_impl->addDepot(depot);
+}
+
+bool DepotRouteCache::findRoute(const GeoCoord& start,
+                                const GeoCoord& end,
+                                vector<int>& edges,
+                                double& totalDistanceTravelled,
+                                DeliveryResult& result)
+{
+    return m_impl->findRoute(start, end, edges, totalDistanceTravelled, result);
+}
+
+DepotCacheStats DepotRouteCache::stats() const
+{
+    return m_impl->stats();
+}
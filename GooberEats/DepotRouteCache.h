@@ -0,0 +1,73 @@
+#ifndef DepotRouteCache_h
+#define DepotRouteCache_h
+
+#include "provided.h"
+#include <vector>
+#include <cstddef>
+
+// DepotRouteCache.h
+
+// Remembers shortest routes out of and back into depots. Every plan starts and ends at its depot, and a depot stays
+// the same all day, so the first time a depot is seen the cache grows two shortest-path trees from it over the map's
+// StreetGraph: one holding the best way from the depot to every node and one holding the best way from every node back
+// to it. After that, a leg that starts or ends at the depot is a walk up one of the trees instead of a search.
+//
+// Each depot costs two ints per node of the map. The cache keeps as many depots as fit under its byte limit and drops
+// the one that was used least recently to make room for another. It can be shared by any number of threads.
+//
+// The trees are grown over the map's current edge costs, so closures and slowdowns (see MapUpdates.h) are routed
+// around. When the costs change, a depot is dropped if a changed edge is on one of its trees; if any edge got cheaper,
+// every depot is dropped, since the cheaper edge could now be on a better route anywhere.
+
+  // Default limit on the memory the trees take up; on a map the size of the one in mapdata.txt, that's room for about
+  // two hundred depots.
+const size_t DEFAULT_DEPOT_CACHE_BYTES = 32 * 1024 * 1024;
+
+struct DepotCacheStats
+{
+    DepotCacheStats()
+     : depots(0), bytes(0), maxBytes(0), hits(0), misses(0), builds(0), evictions(0), invalidations(0)
+    {}
+
+    int depots;         // depots whose trees are cached
+    size_t bytes;       // memory the cached trees take up
+    size_t maxBytes;    // limit on that memory
+    long long hits;     // legs answered from a tree
+    long long misses;   // legs looked up with neither end at a cached depot
+    long long builds;   // pairs of trees grown
+    long long evictions; // depots dropped to make room for others
+    long long invalidations; // depots dropped because the map's costs changed under their trees
+};
+
+class DepotRouteCacheImpl;
+
+class DepotRouteCache
+{
+public:
+      // The map must already be loaded.
+    DepotRouteCache(const StreetMap* sm, size_t maxBytes = DEFAULT_DEPOT_CACHE_BYTES);
+    ~DepotRouteCache();
+
+      // Grows the trees for a depot unless they're cached already, dropping other depots if they have to make room.
+      // Returns false if the depot isn't on the map or its trees alone are bigger than the limit.
+    bool addDepot(const GeoCoord& depot);
+
+      // If start or end is a cached depot, sets result to the outcome of routing from start to end, fills edges (the
+      // ids of the route's edges in the map's StreetGraph) and totalDistanceTravelled like GraphRouter does, and
+      // returns true. Otherwise returns false and leaves everything alone.
+    bool findRoute(const GeoCoord& start,
+                   const GeoCoord& end,
+                   std::vector<int>& edges,
+                   double& totalDistanceTravelled,
+                   DeliveryResult& result);
+
+    DepotCacheStats stats() const;
+
+      // We prevent a DepotRouteCache object from being copied or assigned.
+    DepotRouteCache(const DepotRouteCache&) = delete;
+    DepotRouteCache& operator=(const DepotRouteCache&) = delete;
+private:
+    DepotRouteCacheImpl* m_impl;
+};
+
+#endif /* DepotRouteCache_h */
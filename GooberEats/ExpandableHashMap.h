@@ -1,7 +1,9 @@
 #ifndef ExpandableHashMap_h
 #define ExpandableHashMap_h
 
+#include "MemoryUsage.h"
 #include <list>
+#include <string>
 #include <iostream>
 
 // ExpandableHashMap.h
@@ -28,6 +30,19 @@ public:
         return const_cast<ValueType*>(const_cast<const ExpandableHashMap*>(this)->find(key));
     }
 
+      // Adds the bucket array, the buckets' lists and their nodes to usage as components starting with name, along
+      // with the map's occupancy. pairHeapBytes(key, value) should return the heap memory a key and value hold beyond
+      // themselves (e.g. a vector's elements), which is added as a component too if the map has any pairs.
+    template<typename HeapBytes>
+    void memoryUsage(MemoryUsage& usage, const std::string& name, HeapBytes pairHeapBytes) const;
+    void memoryUsage(MemoryUsage& usage, const std::string& name) const
+    {
+        memoryUsage(usage, name, [](const KeyType&, const ValueType&) { return static_cast<size_t>(0); });
+    }
+
+      // Returns how the pairs are spread over the buckets.
+    HashMapOccupancy occupancy() const;
+
       // C++11 syntax for preventing copying and assignment
     ExpandableHashMap(const ExpandableHashMap&) = delete;
     ExpandableHashMap& operator=(const ExpandableHashMap&) = delete;
@@ -49,17 +64,24 @@ private:
         Pair(KeyType key, ValueType val) : m_key(key), m_value(val) {}
     };
 
+    /*
+     A bucket's list of pairs; its nodes are allocated through a CountingAllocator, so the map knows what they take up.
+     */
+    typedef std::list<Pair, CountingAllocator<Pair>> Bucket;
+
     /*
      Private data members
      */
     // A pointer that a dynamically allocated array of pointers to lists will be created through.
     // In the dynamically allocated array, each element represents a hash map bucket. Each bucket is a
     // pointer that points to a list of pairs that map to the bucket's number (its array index).
-    std::list<Pair>* *m_buckets; //POINTER to ARRAY OF POINTERS to LISTS containing PAIRS
+    Bucket* *m_buckets; //POINTER to ARRAY OF POINTERS to LISTS containing PAIRS
 
     //Externally held information about the hash map
     unsigned int m_numBuckets;
     unsigned int m_numPairs;
+    // What the lists' nodes take up
+    AllocationCount m_nodes;
 
     /*
      Private member functions
@@ -77,9 +99,9 @@ private:
     /// Deallocates each bucket's List from memory, then deallocates hash map array.
     /// @param buckets - pointer to array of buckets
     /// @param numBuckets - number of buckets in the array argument
-    void deleteBucketArray(std::list<Pair>* *buckets, unsigned int numBuckets);
+    void deleteBucketArray(Bucket* *buckets, unsigned int numBuckets);
 
-    /// Potentially temporary function; prints information about hash map.
+    /// Potentially temporary function; prints information about hash map, starting with how full it is.
     void dump() const;
 };
 
@@ -107,6 +129,7 @@ void ExpandableHashMap<KeyType, ValueType>::reset()
     // deletes hash map array and reallocates it with default size
     deleteBucketArray(m_buckets, m_numBuckets);
     initializeBuckets(INIT_BUCKETS);
+    m_numPairs = 0;
 }
 
 template<typename KeyType, typename ValueType>
@@ -123,13 +146,13 @@ void ExpandableHashMap<KeyType, ValueType>::associate(const KeyType& key, const
     int bucketNum = getBucketNumber(key);
     
     // get reference to bucket's pointer to the list that the pair will be sent to
-    std::list<Pair>* &bucket = *(m_buckets + bucketNum); //REFERENCE to POINTER to LIST of PAIRS, constant
+    Bucket* &bucket = *(m_buckets + bucketNum); //REFERENCE to POINTER to LIST of PAIRS, constant
     
     // if there haven't been any pairs in the bucket yet
     if (bucket == nullptr)
     {
         // point bucket pointer to a new list
-        bucket = new std::list<Pair>;
+        bucket = new Bucket(CountingAllocator<Pair>(&m_nodes));
         
         // add passed in pair to bucket's pair list
         // not using new because we want an object not a ptr
@@ -175,7 +198,7 @@ const ValueType* ExpandableHashMap<KeyType, ValueType>::find(const KeyType& key)
     int bucketNum = getBucketNumber(key);
     
     // get reference to bucket's pointer to the list that the key could be in
-    std::list<Pair>* &bucket = *(m_buckets + bucketNum);
+    Bucket* &bucket = *(m_buckets + bucketNum);
     
     // if the bucket doesn't have a list or if it does and it's empty, the key can't be present
     if (bucket == nullptr  ||  bucket->empty())
@@ -209,19 +232,19 @@ void ExpandableHashMap<KeyType, ValueType>::doubleBuckets()
     const unsigned int OLD_NUM_BUCKETS = m_numBuckets;
     
     //allocate new hash map array and save its pointer in a new variable; new array has above size
-    std::list<Pair>* *oldBucketArray = m_buckets;
+    Bucket* *oldBucketArray = m_buckets;
     
     initializeBuckets(m_numBuckets * 2);
     
     // bucketNum and pairToSplice will be used multiple times, so we create it once before the loops
     int bucketNum;
-    typename std::list<Pair>::const_iterator pairToSplice;
+    typename Bucket::const_iterator pairToSplice;
     
     // loop through each bucket in original hash map array
-    for (int b = 0; b < OLD_NUM_BUCKETS; ++b)
+    for (unsigned int b = 0; b < OLD_NUM_BUCKETS; ++b)
     {
         // get reference to current bucket's pointer to its list
-        std::list<Pair>* &currentBucket = *(oldBucketArray + b); //REFERENCE to POINTER to LIST of PAIRS, constant
+        Bucket* &currentBucket = *(oldBucketArray + b); //REFERENCE to POINTER to LIST of PAIRS, constant
         
         // if there's no list of pairs in the bucket to transfer or if the bucket has no pairs in its list,
         // move on to next bucket
@@ -238,11 +261,11 @@ void ExpandableHashMap<KeyType, ValueType>::doubleBuckets()
             bucketNum = getBucketNumber(pairToSplice->m_key);
             
             // get reference to new bucket's pointer to its list (bucket that pair belongs to)
-            std::list<Pair>* &newBucket = *(m_buckets + bucketNum); //REFERENCE to POINTER to LIST of PAIRS, constant
+            Bucket* &newBucket = *(m_buckets + bucketNum); //REFERENCE to POINTER to LIST of PAIRS, constant
             
             // if a list at the new bucket has yet to be created, allocate one
             if (newBucket == nullptr)
-                newBucket = new std::list<Pair>;
+                newBucket = new Bucket(CountingAllocator<Pair>(&m_nodes));
             
             // splice the pair into its appropriate bucket, removing it from the original bucket pair list while keeping
             // existing pointers valid
@@ -258,19 +281,19 @@ template <typename KeyType, typename ValueType>
 void ExpandableHashMap<KeyType, ValueType>::initializeBuckets(unsigned int numBuckets)
 {
     // allocate new hash map array of a specified size
-    m_buckets = new std::list<Pair>* [numBuckets];
+    m_buckets = new Bucket* [numBuckets];
     // set the number of buckets in the array to the number specified
     m_numBuckets = numBuckets;
     // point each bucket's pointer in the hash map array to nullptr
-    for (int i = 0; i < m_numBuckets; ++i)
+    for (unsigned int i = 0; i < m_numBuckets; ++i)
         *(m_buckets + i) = nullptr;
 }
 
 template <typename KeyType, typename ValueType>
-void ExpandableHashMap<KeyType, ValueType>::deleteBucketArray(std::list<Pair>* *buckets, unsigned int numBuckets)
+void ExpandableHashMap<KeyType, ValueType>::deleteBucketArray(Bucket* *buckets, unsigned int numBuckets)
 {
     // deallocate each list that each bucket points to
-    for (int i = 0; i < numBuckets; ++i)
+    for (unsigned int i = 0; i < numBuckets; ++i)
         delete *(buckets + i); //m_buckets[i] is also usable here b/c [] dereferences
     // deallocate the hash map array itself
     delete [] buckets;
@@ -278,21 +301,74 @@ void ExpandableHashMap<KeyType, ValueType>::deleteBucketArray(std::list<Pair>* *
 
 #include <iostream>
 
+template <typename KeyType, typename ValueType>
+template <typename HeapBytes>
+void ExpandableHashMap<KeyType, ValueType>::memoryUsage(MemoryUsage& usage,
+                                                        const std::string& name,
+                                                        HeapBytes pairHeapBytes) const
+{
+    HashMapOccupancy counts = occupancy();
+    usage.add(name + " bucket array", m_numBuckets * sizeof(Bucket*), 1);
+    usage.add(name + " bucket lists", counts.bucketsWithLists * sizeof(Bucket), counts.bucketsWithLists);
+    usage.add(name + " list nodes", m_nodes.bytes, m_nodes.allocations);
+    counts.name = name;
+    usage.hashMaps.push_back(counts);
+    
+    // the keys' and values' own allocations can only be found by visiting every pair
+    if (m_numPairs == 0)
+        return;
+    size_t heapBytes = 0;
+    for (unsigned int i = 0; i < m_numBuckets; ++i)
+    {
+        if (m_buckets[i] != nullptr)
+            for (auto it = m_buckets[i]->begin(); it != m_buckets[i]->end(); ++it)
+                heapBytes += pairHeapBytes(it->m_key, it->m_value);
+    }
+    usage.add(name + " key and value heap", heapBytes, m_numPairs);
+}
+
+template <typename KeyType, typename ValueType>
+HashMapOccupancy ExpandableHashMap<KeyType, ValueType>::occupancy() const
+{
+    HashMapOccupancy counts;
+    counts.numBuckets = m_numBuckets;
+    counts.numPairs = m_numPairs;
+    for (unsigned int i = 0; i < m_numBuckets; ++i)
+    {
+        size_t length = 0;
+        if (m_buckets[i] != nullptr)
+        {
+            ++counts.bucketsWithLists;
+            length = m_buckets[i]->size();
+        }
+        if (length >= counts.chainLengths.size())
+            counts.chainLengths.resize(length + 1, 0);
+        ++counts.chainLengths[length];
+    }
+    return counts;
+}
+
 template <typename KeyType, typename ValueType>
 void ExpandableHashMap<KeyType, ValueType>::dump() const
 {
+    // print how full the map is and how long its chains are
+    HashMapOccupancy counts = occupancy();
+    std::cerr << m_numPairs << " pairs, " << counts.bucketsWithLists << " buckets with lists" << std::endl;
+    for (unsigned int length = 0; length < counts.chainLengths.size(); ++length)
+        std::cerr << counts.chainLengths[length] << " buckets with " << length << " pairs" << std::endl;
+    
     // print number of buckets to cerr
     std::cerr << m_numBuckets << " buckets" << std::endl;
     
     // print information about each bucket and their pairs to cerr
-    for (int i = 0; i < m_numBuckets; ++i)
+    for (unsigned int i = 0; i < m_numBuckets; ++i)
     {
         std::cerr << "Bucket " << i << ": ";
         // if there's a list at the bucket's pointer
         if ((*(m_buckets + i)) != nullptr)
         {
             std::cerr << "size of " << (*(m_buckets + i))->size() << std::endl;
-            typename std::list<Pair>::iterator it;
+            typename Bucket::iterator it;
             for (it = (*(m_buckets + i))->begin(); it != (*(m_buckets + i))->end(); ++it)
                 std::cerr << "\t" << &(it->m_key) << ", " << &(it->m_value) << std::endl;
         }
@@ -0,0 +1,628 @@
+#include "provided.h"
+#include "FleetPlanner.h"
+#include "CompactPlan.h"
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <utility>
+#include <atomic>
+#include <thread>
+#include <cmath>
+#include <functional>
+using namespace std;
+
+// Number of closest deliveries around each delivery that savings and improvement moves are allowed to consider
+const int NUM_NEIGHBORS = 20;
+// Maximum number of passes the inter-route improvement makes over all of the deliveries
+const int MAX_IMPROVEMENT_PASSES = 8;
+// Smallest change in crow distance (in miles) that counts as an improvement
+const double IMPROVEMENT_EPSILON = 1e-9;
+// Approximate number of miles per degree of latitude; used for the flat projection when searching for neighbors
+const double MILES_PER_DEGREE = 69.09;
+
+/*
+ A single vehicle's route during construction and improvement; the depot is implied at both ends of the route.
+ */
+struct FleetRoute
+{
+    // indices of the route's deliveries in visiting order
+    deque<int> stops;
+    // distance as the crow flies from the depot, through every stop, and back to the depot
+    double length;
+};
+
+/*
+ A candidate merge of the routes ending in two deliveries, along with the distance saved by merging them.
+ */
+struct Saving
+{
+    int first;
+    int second;
+    double miles;
+};
+
+/*
+ Definition of FleetPlannerImpl.
+ */
+class FleetPlannerImpl
+{
+public:
+    FleetPlannerImpl(const StreetMap* sm);
+    ~FleetPlannerImpl();
+    DeliveryResult generateFleetPlan(
+        const GeoCoord& depot,
+        const vector<DeliveryRequest>& deliveries,
+        int numVehicles,
+        int vehicleCapacity,
+        double maxRouteMiles,
+        vector<vector<DeliveryCommand>>& vehicleCommands,
+        vector<double>& vehicleDistances,
+        vector<DeliveryRequest>& unassigned) const;
+    DeliveryResult generateCompactFleetPlan(
+        const GeoCoord& depot,
+        const vector<DeliveryRequest>& deliveries,
+        int numVehicles,
+        int vehicleCapacity,
+        double maxRouteMiles,
+        vector<CompactPlan>& vehiclePlans,
+        vector<double>& vehicleDistances,
+        vector<DeliveryRequest>& unassigned) const;
+private:
+    DeliveryPlanner planner;
+    CompactDeliveryPlanner compactPlanner;
+
+    void assignRoutes(const GeoCoord& depot,
+                      const vector<DeliveryRequest>& deliveries,
+                      int numVehicles,
+                      int vehicleCapacity,
+                      double maxRouteMiles,
+                      vector<vector<int>>& routes,
+                      vector<DeliveryRequest>& unassigned) const;
+    DeliveryResult planRoutes(
+        const vector<DeliveryRequest>& deliveries,
+        const vector<vector<int>>& routes,
+        const function<DeliveryResult(int, const vector<DeliveryRequest>&)>& planRoute) const;
+
+    void findNeighbors(const vector<GeoCoord>& points, int numDeliveries, vector<vector<int>>& neighbors) const;
+    void buildSavingsRoutes(const vector<GeoCoord>& points,
+                            const vector<vector<int>>& neighbors,
+                            int capacity,
+                            double maxMiles,
+                            vector<FleetRoute>& routes,
+                            vector<int>& unrouted) const;
+    void insertLeftovers(const vector<GeoCoord>& points,
+                         int capacity,
+                         double maxMiles,
+                         vector<vector<int>>& routes,
+                         vector<double>& lengths,
+                         vector<int>& leftovers) const;
+    void improveRoutes(const vector<GeoCoord>& points,
+                       const vector<vector<int>>& neighbors,
+                       int capacity,
+                       double maxMiles,
+                       vector<vector<int>>& routes,
+                       vector<double>& lengths) const;
+};
+
+/*
+ Constructor for FleetPlannerImpl; passes in the StreetMap argument for the planners every vehicle is planned with.
+ */
+FleetPlannerImpl::FleetPlannerImpl(const StreetMap* sm)
+    : planner(sm), compactPlanner(sm)
+{
+}
+
+/*
+ Destructor for FleetPlannerImpl; class has none of its own dynamically-allocated objects, so this destructor does nothing.
+ */
+FleetPlannerImpl::~FleetPlannerImpl()
+{
+}
+
+/*
+ Returns the crow distance between two points in the points vector; the depot is stored after every delivery.
+ */
+inline
+double crowMiles(const vector<GeoCoord>& points, int a, int b)
+{
+    return distanceEarthMiles(points[a], points[b]);
+}
+
+/*
+ Splits deliveries between vehicles and then plans every vehicle's route with DeliveryPlanner.
+ */
+DeliveryResult FleetPlannerImpl::generateFleetPlan(
+    const GeoCoord& depot,
+    const vector<DeliveryRequest>& deliveries,
+    int numVehicles,
+    int vehicleCapacity,
+    double maxRouteMiles,
+    vector<vector<DeliveryCommand>>& vehicleCommands,
+    vector<double>& vehicleDistances,
+    vector<DeliveryRequest>& unassigned) const
+{
+    // every driver gets an entry in the output vectors, even if they end up with nothing to deliver
+    vehicleCommands.assign(numVehicles > 0 ? numVehicles : 0, vector<DeliveryCommand>());
+    vehicleDistances.assign(vehicleCommands.size(), 0);
+
+    vector<vector<int>> routes;
+    assignRoutes(depot, deliveries, numVehicles, vehicleCapacity, maxRouteMiles, routes, unassigned);
+    return planRoutes(deliveries, routes, [&](int r, const vector<DeliveryRequest>& vehicleDeliveries)
+    {
+        return planner.generateDeliveryPlan(depot, vehicleDeliveries, vehicleCommands[r], vehicleDistances[r]);
+    });
+}
+
+/*
+ Splits deliveries between vehicles exactly like the DeliveryCommand version does, planning every vehicle's route
+ with CompactDeliveryPlanner instead.
+ */
+DeliveryResult FleetPlannerImpl::generateCompactFleetPlan(
+    const GeoCoord& depot,
+    const vector<DeliveryRequest>& deliveries,
+    int numVehicles,
+    int vehicleCapacity,
+    double maxRouteMiles,
+    vector<CompactPlan>& vehiclePlans,
+    vector<double>& vehicleDistances,
+    vector<DeliveryRequest>& unassigned) const
+{
+    vehiclePlans.assign(numVehicles > 0 ? numVehicles : 0, CompactPlan());
+    vehicleDistances.assign(vehiclePlans.size(), 0);
+
+    vector<vector<int>> routes;
+    assignRoutes(depot, deliveries, numVehicles, vehicleCapacity, maxRouteMiles, routes, unassigned);
+    return planRoutes(deliveries, routes, [&](int r, const vector<DeliveryRequest>& vehicleDeliveries)
+    {
+        return compactPlanner.generateDeliveryPlan(depot, vehicleDeliveries, vehiclePlans[r], vehicleDistances[r]);
+    });
+}
+
+/*
+ Splits deliveries between vehicles with the Clarke-Wright savings heuristic and improves the split with relocate and
+ swap moves between routes. routes gets the indices of every vehicle's deliveries in visiting order.
+ */
+void FleetPlannerImpl::assignRoutes(const GeoCoord& depot,
+                                    const vector<DeliveryRequest>& deliveries,
+                                    int numVehicles,
+                                    int vehicleCapacity,
+                                    double maxRouteMiles,
+                                    vector<vector<int>>& routes,
+                                    vector<DeliveryRequest>& unassigned) const
+{
+    const int NUM_DELIVERIES = static_cast<int>(deliveries.size());
+    routes.clear();
+    unassigned.clear();
+
+    // without any drivers, nothing can be delivered
+    if (numVehicles <= 0)
+    {
+        unassigned = deliveries;
+        return;
+    }
+    // copy every delivery's location into one vector with the depot at the end so that indices can be used for both
+    vector<GeoCoord> points;
+    points.reserve(NUM_DELIVERIES + 1);
+    for (auto it = deliveries.begin(); it != deliveries.end(); ++it)
+        points.push_back(it->location);
+    points.push_back(depot);
+
+    // build the routes, keeping track of deliveries that can't be placed on any route
+    vector<vector<int>> neighbors;
+    vector<FleetRoute> savingsRoutes;
+    vector<int> leftovers;
+    findNeighbors(points, NUM_DELIVERIES, neighbors);
+    buildSavingsRoutes(points, neighbors, vehicleCapacity, maxRouteMiles, savingsRoutes, leftovers);
+
+    // there may be more routes than drivers; drivers take the routes with the most deliveries first
+    sort(savingsRoutes.begin(), savingsRoutes.end(), [](const FleetRoute& lhs, const FleetRoute& rhs)
+    {
+        if (lhs.stops.size() != rhs.stops.size())
+            return lhs.stops.size() > rhs.stops.size();
+        return lhs.length < rhs.length;
+    });
+    vector<double> lengths;
+    for (auto it = savingsRoutes.begin(); it != savingsRoutes.end(); ++it)
+    {
+        if (static_cast<int>(routes.size()) < numVehicles)
+        {
+            routes.push_back(vector<int>(it->stops.begin(), it->stops.end()));
+            lengths.push_back(it->length);
+        }
+        else
+            leftovers.insert(leftovers.end(), it->stops.begin(), it->stops.end());
+    }
+
+    // squeeze deliveries from routes that didn't get a driver into the routes that did, then shorten every route
+    insertLeftovers(points, vehicleCapacity, maxRouteMiles, routes, lengths, leftovers);
+    improveRoutes(points, neighbors, vehicleCapacity, maxRouteMiles, routes, lengths);
+    for (auto it = leftovers.begin(); it != leftovers.end(); ++it)
+        unassigned.push_back(deliveries[*it]);
+}
+
+/*
+ Plans every vehicle's route with planRoute, which is given the vehicle's index and its deliveries in visiting order.
+ Routes are independent, so they're planned in parallel; the first failure, if there is one, is returned.
+ */
+DeliveryResult FleetPlannerImpl::planRoutes(
+    const vector<DeliveryRequest>& deliveries,
+    const vector<vector<int>>& routes,
+    const function<DeliveryResult(int, const vector<DeliveryRequest>&)>& planRoute) const
+{
+    const int NUM_ROUTES = static_cast<int>(routes.size());
+    vector<DeliveryResult> results(NUM_ROUTES, DELIVERY_SUCCESS);
+    atomic<int> nextRoute(0);
+    auto planNextRoutes = [&]()
+    {
+        for (int r = nextRoute++; r < NUM_ROUTES; r = nextRoute++)
+        {
+            // empty routes have nothing to plan (and their driver stays at the depot)
+            if (routes[r].empty())
+                continue;
+            vector<DeliveryRequest> vehicleDeliveries;
+            vehicleDeliveries.reserve(routes[r].size());
+            for (auto it = routes[r].begin(); it != routes[r].end(); ++it)
+                vehicleDeliveries.push_back(deliveries[*it]);
+            results[r] = planRoute(r, vehicleDeliveries);
+        }
+    };
+    int numWorkers = min(static_cast<int>(thread::hardware_concurrency()), NUM_ROUTES);
+    vector<thread> workers;
+    for (int i = 1; i < numWorkers; ++i)
+        workers.push_back(thread(planNextRoutes));
+    planNextRoutes();
+    for (auto it = workers.begin(); it != workers.end(); ++it)
+        it->join();
+
+    // report the first failure, if there was one
+    for (auto it = results.begin(); it != results.end(); ++it)
+        if (*it != DELIVERY_SUCCESS)
+            return *it;
+    return DELIVERY_SUCCESS;
+}
+
+/*
+ Fills neighbors with the indices of the NUM_NEIGHBORS closest deliveries to each delivery, closest first.
+ Candidates are compared on a flat projection around the depot, which is accurate enough at city scale.
+ */
+void FleetPlannerImpl::findNeighbors(const vector<GeoCoord>& points, int numDeliveries, vector<vector<int>>& neighbors) const
+{
+    // project every delivery onto a flat grid measured in miles
+    const double LON_SCALE = MILES_PER_DEGREE * cos(deg2rad(points[numDeliveries].latitude));
+    vector<double> x(numDeliveries);
+    vector<double> y(numDeliveries);
+    for (int i = 0; i < numDeliveries; ++i)
+    {
+        x[i] = points[i].longitude * LON_SCALE;
+        y[i] = points[i].latitude * MILES_PER_DEGREE;
+    }
+
+    // for each delivery, partially sort the others by squared distance and keep the closest ones
+    const int NUM_KEPT = min(NUM_NEIGHBORS, numDeliveries - 1);
+    neighbors.assign(numDeliveries, vector<int>());
+    vector<pair<double, int>> candidates;
+    candidates.reserve(numDeliveries);
+    for (int i = 0; i < numDeliveries; ++i)
+    {
+        candidates.clear();
+        for (int j = 0; j < numDeliveries; ++j)
+            if (j != i)
+                candidates.push_back(make_pair((x[i] - x[j]) * (x[i] - x[j]) + (y[i] - y[j]) * (y[i] - y[j]), j));
+        partial_sort(candidates.begin(), candidates.begin() + NUM_KEPT, candidates.end());
+        neighbors[i].reserve(NUM_KEPT);
+        for (int k = 0; k < NUM_KEPT; ++k)
+            neighbors[i].push_back(candidates[k].second);
+    }
+}
+
+/*
+ Builds routes with the Clarke-Wright savings heuristic: every delivery starts on its own route, and the two routes whose
+ ends are closest relative to the depot are joined for as long as the joined route stays within the vehicle limits.
+ Only pairs of neighboring deliveries are considered, which keeps the savings list linear in the number of deliveries.
+ */
+void FleetPlannerImpl::buildSavingsRoutes(const vector<GeoCoord>& points,
+                                          const vector<vector<int>>& neighbors,
+                                          int capacity,
+                                          double maxMiles,
+                                          vector<FleetRoute>& routes,
+                                          vector<int>& unrouted) const
+{
+    const int NUM_DELIVERIES = static_cast<int>(neighbors.size());
+    const int DEPOT = NUM_DELIVERIES;
+
+    // every delivery begins on its own route, unless going there and back already breaks the route length limit
+    vector<FleetRoute> working(NUM_DELIVERIES);
+    vector<int> routeOf(NUM_DELIVERIES, -1);
+    vector<double> depotMiles(NUM_DELIVERIES);
+    for (int i = 0; i < NUM_DELIVERIES; ++i)
+    {
+        depotMiles[i] = crowMiles(points, i, DEPOT);
+        if (maxMiles > 0  &&  2 * depotMiles[i] > maxMiles)
+        {
+            unrouted.push_back(i);
+            continue;
+        }
+        working[i].stops.push_back(i);
+        working[i].length = 2 * depotMiles[i];
+        routeOf[i] = i;
+    }
+
+    // compute the savings of every neighboring pair and process them from largest to smallest
+    vector<Saving> savings;
+    savings.reserve(NUM_DELIVERIES * NUM_NEIGHBORS);
+    for (int i = 0; i < NUM_DELIVERIES; ++i)
+        for (auto it = neighbors[i].begin(); it != neighbors[i].end(); ++it)
+            if (i < *it)
+                savings.push_back(Saving{i, *it, depotMiles[i] + depotMiles[*it] - crowMiles(points, i, *it)});
+    sort(savings.begin(), savings.end(), [](const Saving& lhs, const Saving& rhs)
+    {
+        return lhs.miles > rhs.miles;
+    });
+
+    for (auto it = savings.begin(); it != savings.end(); ++it)
+    {
+        int a = routeOf[it->first];
+        int b = routeOf[it->second];
+        // both deliveries must be routed, on different routes, and at an end of their route to be joined
+        if (a < 0  ||  b < 0  ||  a == b)
+            continue;
+        FleetRoute& routeA = working[a];
+        FleetRoute& routeB = working[b];
+        bool firstAtFront = routeA.stops.front() == it->first;
+        bool firstAtBack = routeA.stops.back() == it->first;
+        bool secondAtFront = routeB.stops.front() == it->second;
+        bool secondAtBack = routeB.stops.back() == it->second;
+        if ((!firstAtFront && !firstAtBack)  ||  (!secondAtFront && !secondAtBack))
+            continue;
+
+        // the joined route has to fit in a single vehicle
+        double joinedLength = routeA.length + routeB.length - it->miles;
+        if (capacity > 0  &&  static_cast<int>(routeA.stops.size() + routeB.stops.size()) > capacity)
+            continue;
+        if (maxMiles > 0  &&  joinedLength > maxMiles)
+            continue;
+
+        // orient the routes so that one ends in its delivery and the other starts with its delivery,
+            // reversing whichever route is shorter when only a reversal will do
+        bool appendB = firstAtBack  &&  secondAtFront;
+        if (!appendB  &&  !(secondAtBack  &&  firstAtFront))
+        {
+            if (routeA.stops.size() < routeB.stops.size())
+                std::reverse(routeA.stops.begin(), routeA.stops.end());
+            else
+                std::reverse(routeB.stops.begin(), routeB.stops.end());
+            appendB = routeA.stops.back() == it->first  &&  routeB.stops.front() == it->second;
+        }
+
+        // move the smaller route's deliveries into the larger route so that each delivery moves O(log n) times
+        FleetRoute* kept = &routeA;
+        FleetRoute* merged = &routeB;
+        int keptIndex = a;
+        if (routeA.stops.size() < routeB.stops.size())
+        {
+            kept = &routeB;
+            merged = &routeA;
+            keptIndex = b;
+        }
+        // appendB means routeA comes first; otherwise routeB comes first
+        bool mergedGoesAfter = (kept == &routeA) == appendB;
+        if (mergedGoesAfter)
+            kept->stops.insert(kept->stops.end(), merged->stops.begin(), merged->stops.end());
+        else
+            kept->stops.insert(kept->stops.begin(), merged->stops.begin(), merged->stops.end());
+        for (auto stop = merged->stops.begin(); stop != merged->stops.end(); ++stop)
+            routeOf[*stop] = keptIndex;
+        kept->length = joinedLength;
+        merged->stops.clear();
+    }
+
+    // hand back every route that still has deliveries on it
+    for (auto it = working.begin(); it != working.end(); ++it)
+        if (!it->stops.empty())
+            routes.push_back(*it);
+}
+
+/*
+ Inserts each leftover delivery at the cheapest position across all routes that still have room for it; deliveries
+ that fit nowhere remain in leftovers.
+ */
+void FleetPlannerImpl::insertLeftovers(const vector<GeoCoord>& points,
+                                       int capacity,
+                                       double maxMiles,
+                                       vector<vector<int>>& routes,
+                                       vector<double>& lengths,
+                                       vector<int>& leftovers) const
+{
+    const int DEPOT = static_cast<int>(points.size()) - 1;
+    vector<int> stillLeft;
+    for (auto it = leftovers.begin(); it != leftovers.end(); ++it)
+    {
+        int bestRoute = -1;
+        int bestPosition = 0;
+        double bestCost = 0;
+        for (int r = 0; r < static_cast<int>(routes.size()); ++r)
+        {
+            if (capacity > 0  &&  static_cast<int>(routes[r].size()) >= capacity)
+                continue;
+            // try every gap in the route, including the gaps next to the depot
+            for (int p = 0; p <= static_cast<int>(routes[r].size()); ++p)
+            {
+                int before = p > 0 ? routes[r][p - 1] : DEPOT;
+                int after = p < static_cast<int>(routes[r].size()) ? routes[r][p] : DEPOT;
+                double cost = crowMiles(points, before, *it) + crowMiles(points, *it, after)
+                              - crowMiles(points, before, after);
+                if (maxMiles > 0  &&  lengths[r] + cost > maxMiles)
+                    continue;
+                if (bestRoute < 0  ||  cost < bestCost)
+                {
+                    bestRoute = r;
+                    bestPosition = p;
+                    bestCost = cost;
+                }
+            }
+        }
+        if (bestRoute < 0)
+        {
+            stillLeft.push_back(*it);
+            continue;
+        }
+        routes[bestRoute].insert(routes[bestRoute].begin() + bestPosition, *it);
+        lengths[bestRoute] += bestCost;
+    }
+    leftovers = stillLeft;
+}
+
+/*
+ Shortens routes with moves between them: relocating a delivery next to one of its neighbors on another route, and
+ swapping a delivery with one of its neighbors on another route. Passes are repeated until none of them helps.
+ */
+void FleetPlannerImpl::improveRoutes(const vector<GeoCoord>& points,
+                                     const vector<vector<int>>& neighbors,
+                                     int capacity,
+                                     double maxMiles,
+                                     vector<vector<int>>& routes,
+                                     vector<double>& lengths) const
+{
+    const int NUM_DELIVERIES = static_cast<int>(neighbors.size());
+    const int DEPOT = NUM_DELIVERIES;
+
+    // keep track of which route and which position on it each delivery is at; -1 means unrouted
+    vector<int> routeOf(NUM_DELIVERIES, -1);
+    vector<int> position(NUM_DELIVERIES, 0);
+    auto reindex = [&](int r)
+    {
+        for (int p = 0; p < static_cast<int>(routes[r].size()); ++p)
+        {
+            routeOf[routes[r][p]] = r;
+            position[routes[r][p]] = p;
+        }
+    };
+    for (int r = 0; r < static_cast<int>(routes.size()); ++r)
+        reindex(r);
+    // the stops before and after a delivery, treating the depot as both ends of every route
+    auto previousStop = [&](int i)
+    {
+        return position[i] > 0 ? routes[routeOf[i]][position[i] - 1] : DEPOT;
+    };
+    auto nextStop = [&](int i)
+    {
+        const vector<int>& route = routes[routeOf[i]];
+        return position[i] + 1 < static_cast<int>(route.size()) ? route[position[i] + 1] : DEPOT;
+    };
+
+    bool improved = true;
+    for (int pass = 0; pass < MAX_IMPROVEMENT_PASSES  &&  improved; ++pass)
+    {
+        improved = false;
+        for (int i = 0; i < NUM_DELIVERIES; ++i)
+        {
+            if (routeOf[i] < 0)
+                continue;
+            for (auto it = neighbors[i].begin(); it != neighbors[i].end(); ++it)
+            {
+                int j = *it;
+                int r = routeOf[i];
+                int s = routeOf[j];
+                if (s < 0  ||  s == r)
+                    continue;
+                int prevI = previousStop(i);
+                int nextI = nextStop(i);
+                int prevJ = previousStop(j);
+                int nextJ = nextStop(j);
+                double removal = crowMiles(points, prevI, i) + crowMiles(points, i, nextI)
+                                 - crowMiles(points, prevI, nextI);
+
+                // relocate: move i into s, right before or right after j
+                if (capacity <= 0  ||  static_cast<int>(routes[s].size()) < capacity)
+                {
+                    double beforeJ = crowMiles(points, prevJ, i) + crowMiles(points, i, j) - crowMiles(points, prevJ, j);
+                    double afterJ = crowMiles(points, j, i) + crowMiles(points, i, nextJ) - crowMiles(points, j, nextJ);
+                    double insertion = min(beforeJ, afterJ);
+                    if (insertion - removal < -IMPROVEMENT_EPSILON  &&
+                        (maxMiles <= 0  ||  lengths[s] + insertion <= maxMiles))
+                    {
+                        int insertAt = beforeJ <= afterJ ? position[j] : position[j] + 1;
+                        routes[r].erase(routes[r].begin() + position[i]);
+                        routes[s].insert(routes[s].begin() + insertAt, i);
+                        lengths[r] -= removal;
+                        lengths[s] += insertion;
+                        reindex(r);
+                        reindex(s);
+                        improved = true;
+                        continue;
+                    }
+                }
+
+                // swap: exchange i and j between their routes
+                double deltaR = crowMiles(points, prevI, j) + crowMiles(points, j, nextI)
+                                - crowMiles(points, prevI, i) - crowMiles(points, i, nextI);
+                double deltaS = crowMiles(points, prevJ, i) + crowMiles(points, i, nextJ)
+                                - crowMiles(points, prevJ, j) - crowMiles(points, j, nextJ);
+                if (deltaR + deltaS < -IMPROVEMENT_EPSILON  &&
+                    (maxMiles <= 0  ||  (lengths[r] + deltaR <= maxMiles  &&  lengths[s] + deltaS <= maxMiles)))
+                {
+                    swap(routes[r][position[i]], routes[s][position[j]]);
+                    swap(routeOf[i], routeOf[j]);
+                    swap(position[i], position[j]);
+                    lengths[r] += deltaR;
+                    lengths[s] += deltaS;
+                    improved = true;
+                }
+            }
+        }
+    }
+}
+
+//******************** FleetPlanner functions *********************************
+
+// These functions simply delegate to FleetPlannerImpl's functions.
+
+FleetPlanner::FleetPlanner(const StreetMap* sm)
+{
+    m_impl = new FleetPlannerImpl(sm);
+}
+
+FleetPlanner::~FleetPlanner()
+{
+    delete m_impl;
+}
+
+DeliveryResult FleetPlanner::generateFleetPlan(
+    const GeoCoord& depot,
+    const vector<DeliveryRequest>& deliveries,
+    int numVehicles,
+    int vehicleCapacity,
+    double maxRouteMiles,
+    vector<vector<DeliveryCommand>>& vehicleCommands,
+    vector<double>& vehicleDistances,
+    vector<DeliveryRequest>& unassigned) const
+{
+    return m_impl->generateFleetPlan(depot,
+                                     deliveries,
+                                     numVehicles,
+                                     vehicleCapacity,
+                                     maxRouteMiles,
+                                     vehicleCommands,
+                                     vehicleDistances,
+                                     unassigned);
+}
+
+DeliveryResult FleetPlanner::generateFleetPlan(
+    const GeoCoord& depot,
+    const vector<DeliveryRequest>& deliveries,
+    int numVehicles,
+    int vehicleCapacity,
+    double maxRouteMiles,
+    vector<CompactPlan>& vehiclePlans,
+    vector<double>& vehicleDistances,
+    vector<DeliveryRequest>& unassigned) const
+{
+    return m_impl->generateCompactFleetPlan(depot,
+                                            deliveries,
+                                            numVehicles,
+                                            vehicleCapacity,
+                                            maxRouteMiles,
+                                            vehiclePlans,
+                                            vehicleDistances,
+                                            unassigned);
+}
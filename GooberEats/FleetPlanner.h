@@ -0,0 +1,54 @@
+#ifndef FleetPlanner_h
+#define FleetPlanner_h
+
+#include "provided.h"
+#include "CompactPlan.h"
+#include <vector>
+
+// FleetPlanner.h
+
+// Plans deliveries for a fleet of drivers that all leave from and return to the same depot. Deliveries are split
+// between the vehicles first, then every vehicle's share is planned with the existing DeliveryPlanner.
+
+class FleetPlannerImpl;
+
+class FleetPlanner
+{
+public:
+    FleetPlanner(const StreetMap* sm);
+    ~FleetPlanner();
+
+      // Splits the deliveries between numVehicles drivers and plans each driver's route.
+      // Every delivery takes up one unit of a vehicle's capacity; a vehicle's route (as the crow flies, depot to depot)
+      // may not be longer than maxRouteMiles. A capacity or route limit of zero or less leaves vehicles unconstrained
+      // in that respect. vehicleCommands and vehicleDistances get one entry per driver (idle drivers get no commands),
+      // and deliveries that no driver could take are passed back through unassigned.
+    DeliveryResult generateFleetPlan(
+        const GeoCoord& depot,
+        const std::vector<DeliveryRequest>& deliveries,
+        int numVehicles,
+        int vehicleCapacity,
+        double maxRouteMiles,
+        std::vector<std::vector<DeliveryCommand>>& vehicleCommands,
+        std::vector<double>& vehicleDistances,
+        std::vector<DeliveryRequest>& unassigned) const;
+
+      // Same as above, with every driver's commands stored as a CompactPlan.
+    DeliveryResult generateFleetPlan(
+        const GeoCoord& depot,
+        const std::vector<DeliveryRequest>& deliveries,
+        int numVehicles,
+        int vehicleCapacity,
+        double maxRouteMiles,
+        std::vector<CompactPlan>& vehiclePlans,
+        std::vector<double>& vehicleDistances,
+        std::vector<DeliveryRequest>& unassigned) const;
+
+      // We prevent a FleetPlanner object from being copied or assigned.
+    FleetPlanner(const FleetPlanner&) = delete;
+    FleetPlanner& operator=(const FleetPlanner&) = delete;
+private:
+    FleetPlannerImpl* m_impl;
+};
+
+#endif /* FleetPlanner_h */
@@ -0,0 +1,280 @@
+#include "provided.h"
+#include "GraphRouter.h"
+#include "StreetGraph.h"
+#include <vector>
+#include <queue>
+#include <functional>
+#include <utility>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+using namespace std;
+
+/*
+ Per-thread arrays for the search, sized for the biggest graph searched so far, with every entry stamped with the
+ search that last wrote it (like the turn-aware router's) so nothing has to be cleared between searches.
+ */
+struct NodeSearchScratch
+{
+    vector<double> cost;
+    // the run of chain edges (positions from parentBegin up to parentEnd in the graph's chains) a node was reached by;
+    // parentBegin is -1 for the start
+    vector<int> parentBegin;
+    vector<int> parentEnd;
+    vector<unsigned int> reached;
+    vector<unsigned int> settled;
+    unsigned int search = 0;
+    
+    void begin(int numNodes)
+    {
+        if (static_cast<int>(cost.size()) < numNodes)
+        {
+            cost.resize(numNodes);
+            parentBegin.resize(numNodes);
+            parentEnd.resize(numNodes);
+            reached.resize(numNodes, 0);
+            settled.resize(numNodes, 0);
+        }
+        // after four billion searches the stamps wrap around, so the old ones have to be wiped
+        if (++search == 0)
+        {
+            fill(reached.begin(), reached.end(), 0);
+            fill(settled.begin(), settled.end(), 0);
+            search = 1;
+        }
+    }
+};
+
+/*
+ Definition of GraphRouterImpl.
+ */
+class GraphRouterImpl
+{
+public:
+    GraphRouterImpl(const StreetMap* sm);
+    GraphRouterImpl(const StreetGraph* graph);
+    ~GraphRouterImpl();
+    DeliveryResult generatePointToPointRoute(
+        const GeoCoord& start,
+        const GeoCoord& end,
+        vector<int>& edges,
+        double& totalDistanceTravelled,
+        SearchStats& stats) const;
+private:
+    const StreetGraph* GRAPH;
+    
+    DeliveryResult search(int startNode, int endNode, const GeoCoord& end, const EdgeCosts& costs, vector<int>& edges,
+                          double& totalDistanceTravelled, SearchStats& stats) const;
+};
+
+GraphRouterImpl::GraphRouterImpl(const StreetMap* sm)
+    : GRAPH(getStreetGraph(sm))
+{
+}
+
+GraphRouterImpl::GraphRouterImpl(const StreetGraph* graph)
+    : GRAPH(graph)
+{
+}
+
+GraphRouterImpl::~GraphRouterImpl()
+{
+}
+
+/*
+ Times the search and adds its stats to this thread's histograms; routes between components that can't reach each
+ other are turned down without one. The search keeps the costs that were latest when it started, even if new ones
+ are published while it runs.
+ */
+DeliveryResult GraphRouterImpl::generatePointToPointRoute(
+        const GeoCoord& start,
+        const GeoCoord& end,
+        vector<int>& edges,
+        double& totalDistanceTravelled,
+        SearchStats& stats) const
+{
+    stats = SearchStats();
+    edges.clear();
+    totalDistanceTravelled = 0;
+    int startNode = GRAPH->findNode(start);
+    int endNode = GRAPH->findNode(end);
+    if (startNode == NO_NODE  ||  endNode == NO_NODE)
+        return BAD_COORD;
+    if (startNode == endNode)
+        return DELIVERY_SUCCESS;
+    // no route joins their components, which a search would only find out by exploring everything it can reach
+    if (!GRAPH->mayReach(startNode, endNode))
+        return NO_ROUTE;
+    
+    shared_ptr<const EdgeCosts> costs = GRAPH->costs();
+    if (!SEARCH_STATS)
+        return search(startNode, endNode, end, *costs, edges, totalDistanceTravelled, stats);
+    auto startTime = chrono::steady_clock::now();
+    DeliveryResult result = search(startNode, endNode, end, *costs, edges, totalDistanceTravelled, stats);
+    stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+    recordSearch(SearchKind::GRAPH, stats);
+    return result;
+}
+
+/*
+ Finds a route with A* over the graph's junctions, taking whole chains (see StreetGraph.h) as its steps: the cost of a
+ node is the cost of the edges driven to reach it and the heuristic is the crow distance from it to the destination.
+ An edge never costs less than its length, so the heuristic never overestimates and never drops by more than the cost
+ of a chain, and a node's first entry taken off the queue has its lowest cost and later entries can be skipped. Chains
+ with a closed edge on them cost CLOSED_COST and are never taken.
+
+ The only nodes partway along a chain that the search visits are the start and the destination: the start's edges are
+ followed to the ends of their chains, and a chain that passes through the destination reaches it partway along too.
+ */
+DeliveryResult GraphRouterImpl::search(int startNode, int endNode, const GeoCoord& end, const EdgeCosts& costs,
+                                       vector<int>& edges, double& totalDistanceTravelled, SearchStats& stats) const
+{
+    static thread_local NodeSearchScratch scratch;
+    scratch.begin(GRAPH->numNodes());
+    const unsigned int SEARCH = scratch.search;
+    
+    // the edges arriving at the destination if it's partway along a chain; they're the reverses of the two leaving it
+    int endArrivals[2] = { -1, -1 };
+    if (!GRAPH->isJunction(endNode))
+    {
+        endArrivals[0] = GRAPH->reverseEdge(GRAPH->firstEdge(endNode));
+        endArrivals[1] = GRAPH->reverseEdge(GRAPH->firstEdge(endNode) + 1);
+    }
+    
+    // queue of (cost plus heuristic, node) with the smallest first
+    typedef pair<double, int> QueueEntry;
+    priority_queue<QueueEntry, vector<QueueEntry>, greater<QueueEntry>> open;
+    scratch.reached[startNode] = SEARCH;
+    scratch.cost[startNode] = 0;
+    scratch.parentBegin[startNode] = -1;
+    open.push(QueueEntry(distanceEarthMiles(GRAPH->coord(startNode), end), startNode));
+    if (SEARCH_STATS)
+        stats.heapPushes = stats.peakQueueSize = 1;
+    
+    // reaches next from node by the chain edges at positions from first up to last, if that's cheaper than before
+    auto relax = [&](int node, int first, int last, int next, double runCost) {
+        if (scratch.settled[next] == SEARCH  ||  runCost == CLOSED_COST)
+            return;
+        double cost = scratch.cost[node] + runCost;
+        if (scratch.reached[next] == SEARCH  &&  scratch.cost[next] <= cost)
+            return;
+        scratch.reached[next] = SEARCH;
+        scratch.cost[next] = cost;
+        scratch.parentBegin[next] = first;
+        scratch.parentEnd[next] = last;
+        open.push(QueueEntry(cost + distanceEarthMiles(GRAPH->coord(next), end), next));
+        if (SEARCH_STATS)
+        {
+            ++stats.edgesRelaxed;
+            ++stats.heapPushes;
+            stats.peakQueueSize = max(stats.peakQueueSize, static_cast<long long>(open.size()));
+        }
+    };
+    
+    // follows a chain from node, starting at position first, to its end, and to the destination if it passes through
+    auto relaxChain = [&](int node, int chain, int first, double chainCost) {
+        relax(node, first, GRAPH->chainEnd(chain), GRAPH->chainTo(chain), chainCost);
+        for (int arrival : endArrivals)
+        {
+            if (arrival == -1  ||  GRAPH->edgeChain(arrival) != chain  ||  GRAPH->edgeChainPosition(arrival) < first)
+                continue;
+            double partCost = 0;
+            for (int position = first; position <= GRAPH->edgeChainPosition(arrival); ++position)
+                partCost += costs.edgeCost[GRAPH->chainEdge(position)];
+            relax(node, first, GRAPH->edgeChainPosition(arrival) + 1, endNode, partCost);
+        }
+    };
+    
+    bool found = false;
+    while (!open.empty())
+    {
+        int node = open.top().second;
+        open.pop();
+        if (SEARCH_STATS)
+            ++stats.heapPops;
+        if (scratch.settled[node] == SEARCH)
+        {
+            if (SEARCH_STATS)
+                ++stats.duplicatePops;
+            continue;
+        }
+        scratch.settled[node] = SEARCH;
+        if (SEARCH_STATS)
+            ++stats.nodesSettled;
+        if (node == endNode)
+        {
+            found = true;
+            break;
+        }
+        
+        if (GRAPH->isJunction(node))
+        {
+            for (int chain = GRAPH->firstChain(node); chain != GRAPH->endChain(node); ++chain)
+                relaxChain(node, chain, GRAPH->chainBegin(chain), costs.chainCost[chain]);
+            continue;
+        }
+        // only the start can be partway along a chain; each of its edges is the rest of a chain from there on
+        for (int edge = GRAPH->firstEdge(node); edge != GRAPH->endEdge(node); ++edge)
+        {
+            int chain = GRAPH->edgeChain(edge);
+            double restCost = 0;
+            for (int position = GRAPH->edgeChainPosition(edge); position != GRAPH->chainEnd(chain); ++position)
+                restCost += costs.edgeCost[GRAPH->chainEdge(position)];
+            relaxChain(node, chain, GRAPH->edgeChainPosition(edge), restCost);
+        }
+    }
+    if (!found)
+        return NO_ROUTE;
+    
+    // walk back from the destination a run of chain edges at a time, then put the edges in driving order
+    for (int node = endNode; scratch.parentBegin[node] != -1; )
+    {
+        for (int position = scratch.parentEnd[node] - 1; position >= scratch.parentBegin[node]; --position)
+        {
+            edges.push_back(GRAPH->chainEdge(position));
+            totalDistanceTravelled += GRAPH->edgeMiles(GRAPH->chainEdge(position));
+        }
+        node = GRAPH->edgeFrom(GRAPH->chainEdge(scratch.parentBegin[node]));
+    }
+    reverse(edges.begin(), edges.end());
+    return DELIVERY_SUCCESS;
+}
+
+//******************** GraphRouter functions **********************************
+
+// These functions simply delegate to GraphRouterImpl's functions.
+
+GraphRouter::GraphRouter(const StreetMap* sm)
+{
+    m_impl = new GraphRouterImpl(sm);
+}
+
+GraphRouter::GraphRouter(const StreetGraph* graph)
+{
+    m_impl = new GraphRouterImpl(graph);
+}
+
+GraphRouter::~GraphRouter()
+{
+    delete m_impl;
+}
+
+DeliveryResult GraphRouter::generatePointToPointRoute(
+        const GeoCoord& start,
+        const GeoCoord& end,
+        vector<int>& edges,
+        double& totalDistanceTravelled) const
+{
+    SearchStats stats;
+    return m_impl->generatePointToPointRoute(start, end, edges, totalDistanceTravelled, stats);
+}
+
+DeliveryResult GraphRouter::generatePointToPointRoute(
+        const GeoCoord& start,
+        const GeoCoord& end,
+        vector<int>& edges,
+        double& totalDistanceTravelled,
+        SearchStats& stats) const
+{
+    return m_impl->generatePointToPointRoute(start, end, edges, totalDistanceTravelled, stats);
+}
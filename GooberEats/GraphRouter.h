@@ -0,0 +1,51 @@
+#ifndef GraphRouter_h
+#define GraphRouter_h
+
+#include "provided.h"
+#include "SearchStats.h"
+#include <vector>
+
+// GraphRouter.h
+
+// Finds the shortest route between two coordinates over the map's StreetGraph (see StreetGraph.h) and gives it as the
+// ids of the edges it's made of, in driving order. A route is a few bytes per step in one contiguous array instead of a
+// linked list of StreetSegments with a copy of a street name apiece, so planners can keep and walk routes cheaply and
+// only build segments for the callers that want them (PointToPointRouter is one).
+
+class GraphRouterImpl;
+class StreetGraph;
+
+class GraphRouter
+{
+public:
+      // The map must already be loaded.
+    GraphRouter(const StreetMap* sm);
+      // Routes over a graph that isn't a map's, e.g. one loaded with its nodes in another order; the graph must outlive
+      // the router.
+    GraphRouter(const StreetGraph* graph);
+    ~GraphRouter();
+
+      // Finds the shortest route and its length in miles; edges is emptied first, and stays empty if the start and end
+      // are the same.
+    DeliveryResult generatePointToPointRoute(
+        const GeoCoord& start,
+        const GeoCoord& end,
+        std::vector<int>& edges,
+        double& totalDistanceTravelled) const;
+
+      // The same, also filling in stats with the work the search did (see SearchStats.h).
+    DeliveryResult generatePointToPointRoute(
+        const GeoCoord& start,
+        const GeoCoord& end,
+        std::vector<int>& edges,
+        double& totalDistanceTravelled,
+        SearchStats& stats) const;
+
+      // We prevent a GraphRouter object from being copied or assigned.
+    GraphRouter(const GraphRouter&) = delete;
+    GraphRouter& operator=(const GraphRouter&) = delete;
+private:
+    GraphRouterImpl* m_impl;
+};
+
+#endif /* GraphRouter_h */
@@ -0,0 +1,217 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <random>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+using namespace std;
+
+// Separate program that puts load on a running server (GooberEats mapdata.txt --serve ...) and reports its latency
+// and throughput. Every connection runs on its own thread and keeps a fixed number of requests in flight; requests
+// use the depot and delivery locations from a deliveries file.
+
+// Number of deliveries in every generated plan request
+const int DELIVERIES_PER_PLAN = 5;
+
+/*
+ Opens a blocking connection to a TCP port on localhost or a Unix domain socket; returns -1 if it couldn't.
+ */
+int connectTo(string address)
+{
+    int fd;
+    if (!address.empty()  &&  address.find_first_not_of("0123456789") == string::npos)
+    {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(stoi(address)));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (fd >= 0  &&  connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0)
+            return fd;
+    }
+    else
+    {
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, address.c_str(), sizeof(addr.sun_path) - 1);
+        if (fd >= 0  &&  connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0)
+            return fd;
+    }
+    if (fd >= 0)
+        close(fd);
+    return -1;
+}
+
+/*
+ Reads the depot and delivery locations of a deliveries file as "[lat,lon]" JSON arrays, depot first.
+ */
+bool loadLocations(string deliveriesFile, vector<string>& locations)
+{
+    ifstream inf(deliveriesFile);
+    if (!inf)
+        return false;
+    string line;
+    while (getline(inf, line))
+    {
+        istringstream iss(line.substr(0, line.find(':')));
+        string lat;
+        string lon;
+        if (iss >> lat >> lon)
+            locations.push_back("[" + lat + "," + lon + "]");
+    }
+    return locations.size() >= 2;
+}
+
+/*
+ Makes the request line with a given id: a route between two of the locations, or a plan from the depot.
+ */
+string makeRequest(long id, bool plan, const vector<string>& locations, mt19937& generator)
+{
+    uniform_int_distribution<size_t> pick(0, locations.size() - 1);
+    string request = "{\"id\":" + to_string(id);
+    if (!plan)
+        return request + ",\"type\":\"route\",\"from\":" + locations[pick(generator)] + ",\"to\":" + locations[pick(generator)] + "}\n";
+    request += ",\"type\":\"plan\",\"depot\":" + locations[0] + ",\"deliveries\":[";
+    for (int i = 0; i < DELIVERIES_PER_PLAN; ++i)
+        request += string(i > 0 ? "," : "") + "{\"item\":\"item " + to_string(i) + "\",\"location\":" + locations[pick(generator)] + "}";
+    return request + "]}\n";
+}
+
+/*
+ Sends numRequests requests over one connection, keeping up to depth of them in flight, and adds the latency of every
+ response (in milliseconds) to latencies. Returns the number of responses that weren't "ok".
+ */
+int runConnection(string address, int numRequests, int depth, bool plan, const vector<string>& locations,
+                  unsigned int seed, vector<double>& latencies)
+{
+    int fd = connectTo(address);
+    if (fd < 0)
+        return numRequests;
+    mt19937 generator(seed);
+    deque<chrono::steady_clock::time_point> sendTimes;
+    string input;
+    char buffer[64 * 1024];
+    int numSent = 0;
+    int numReceived = 0;
+    int numErrors = 0;
+    while (numReceived < numRequests)
+    {
+        // top up the requests in flight; responses come back in order, so their send times are kept in a queue
+        string batch;
+        while (numSent < numRequests  &&  numSent - numReceived < depth)
+        {
+            batch += makeRequest(numSent++, plan, locations, generator);
+            sendTimes.push_back(chrono::steady_clock::now());
+        }
+        for (size_t written = 0; written < batch.size(); )
+        {
+            ssize_t n = write(fd, batch.data() + written, batch.size() - written);
+            if (n <= 0)
+            {
+                close(fd);
+                return numErrors + numRequests - numReceived;
+            }
+            written += n;
+        }
+        
+        // wait for at least one response
+        ssize_t numRead = read(fd, buffer, sizeof(buffer));
+        if (numRead <= 0)
+            break;
+        input.append(buffer, numRead);
+        size_t newline;
+        while ((newline = input.find('\n')) != string::npos)
+        {
+            auto now = chrono::steady_clock::now();
+            latencies.push_back(chrono::duration<double, milli>(now - sendTimes.front()).count());
+            sendTimes.pop_front();
+            if (input.substr(0, newline).find("\"status\":\"ok\"") == string::npos)
+                ++numErrors;
+            input.erase(0, newline + 1);
+            ++numReceived;
+        }
+    }
+    close(fd);
+    return numErrors + numRequests - numReceived;
+}
+
+/*
+ Returns the latency below which a fraction of the sorted latencies fall.
+ */
+double percentile(const vector<double>& sorted, double fraction)
+{
+    if (sorted.empty())
+        return 0;
+    size_t index = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5);
+    return sorted[min(index, sorted.size() - 1)];
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        cout << "Usage: " << argv[0] << " port|socket-path deliveries.txt [connections] [requests-per-connection]"
+             << " [pipeline-depth] [route|plan]" << endl;
+        return 1;
+    }
+    string address = argv[1];
+    int numConnections = argc > 3 ? max(1, atoi(argv[3])) : 4;
+    int numRequests = argc > 4 ? max(1, atoi(argv[4])) : 1000;
+    int depth = argc > 5 ? max(1, atoi(argv[5])) : 8;
+    bool plan = argc > 6  &&  string(argv[6]) == "plan";
+
+    vector<string> locations;
+    if (!loadLocations(argv[2], locations))
+    {
+        cout << "Unable to load delivery request file " << argv[2] << endl;
+        return 1;
+    }
+
+    // every connection keeps its own latencies so the threads never have to share anything
+    vector<vector<double>> latencies(numConnections);
+    vector<int> errors(numConnections, 0);
+    vector<thread> connections;
+    auto startTime = chrono::steady_clock::now();
+    for (int i = 0; i < numConnections; ++i)
+    {
+        connections.push_back(thread([&, i]()
+        {
+            errors[i] = runConnection(address, numRequests, depth, plan, locations, i + 1, latencies[i]);
+        }));
+    }
+    for (auto it = connections.begin(); it != connections.end(); ++it)
+        it->join();
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+
+    vector<double> all;
+    int numErrors = 0;
+    for (int i = 0; i < numConnections; ++i)
+    {
+        all.insert(all.end(), latencies[i].begin(), latencies[i].end());
+        numErrors += errors[i];
+    }
+    sort(all.begin(), all.end());
+    cout.setf(ios::fixed);
+    cout.precision(2);
+    cout << (plan ? "plan" : "route") << " requests: " << all.size() << " answered, " << numErrors << " failed, "
+         << numConnections << " connections, pipeline depth " << depth << endl;
+    cout << "throughput: " << all.size() / elapsed << " requests/s over " << elapsed << " s" << endl;
+    cout << "latency (ms): p50 " << percentile(all, 0.50) << ", p90 " << percentile(all, 0.90) << ", p99 "
+         << percentile(all, 0.99) << ", max " << (all.empty() ? 0 : all.back()) << endl;
+    return numErrors == 0 ? 0 : 1;
+}
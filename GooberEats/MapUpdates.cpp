@@ -0,0 +1,283 @@
+#include "provided.h"
+#include "MapUpdates.h"
+#include "StreetGraph.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <algorithm>
+using namespace std;
+
+// One change at a time to any map, so every change is made to the latest costs
+mutex mapUpdateMutex;
+
+struct CostWatcher
+{
+    const StreetGraph* graph;
+    function<void(const EdgeCostChange&)> watcher;
+};
+
+// Every watcher, by the id watchEdgeCosts returned. Watchers are called with the mutex held, so one that's being
+// unwatched (say by a destructor) is never called afterwards.
+mutex costWatchersMutex;
+map<int, CostWatcher> costWatchers;
+int nextCostWatcherId = 1;
+
+/*
+ Describes the segment a change is to, for error messages.
+ */
+string describeSegment(const SegmentChange& change)
+{
+    string description = "from " + change.start.latitudeText + " " + change.start.longitudeText + " to " +
+                         change.end.latitudeText + " " + change.end.longitudeText;
+    return change.name.empty() ? description : description + " on " + change.name;
+}
+
+/*
+ Adds the edges from the change's start to its end (and back, if it's both ways) that are on its street, or on any
+ street if it doesn't name one. Returns false if there aren't any.
+ */
+bool findChangedEdges(const StreetGraph& graph, const SegmentChange& change, vector<int>& edges)
+{
+    int start = graph.findNode(change.start);
+    int end = graph.findNode(change.end);
+    if (start == NO_NODE  ||  end == NO_NODE)
+        return false;
+    size_t numBefore = edges.size();
+    for (int pass = 0; pass < (change.bothWays ? 2 : 1); ++pass)
+    {
+        int from = pass == 0 ? start : end;
+        int to = pass == 0 ? end : start;
+        for (int edge = graph.firstEdge(from); edge != graph.endEdge(from); ++edge)
+        {
+            if (graph.edgeTo(edge) == to  &&  (change.name.empty()  ||  graph.edgeName(edge) == change.name))
+                edges.push_back(edge);
+        }
+    }
+    return edges.size() > numBefore;
+}
+
+/*
+ Adds up the cost of a chain's edges in driving order, the same order the chain's length was added up in, so a chain
+ whose edges are all back to normal costs exactly its length again.
+ */
+double chainCost(const StreetGraph& graph, const EdgeCosts& costs, int chain)
+{
+    double cost = 0;
+    for (int position = graph.chainBegin(chain); position != graph.chainEnd(chain); ++position)
+        cost += costs.edgeCost[graph.chainEdge(position)];
+    return cost;
+}
+
+/*
+ Makes every change but ADDs to a graph's costs, noting in changed which edges' costs changed and whether any got
+ cheaper, then adds up the chains with a changed edge on them again. Returns false and sets error at the first change
+ that can't be made, leaving the costs part way changed.
+ */
+bool changeCosts(const StreetGraph& graph,
+                 const vector<SegmentChange>& changes,
+                 EdgeCosts& costs,
+                 EdgeCostChange& changed,
+                 string& error)
+{
+    changed.edges.clear();
+    changed.cheaper = false;
+    vector<int> edges;
+    for (auto it = changes.begin(); it != changes.end(); ++it)
+    {
+        if (it->kind == SegmentChangeKind::ADD)
+            continue;
+        if (it->kind == SegmentChangeKind::SLOW  &&  !(it->factor >= 1))
+        {
+            error = "slowdown factor must be at least 1 for the segment " + describeSegment(*it);
+            return false;
+        }
+        edges.clear();
+        if (!findChangedEdges(graph, *it, edges))
+        {
+            error = "no segment " + describeSegment(*it);
+            return false;
+        }
+        for (auto edge = edges.begin(); edge != edges.end(); ++edge)
+        {
+            EdgeState& state = costs.edgeState[*edge];
+            if (state == EdgeState::REMOVED)
+            {
+                error = "removed segment " + describeSegment(*it);
+                return false;
+            }
+            switch (it->kind)
+            {
+              case SegmentChangeKind::CLOSE:
+                state = EdgeState::CLOSED;
+                break;
+              case SegmentChangeKind::REOPEN:
+                state = EdgeState::OPEN;
+                break;
+              case SegmentChangeKind::SLOW:
+                costs.edgeFactor[*edge] = static_cast<float>(it->factor);
+                break;
+              case SegmentChangeKind::REMOVE:
+              case SegmentChangeKind::ADD:
+                state = EdgeState::REMOVED;
+                break;
+            }
+            double cost = state == EdgeState::OPEN ? graph.edgeMiles(*edge) * costs.edgeFactor[*edge] : CLOSED_COST;
+            if (cost == costs.edgeCost[*edge])
+                continue;
+            changed.cheaper = changed.cheaper  ||  cost < costs.edgeCost[*edge];
+            costs.edgeCost[*edge] = cost;
+            changed.edges.push_back(*edge);
+        }
+    }
+    
+    vector<int> chains;
+    for (auto it = changed.edges.begin(); it != changed.edges.end(); ++it)
+        chains.push_back(graph.edgeChain(*it));
+    sort(chains.begin(), chains.end());
+    chains.erase(unique(chains.begin(), chains.end()), chains.end());
+    for (auto it = chains.begin(); it != chains.end(); ++it)
+        costs.chainCost[*it] = chainCost(graph, costs, *it);
+    return true;
+}
+
+/*
+ Tells every watcher of a graph about a change to its costs.
+ */
+void notifyCostWatchers(const StreetGraph* graph, const EdgeCostChange& change)
+{
+    lock_guard<mutex> lock(costWatchersMutex);
+    for (auto it = costWatchers.begin(); it != costWatchers.end(); ++it)
+    {
+        if (it->second.graph == graph)
+            it->second.watcher(change);
+    }
+}
+
+/*
+ Copies the latest costs, changes the copy and publishes it; searches never wait for any of this, and the only lock
+ taken keeps other changes from being made at the same time.
+ */
+bool updateStreetMap(StreetMap* sm, const vector<SegmentChange>& changes, string& error)
+{
+    StreetGraph* graph = getEditableStreetGraph(sm);
+    if (graph == nullptr  ||  graph->costs() == nullptr)
+    {
+        error = "map isn't loaded";
+        return false;
+    }
+    for (auto it = changes.begin(); it != changes.end(); ++it)
+    {
+        if (it->kind == SegmentChangeKind::ADD)
+        {
+            error = "adding the segment " + describeSegment(*it) + " needs a new map";
+            return false;
+        }
+    }
+    
+    lock_guard<mutex> lock(mapUpdateMutex);
+    shared_ptr<EdgeCosts> costs = make_shared<EdgeCosts>(*graph->costs());
+    EdgeCostChange change;
+    if (!changeCosts(*graph, changes, *costs, change, error))
+        return false;
+    change.version = ++costs->version;
+    graph->publishCosts(costs);
+    notifyCostWatchers(graph, change);
+    return true;
+}
+
+/*
+ Makes the changes to a copy of the source's costs first, so every change is checked before anything is added to the
+ target and segments removed by this update are left out like earlier ones. The source's edges are added in the order
+ of their ids, which keeps the segments leaving every coordinate in the order they were loaded, and new segments come
+ after them. Once the target is finished, every old segment's state and factor go to the first edge in the target
+ that joins the same coordinates on the same street and hasn't been matched yet.
+ */
+bool loadUpdatedStreetMap(StreetMap* target,
+                          const StreetMap* source,
+                          const vector<SegmentChange>& changes,
+                          string& error)
+{
+    const StreetGraph* from = getStreetGraph(source);
+    StreetGraph* to = getEditableStreetGraph(target);
+    if (from == nullptr  ||  to == nullptr  ||  from->costs() == nullptr)
+    {
+        error = "map isn't loaded";
+        return false;
+    }
+    if (to->numNodes() != 0)
+    {
+        error = "map to load into isn't empty";
+        return false;
+    }
+    for (auto it = changes.begin(); it != changes.end(); ++it)
+    {
+        if (it->kind == SegmentChangeKind::ADD  &&  (it->name.empty()  ||  it->start == it->end))
+        {
+            error = "new segment " + describeSegment(*it) + " needs a street and two different ends";
+            return false;
+        }
+    }
+    
+    lock_guard<mutex> lock(mapUpdateMutex);
+    EdgeCosts sourceCosts = *from->costs();
+    EdgeCostChange ignored;
+    if (!changeCosts(*from, changes, sourceCosts, ignored, error))
+        return false;
+    for (int edge = 0; edge < from->numEdges(); ++edge)
+    {
+        if (sourceCosts.edgeState[edge] != EdgeState::REMOVED)
+            to->addSegment(from->coord(from->edgeFrom(edge)), from->coord(from->edgeTo(edge)), from->edgeName(edge));
+    }
+    for (auto it = changes.begin(); it != changes.end(); ++it)
+    {
+        if (it->kind != SegmentChangeKind::ADD)
+            continue;
+        to->addSegment(it->start, it->end, it->name);
+        if (it->bothWays)
+            to->addSegment(it->end, it->start, it->name);
+    }
+    to->finish();
+    
+    shared_ptr<EdgeCosts> costs = make_shared<EdgeCosts>(*to->costs());
+    vector<bool> matched(to->numEdges(), false);
+    for (int edge = 0; edge < from->numEdges(); ++edge)
+    {
+        if (sourceCosts.edgeState[edge] == EdgeState::REMOVED)
+            continue;
+        int start = to->findNode(from->coord(from->edgeFrom(edge)));
+        int end = to->findNode(from->coord(from->edgeTo(edge)));
+        for (int newEdge = to->firstEdge(start); newEdge != to->endEdge(start); ++newEdge)
+        {
+            if (matched[newEdge]  ||  to->edgeTo(newEdge) != end  ||  to->edgeName(newEdge) != from->edgeName(edge))
+                continue;
+            matched[newEdge] = true;
+            costs->edgeState[newEdge] = sourceCosts.edgeState[edge];
+            costs->edgeFactor[newEdge] = sourceCosts.edgeFactor[edge];
+            costs->edgeCost[newEdge] = sourceCosts.edgeState[edge] == EdgeState::OPEN ?
+                                       to->edgeMiles(newEdge) * sourceCosts.edgeFactor[edge] : CLOSED_COST;
+            break;
+        }
+    }
+    for (int chain = 0; chain < to->numChains(); ++chain)
+        costs->chainCost[chain] = chainCost(*to, *costs, chain);
+    costs->version = sourceCosts.version + 1;
+    to->publishCosts(costs);
+    return true;
+}
+
+int watchEdgeCosts(const StreetGraph* graph, function<void(const EdgeCostChange&)> watcher)
+{
+    lock_guard<mutex> lock(costWatchersMutex);
+    int id = nextCostWatcherId++;
+    costWatchers[id] = { graph, watcher };
+    return id;
+}
+
+void unwatchEdgeCosts(int id)
+{
+    lock_guard<mutex> lock(costWatchersMutex);
+    costWatchers.erase(id);
+}
@@ -0,0 +1,70 @@
+#ifndef MapUpdates_h
+#define MapUpdates_h
+
+#include "provided.h"
+#include <string>
+#include <vector>
+#include <functional>
+
+class StreetGraph;
+
+// MapUpdates.h
+
+// Changes to a loaded map while it's in use: closing segments and opening them again, making them slower to drive,
+// removing them, and adding new ones.
+//
+// Closing, reopening, slowing down and removing leave the map's nodes and edges as they are and only change what
+// searches pay to drive them (see EdgeCosts in StreetGraph.h). The changes are made to a copy of the latest costs,
+// which is then published in one step, so applying them takes under a millisecond and never waits for a search; a
+// search that's under way keeps the costs it started with. Whatever's watching the map's costs (a DepotRouteCache,
+// for one) is told which edges changed, so it can drop just what they affect.
+//
+// Adding segments changes the graph itself, so it's done by loading a new map from the old one with the changes made
+// (loadUpdatedStreetMap); requests under way finish with the old map, and new ones can be given the new one. That's a
+// full rebuild, renumbering and compressing included, and takes about as long as loading the map from its file (about
+// 40 ms for mapdata.txt), so it shouldn't be done on a thread that's expected to answer requests quickly.
+
+enum class SegmentChangeKind
+{
+    CLOSE, REOPEN, SLOW, REMOVE, ADD
+};
+
+struct SegmentChange
+{
+    SegmentChange()
+     : kind(SegmentChangeKind::CLOSE), bothWays(true), factor(1)
+    {}
+
+    SegmentChangeKind kind;
+    GeoCoord start;
+    GeoCoord end;
+    std::string name;       // the street; if empty, every segment from start to end is changed (ADD needs one)
+    bool bothWays;          // whether the segment from end to start changes too, as it does in a map file
+    double factor;          // SLOW: how many times its length it costs to drive the segment, at least 1 (1 is normal)
+};
+
+  // What a watcher is told when a map's costs change.
+struct EdgeCostChange
+{
+    long long version;              // of the costs that were just published
+    std::vector<int> edges;         // whose costs changed
+    bool cheaper;                   // whether any of them got cheaper (e.g. reopened); otherwise they only got dearer
+};
+
+  // Applies closures, reopenings, slowdowns and removals to a map as one new version of its costs. If a change doesn't
+  // match a segment on the map, is an ADD, or is otherwise invalid, returns false and sets error, and nothing changes.
+bool updateStreetMap(StreetMap* sm, const std::vector<SegmentChange>& changes, std::string& error);
+
+  // Loads into an empty map everything in source with the changes made, ADDs included: removed segments are left out
+  // and closures and slowdowns carry over. Returns false and sets error if a change is invalid, leaving target empty.
+bool loadUpdatedStreetMap(StreetMap* target,
+                          const StreetMap* source,
+                          const std::vector<SegmentChange>& changes,
+                          std::string& error);
+
+  // Calls watcher, on the thread making the change, after every change to a graph's costs until unwatchEdgeCosts is
+  // called with the id this returns.
+int watchEdgeCosts(const StreetGraph* graph, std::function<void(const EdgeCostChange&)> watcher);
+void unwatchEdgeCosts(int id);
+
+#endif /* MapUpdates_h */
@@ -0,0 +1,44 @@
+#include "MemoryUsage.h"
+#include <string>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+using namespace std;
+
+void MemoryUsage::add(const string& name, size_t bytes, size_t count)
+{
+    components.push_back({ name, bytes, count });
+}
+
+size_t MemoryUsage::totalBytes() const
+{
+    size_t total = 0;
+    for (auto it = components.begin(); it != components.end(); ++it)
+        total += it->bytes;
+    return total;
+}
+
+/*
+ Writes each component's bytes and share of the total, then a histogram of chain lengths for each hash map; the longest
+ chains are the ones every lookup in an overloaded map pays for.
+ */
+void MemoryUsage::write(ostream& out) const
+{
+    const double TOTAL = static_cast<double>(totalBytes());
+    out << "Memory usage: " << fixed << setprecision(1) << TOTAL / (1024 * 1024) << " MB" << endl;
+    for (auto it = components.begin(); it != components.end(); ++it)
+    {
+        out << "  " << left << setw(36) << it->name << right << setw(12) << it->bytes << " bytes " << setw(5)
+            << (TOTAL > 0 ? 100 * it->bytes / TOTAL : 0) << "%   " << it->count << " objects" << endl;
+    }
+    for (auto it = hashMaps.begin(); it != hashMaps.end(); ++it)
+    {
+        out << it->name << ": " << it->numPairs << " pairs in " << it->numBuckets << " buckets (load factor "
+            << setprecision(2) << (it->numBuckets > 0 ? static_cast<double>(it->numPairs) / it->numBuckets : 0)
+            << "), " << it->bucketsWithLists << " with lists" << endl;
+        out << "  chain length    buckets" << endl;
+        for (size_t length = 0; length < it->chainLengths.size(); ++length)
+            out << "  " << setw(12) << length << setw(11) << it->chainLengths[length] << endl;
+    }
+    out << defaultfloat << setprecision(6);
+}
@@ -0,0 +1,126 @@
+#ifndef MemoryUsage_h
+#define MemoryUsage_h
+
+#include "provided.h"
+#include <string>
+#include <vector>
+#include <iosfwd>
+#include <cstddef>
+
+// MemoryUsage.h
+
+// Accounting for what the map's data structures take up in memory. A MemoryUsage is a list of components (e.g. "graph
+// edges", "graph node index list nodes") with the bytes and the number of objects or allocations in each, plus how
+// full every hash map in it is. Containers that allocate node by node use a CountingAllocator, so their bytes are
+// the ones actually requested from the heap rather than estimates; the allocator's own bookkeeping isn't included.
+
+  // What's been allocated through CountingAllocators sharing a count, and not yet freed
+struct AllocationCount
+{
+    AllocationCount() : bytes(0), allocations(0) {}
+
+    size_t bytes;
+    size_t allocations;
+};
+
+  // An allocator that allocates with new like std::allocator and adds everything it allocates to a count. Copies
+  // (including rebound ones) share the count, so the nodes a std::list allocates are all counted in one place.
+template<typename T>
+class CountingAllocator
+{
+public:
+    typedef T value_type;
+
+    explicit CountingAllocator(AllocationCount* count) : m_count(count) {}
+    template<typename U>
+    CountingAllocator(const CountingAllocator<U>& other) : m_count(other.count()) {}
+
+    T* allocate(size_t n)
+    {
+        m_count->bytes += n * sizeof(T);
+        ++m_count->allocations;
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+    void deallocate(T* p, size_t n)
+    {
+        m_count->bytes -= n * sizeof(T);
+        --m_count->allocations;
+        ::operator delete(p);
+    }
+    AllocationCount* count() const { return m_count; }
+private:
+    AllocationCount* m_count;
+};
+
+template<typename T, typename U>
+bool operator==(const CountingAllocator<T>& lhs, const CountingAllocator<U>& rhs)
+{
+    return lhs.count() == rhs.count();
+}
+
+template<typename T, typename U>
+bool operator!=(const CountingAllocator<T>& lhs, const CountingAllocator<U>& rhs)
+{
+    return lhs.count() != rhs.count();
+}
+
+  // How a hash map's pairs are spread over its buckets; chainLengths[n] is how many buckets hold exactly n pairs.
+struct HashMapOccupancy
+{
+    HashMapOccupancy() : numBuckets(0), numPairs(0), bucketsWithLists(0) {}
+
+    std::string name;
+    unsigned int numBuckets;
+    unsigned int numPairs;
+    unsigned int bucketsWithLists;      // buckets that have had a list allocated, whether or not it's empty now
+    std::vector<unsigned int> chainLengths;
+};
+
+struct MemoryComponent
+{
+    std::string name;
+    size_t bytes;
+    size_t count;           // objects or allocations the bytes are made up of
+};
+
+struct MemoryUsage
+{
+    std::vector<MemoryComponent> components;
+    std::vector<HashMapOccupancy> hashMaps;
+
+    void add(const std::string& name, size_t bytes, size_t count);
+    size_t totalBytes() const;
+
+      // Writes a table of the components followed by every hash map's chain-length histogram.
+    void write(std::ostream& out) const;
+};
+
+  // Returns the heap memory a string holds beyond the string object itself (none for short strings, which are stored
+  // inside the object).
+inline
+size_t stringHeapBytes(const std::string& s)
+{
+    const char* object = reinterpret_cast<const char*>(&s);
+    if (s.data() >= object  &&  s.data() < object + sizeof(s))
+        return 0;
+    return s.capacity() + 1;
+}
+
+  // Returns the heap memory a coordinate's text takes up.
+inline
+size_t coordHeapBytes(const GeoCoord& gc)
+{
+    return stringHeapBytes(gc.latitudeText) + stringHeapBytes(gc.longitudeText);
+}
+
+  // Returns the heap memory a vector's elements take up, counting the capacity it has reserved.
+template<typename T>
+size_t vectorHeapBytes(const std::vector<T>& v)
+{
+    return v.capacity() * sizeof(T);
+}
+
+  // Returns what a loaded StreetMap takes up, which is all in the StreetGraph that stores it.
+MemoryUsage getStreetMapMemoryUsage(const StreetMap* sm);
+
+#endif /* MemoryUsage_h */
@@ -0,0 +1,683 @@
+#include "provided.h"
+#include "ExpandableHashMap.h"
+#include "StreetGraph.h"
+#include "GraphRouter.h"
+#include "DeliveryLoader.h"
+#include "CompactPlan.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <random>
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <limits>
+#include <chrono>
+#include <atomic>
+#include <cstdlib>
+#include <cstdio>
+#include <new>
+#include <memory>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+// Separate program that times the hot paths of loading, looking up, routing and planning, one small benchmark at a
+// time, in the style of Google Benchmark: every benchmark is a loop that the runner calls with more and more iterations
+// until it runs long enough to time reliably. Each benchmark reports the time per iteration, how many items (lookups,
+// routes, deliveries...) it got through per second, the heap allocations each iteration made, and (on Linux, where the
+// kernel allows reading hardware counters) the cache misses each iteration caused, along with any figures of its own
+// (like Google Benchmark's user counters). Results can be saved as JSON and later compared against, so a change that
+// slows something down or makes it allocate more is caught.
+
+// Every benchmark runs for at least this long once its iteration count is settled
+const double MIN_MEASURE_SECONDS = 0.5;
+// Seed for everything that's picked at random, so every run measures the same work
+const unsigned int BENCHMARK_SEED = 20200311;
+// How many coordinates the lookup benchmarks cycle through and how many pairs the routing benchmarks route between
+const int NUM_LOOKUPS = 4096;
+const int NUM_ROUTE_PAIRS = 64;
+// Load factors the hash map is measured at, and the sizes the optimizer is measured at
+const double LOAD_FACTORS[] = { 0.25, 0.5, 1.0, 2.0 };
+const int OPTIMIZER_SIZES[] = { 5, 10, 25, 50 };
+// Names of the node orders the routing benchmarks compare, indexed by NodeOrder
+const char* const NODE_ORDER_NAMES[NUM_NODE_ORDERS] = { "loaded", "hilbert", "morton", "bfs" };
+// Bytes in a cache line, and in an entry of the search's per-node tables (its costs are doubles)
+const int CACHE_LINE_BYTES = 64;
+const int NODE_ENTRY_BYTES = 8;
+// A benchmark that's this much slower than its baseline (10%) is reported as a regression
+const double DEFAULT_THRESHOLD = 0.10;
+
+//******************** allocation counting *************************************
+
+// Every allocation the program makes goes through these replacements of the global operator new, so the
+// allocations made by a benchmark can be counted by reading the counters before and after its loop.
+
+atomic<long long> allocationCount(0);
+atomic<long long> allocatedBytes(0);
+
+void* operator new(size_t size)
+{
+    ++allocationCount;
+    allocatedBytes += size;
+    void* p = malloc(size == 0 ? 1 : size);
+    if (p == nullptr)
+        throw bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    operator delete(p);
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete[](void* p) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+    operator delete(p);
+}
+
+//******************** cache miss counting *************************************
+
+// On Linux the process's last-level cache misses can be counted with a hardware performance counter; where there's no
+// such counter (other systems, most virtual machines, or a kernel that doesn't let unprivileged programs read them)
+// only time and allocations are reported.
+
+#ifdef __linux__
+int cacheMissCounter = -2;      // file descriptor of the counter, -1 if it couldn't be opened, -2 if not yet tried
+#endif
+
+/*
+ Returns how many cache misses this process has caused since the counter was first read, or -1 if it can't be counted.
+ */
+long long readCacheMisses()
+{
+#ifdef __linux__
+    if (cacheMissCounter == -2)
+    {
+        perf_event_attr attributes = perf_event_attr();
+        attributes.type = PERF_TYPE_HARDWARE;
+        attributes.size = sizeof(attributes);
+        attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+        cacheMissCounter = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+    }
+    long long count;
+    if (cacheMissCounter >= 0  &&  read(cacheMissCounter, &count, sizeof(count)) == sizeof(count))
+        return count;
+#endif
+    return -1;
+}
+
+//******************** runner **************************************************
+
+/*
+ What a benchmark's loop sees: it calls keepRunning() before every iteration, which times the loop (and counts its
+ allocations) from the first call to the one that returns false. Work done before the loop isn't measured.
+ */
+class BenchmarkState
+{
+public:
+    BenchmarkState(long long iterations)
+     : m_iterations(iterations), m_done(0), m_itemsPerIteration(1), m_seconds(0), m_allocations(0), m_bytes(0),
+       m_cacheMisses(-1)
+    {}
+    
+    bool keepRunning()
+    {
+        if (m_done == 0)
+        {
+            m_startAllocations = allocationCount;
+            m_startBytes = allocatedBytes;
+            m_startCacheMisses = readCacheMisses();
+            m_start = chrono::steady_clock::now();
+        }
+        if (m_done < m_iterations)
+        {
+            ++m_done;
+            return true;
+        }
+        m_seconds = chrono::duration<double>(chrono::steady_clock::now() - m_start).count();
+        m_allocations = allocationCount - m_startAllocations;
+        m_bytes = allocatedBytes - m_startBytes;
+        if (m_startCacheMisses >= 0)
+            m_cacheMisses = readCacheMisses() - m_startCacheMisses;
+        return false;
+    }
+    
+    // How many items (lookups, routes...) one iteration handles, for the throughput
+    void setItemsPerIteration(long long items) { m_itemsPerIteration = items; }
+    // A figure of the benchmark's own to report with its results
+    void setCounter(const string& name, double value) { m_counters[name] = value; }
+    
+    long long iterations() const { return m_iterations; }
+    long long itemsPerIteration() const { return m_itemsPerIteration; }
+    double seconds() const { return m_seconds; }
+    long long allocations() const { return m_allocations; }
+    long long bytes() const { return m_bytes; }
+    // -1 if cache misses can't be counted
+    long long cacheMisses() const { return m_cacheMisses; }
+    const map<string, double>& counters() const { return m_counters; }
+private:
+    long long m_iterations;
+    long long m_done;
+    long long m_itemsPerIteration;
+    chrono::steady_clock::time_point m_start;
+    long long m_startAllocations;
+    long long m_startBytes;
+    long long m_startCacheMisses;
+    double m_seconds;
+    long long m_allocations;
+    long long m_bytes;
+    long long m_cacheMisses;
+    map<string, double> m_counters;
+};
+
+struct Benchmark
+{
+    string name;
+    function<void(BenchmarkState&)> run;
+};
+
+struct BenchmarkResult
+{
+    string name;
+    long long iterations;
+    double nsPerOp;
+    double itemsPerSecond;
+    double allocsPerOp;
+    double bytesPerOp;
+    double cacheMissesPerOp;        // -1 if they weren't counted
+    map<string, double> counters;
+};
+
+/*
+ Runs a benchmark with one iteration, then with more and more until a run lasts MIN_MEASURE_SECONDS, and reports
+ the last run.
+ */
+BenchmarkResult runBenchmark(const Benchmark& benchmark)
+{
+    long long iterations = 1;
+    for (;;)
+    {
+        BenchmarkState state(iterations);
+        benchmark.run(state);
+        if (state.seconds() >= MIN_MEASURE_SECONDS  ||  iterations >= 1000000000)
+        {
+            BenchmarkResult result;
+            result.name = benchmark.name;
+            result.iterations = iterations;
+            result.nsPerOp = state.seconds() * 1e9 / iterations;
+            result.itemsPerSecond = state.seconds() > 0 ? iterations * state.itemsPerIteration() / state.seconds() : 0;
+            result.allocsPerOp = static_cast<double>(state.allocations()) / iterations;
+            result.bytesPerOp = static_cast<double>(state.bytes()) / iterations;
+            result.cacheMissesPerOp = state.cacheMisses() >= 0 ? static_cast<double>(state.cacheMisses()) / iterations
+                                                                : -1;
+            result.counters = state.counters();
+            return result;
+        }
+        
+        // aim a little past the time that's needed, growing at least twice and at most a hundred times per run
+        double scale = state.seconds() > 0 ? 1.4 * MIN_MEASURE_SECONDS / state.seconds() : 100;
+        iterations = static_cast<long long>(iterations * max(2.0, min(100.0, scale)));
+    }
+}
+
+//******************** benchmarks **********************************************
+
+// Results that nothing else uses are added here, so the compiler can't skip the work that produced them
+volatile long long sink = 0;
+
+/*
+ Everything the benchmarks share: the map (loaded once), coordinates to look up, pairs of nodes that are connected,
+ and the sample deliveries.
+ */
+struct Fixture
+{
+    string mapFile;
+    StreetMap map;
+    const StreetGraph* graph;
+    vector<GeoCoord> coords;
+    vector<GeoCoord> lookups;
+    vector<pair<GeoCoord, GeoCoord>> routePairs;
+    // the map loaded again with its nodes in each order, indexed by NodeOrder
+    unique_ptr<StreetGraph> orderedGraphs[NUM_NODE_ORDERS];
+    GeoCoord depot;
+    vector<DeliveryRequest> deliveries;
+};
+
+bool setUpFixture(Fixture& fixture, string mapFile, string deliveriesFile)
+{
+    fixture.mapFile = mapFile;
+    if (!fixture.map.load(mapFile))
+        return false;
+    fixture.graph = getStreetGraph(&fixture.map);
+    for (int node = 0; node < fixture.graph->numNodes(); ++node)
+        fixture.coords.push_back(fixture.graph->coord(node));
+    
+    mt19937 generator(BENCHMARK_SEED);
+    for (int i = 0; i < NUM_LOOKUPS; ++i)
+        fixture.lookups.push_back(fixture.coords[generator() % fixture.coords.size()]);
+    
+    // keep only pairs with a route between them, so every routing iteration does a whole search
+    GraphRouter router(&fixture.map);
+    vector<int> edges;
+    double miles;
+    while (static_cast<int>(fixture.routePairs.size()) < NUM_ROUTE_PAIRS)
+    {
+        GeoCoord from = fixture.coords[generator() % fixture.coords.size()];
+        GeoCoord to = fixture.coords[generator() % fixture.coords.size()];
+        if (router.generatePointToPointRoute(from, to, edges, miles) == DELIVERY_SUCCESS  &&  !edges.empty())
+            fixture.routePairs.push_back(make_pair(from, to));
+    }
+    for (int order = 0; order < NUM_NODE_ORDERS; ++order)
+    {
+        fixture.orderedGraphs[order].reset(new StreetGraph);
+        loadStreetGraph(mapFile, *fixture.orderedGraphs[order], static_cast<NodeOrder>(order));
+    }
+    
+    DeliveryLoader loader(&fixture.map);
+    vector<DeliveryFileError> errors;
+    return loader.load(deliveriesFile, fixture.depot, fixture.deliveries, errors);
+}
+
+/*
+ Returns how far apart the ids of an edge's ends are on average. The nodes a search reads next are the ends of the
+ edges it's following, so the smaller this is, the closer together in memory its reads are.
+ */
+double meanEdgeIdGap(const StreetGraph& graph)
+{
+    double total = 0;
+    for (int edge = 0; edge < graph.numEdges(); ++edge)
+        total += abs(graph.edgeTo(edge) - graph.edgeFrom(edge));
+    return graph.numEdges() == 0 ? 0 : total / graph.numEdges();
+}
+
+/*
+ Returns how many distinct cache lines of a per-node table a search between every pair reads entries of, on average.
+ With lengths for costs, the A* search settles the junctions whose cost plus crow distance to the destination is no
+ more than the route's length, and reads their entries and its start's; this finds those junctions with a plain
+ Dijkstra search that stops there. The fewest lines there can be is the number of nodes times NODE_ENTRY_BYTES /
+ CACHE_LINE_BYTES.
+ */
+double linesPerSearch(const StreetGraph& graph, const vector<pair<GeoCoord, GeoCoord>>& routePairs)
+{
+    const double INFINITE_MILES = numeric_limits<double>::infinity();
+    GraphRouter router(&graph);
+    vector<int> edges;
+    double routeMiles;
+    vector<double> miles(graph.numNodes(), INFINITE_MILES);
+    vector<int> reached;
+    vector<int> lines;
+    long long totalLines = 0;
+    int numSearches = 0;
+    for (auto it = routePairs.begin(); it != routePairs.end(); ++it)
+    {
+        int start = graph.findNode(it->first);
+        if (router.generatePointToPointRoute(it->first, it->second, edges, routeMiles) != DELIVERY_SUCCESS)
+            continue;
+        
+        typedef pair<double, int> QueueEntry;
+        priority_queue<QueueEntry, vector<QueueEntry>, greater<QueueEntry>> open;
+        miles[start] = 0;
+        reached.assign(1, start);
+        open.push(QueueEntry(0, start));
+        lines.assign(1, start * NODE_ENTRY_BYTES / CACHE_LINE_BYTES);
+        while (!open.empty())
+        {
+            double nodeMiles = open.top().first;
+            int node = open.top().second;
+            open.pop();
+            if (nodeMiles > miles[node])
+                continue;
+            if (nodeMiles + distanceEarthMiles(graph.coord(node), it->second) > routeMiles * (1 + 1e-9))
+                continue;
+            if (graph.isJunction(node))
+                lines.push_back(node * NODE_ENTRY_BYTES / CACHE_LINE_BYTES);
+            for (int edge = graph.firstEdge(node); edge != graph.endEdge(node); ++edge)
+            {
+                int next = graph.edgeTo(edge);
+                if (nodeMiles + graph.edgeMiles(edge) >= miles[next])
+                    continue;
+                if (miles[next] == INFINITE_MILES)
+                    reached.push_back(next);
+                miles[next] = nodeMiles + graph.edgeMiles(edge);
+                open.push(QueueEntry(miles[next], next));
+            }
+        }
+        for (auto node = reached.begin(); node != reached.end(); ++node)
+            miles[*node] = INFINITE_MILES;
+        
+        sort(lines.begin(), lines.end());
+        totalLines += unique(lines.begin(), lines.end()) - lines.begin();
+        ++numSearches;
+    }
+    return numSearches == 0 ? 0 : static_cast<double>(totalLines) / numSearches;
+}
+
+/*
+ Builds the list of benchmarks. Names are "Group/operation/parameter", like Google Benchmark's.
+ */
+vector<Benchmark> makeBenchmarks(const Fixture& fixture)
+{
+    vector<Benchmark> benchmarks;
+    const Fixture* f = &fixture;
+    
+    benchmarks.push_back({ "StreetMap/load", [f](BenchmarkState& state) {
+        while (state.keepRunning())
+        {
+            StreetMap sm;
+            sm.load(f->mapFile);
+        }
+    }});
+    
+    benchmarks.push_back({ "StreetMap/getSegmentsThatStartWith", [f](BenchmarkState& state) {
+        vector<StreetSegment> segments;
+        state.setItemsPerIteration(NUM_LOOKUPS);
+        while (state.keepRunning())
+            for (auto it = f->lookups.begin(); it != f->lookups.end(); ++it)
+                f->map.getSegmentsThatStartWith(*it, segments);
+    }});
+    
+    for (double loadFactor : LOAD_FACTORS)
+    {
+        char suffix[16];
+        snprintf(suffix, sizeof(suffix), "/%.2f", loadFactor);
+        benchmarks.push_back({ string("ExpandableHashMap/associate") + suffix, [f, loadFactor](BenchmarkState& state) {
+            state.setItemsPerIteration(f->coords.size());
+            while (state.keepRunning())
+            {
+                ExpandableHashMap<GeoCoord, int> hashMap(loadFactor);
+                for (int i = 0; i < static_cast<int>(f->coords.size()); ++i)
+                    hashMap.associate(f->coords[i], i);
+            }
+        }});
+        benchmarks.push_back({ string("ExpandableHashMap/find") + suffix, [f, loadFactor](BenchmarkState& state) {
+            ExpandableHashMap<GeoCoord, int> hashMap(loadFactor);
+            for (int i = 0; i < static_cast<int>(f->coords.size()); ++i)
+                hashMap.associate(f->coords[i], i);
+            state.setItemsPerIteration(NUM_LOOKUPS);
+            while (state.keepRunning())
+                for (auto it = f->lookups.begin(); it != f->lookups.end(); ++it)
+                    sink += hashMap.find(*it) != nullptr;
+        }});
+    }
+    
+    benchmarks.push_back({ "PointToPointRouter/generatePointToPointRoute", [f](BenchmarkState& state) {
+        PointToPointRouter router(&f->map);
+        list<StreetSegment> route;
+        double miles;
+        state.setItemsPerIteration(NUM_ROUTE_PAIRS);
+        while (state.keepRunning())
+            for (auto it = f->routePairs.begin(); it != f->routePairs.end(); ++it)
+                router.generatePointToPointRoute(it->first, it->second, route, miles);
+    }});
+    
+    benchmarks.push_back({ "GraphRouter/generatePointToPointRoute", [f](BenchmarkState& state) {
+        GraphRouter router(&f->map);
+        vector<int> edges;
+        double miles;
+        state.setItemsPerIteration(NUM_ROUTE_PAIRS);
+        while (state.keepRunning())
+            for (auto it = f->routePairs.begin(); it != f->routePairs.end(); ++it)
+                router.generatePointToPointRoute(it->first, it->second, edges, miles);
+    }});
+    
+    // the same routes over the map with its nodes numbered in each order, to show what the order does to the search's
+    // memory accesses; the counters show how close together the nodes it reads are whether or not the map is big
+    // enough for that to change its time
+    for (int order = 0; order < NUM_NODE_ORDERS; ++order)
+    {
+        string name = string("GraphRouter/nodeOrder/") + NODE_ORDER_NAMES[order];
+        benchmarks.push_back({ name, [f, order](BenchmarkState& state) {
+            const StreetGraph& graph = *f->orderedGraphs[order];
+            state.setCounter("edgeIdGap", meanEdgeIdGap(graph));
+            state.setCounter("linesPerSearch", linesPerSearch(graph, f->routePairs));
+            GraphRouter router(&graph);
+            vector<int> edges;
+            double miles;
+            state.setItemsPerIteration(NUM_ROUTE_PAIRS);
+            while (state.keepRunning())
+                for (auto it = f->routePairs.begin(); it != f->routePairs.end(); ++it)
+                    router.generatePointToPointRoute(it->first, it->second, edges, miles);
+        }});
+    }
+    
+    for (int size : OPTIMIZER_SIZES)
+    {
+        string name = "DeliveryOptimizer/optimizeDeliveryOrder/" + to_string(size);
+        benchmarks.push_back({ name, [f, size](BenchmarkState& state) {
+            mt19937 generator(BENCHMARK_SEED + size);
+            vector<DeliveryRequest> start;
+            for (int i = 0; i < size; ++i)
+                start.push_back(DeliveryRequest("stop", f->coords[generator() % f->coords.size()]));
+            DeliveryOptimizer optimizer(&f->map);
+            double oldCrowDistance;
+            double newCrowDistance;
+            state.setItemsPerIteration(size);
+            while (state.keepRunning())
+            {
+                vector<DeliveryRequest> deliveries = start;
+                optimizer.optimizeDeliveryOrder(f->depot, deliveries, oldCrowDistance, newCrowDistance);
+            }
+        }});
+    }
+    
+    benchmarks.push_back({ "DeliveryPlanner/generateDeliveryPlan", [f](BenchmarkState& state) {
+        DeliveryPlanner planner(&f->map);
+        vector<DeliveryCommand> commands;
+        double miles;
+        state.setItemsPerIteration(f->deliveries.size());
+        while (state.keepRunning())
+        {
+            commands.clear();
+            planner.generateDeliveryPlan(f->depot, f->deliveries, commands, miles);
+        }
+    }});
+    
+    benchmarks.push_back({ "CompactDeliveryPlanner/generateDeliveryPlan", [f](BenchmarkState& state) {
+        CompactDeliveryPlanner planner(&f->map);
+        CompactPlan plan;
+        double miles;
+        state.setItemsPerIteration(f->deliveries.size());
+        while (state.keepRunning())
+            planner.generateDeliveryPlan(f->depot, f->deliveries, plan, miles);
+    }});
+    return benchmarks;
+}
+
+//******************** reporting ***********************************************
+
+/*
+ Writes every result as JSON, one result per line so that readBaseline can pick them out again.
+ */
+void writeResults(ostream& out, string mapFile, const vector<BenchmarkResult>& results)
+{
+    out.setf(ios::fixed);
+    out << "{\n  \"benchmark\": \"micro\",\n  \"map\": \"" << mapFile << "\",\n  \"results\": [";
+    for (int i = 0; i < static_cast<int>(results.size()); ++i)
+    {
+        const BenchmarkResult& r = results[i];
+        out << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"" << r.name << "\", \"iterations\": " << r.iterations;
+        out.precision(1);
+        out << ", \"nsPerOp\": " << r.nsPerOp << ", \"itemsPerSecond\": " << r.itemsPerSecond;
+        out.precision(2);
+        out << ", \"allocsPerOp\": " << r.allocsPerOp << ", \"bytesPerOp\": " << r.bytesPerOp;
+        out << ", \"cacheMissesPerOp\": " << r.cacheMissesPerOp;
+        for (auto it = r.counters.begin(); it != r.counters.end(); ++it)
+            out << ", \"" << it->first << "\": " << it->second;
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+/*
+ Returns the number that follows "key": on a line, or -1 if the key isn't there.
+ */
+double jsonNumber(const string& line, const string& key)
+{
+    size_t at = line.find("\"" + key + "\":");
+    return at == string::npos ? -1 : atof(line.c_str() + at + key.size() + 3);
+}
+
+/*
+ Reads the results in a file written by writeResults.
+ */
+bool readBaseline(string baselineFile, map<string, BenchmarkResult>& baseline)
+{
+    ifstream inf(baselineFile);
+    if (!inf)
+        return false;
+    string line;
+    while (getline(inf, line))
+    {
+        size_t at = line.find("{\"name\": \"");
+        if (at == string::npos)
+            continue;
+        BenchmarkResult result;
+        size_t start = at + 10;
+        result.name = line.substr(start, line.find('"', start) - start);
+        result.iterations = static_cast<long long>(jsonNumber(line, "iterations"));
+        result.nsPerOp = jsonNumber(line, "nsPerOp");
+        result.itemsPerSecond = jsonNumber(line, "itemsPerSecond");
+        result.allocsPerOp = jsonNumber(line, "allocsPerOp");
+        result.bytesPerOp = jsonNumber(line, "bytesPerOp");
+        result.cacheMissesPerOp = jsonNumber(line, "cacheMissesPerOp");
+        baseline[result.name] = result;
+    }
+    return true;
+}
+
+/*
+ Prints one line about a result: its time, throughput and allocations, and how its time and allocations compare with
+ its baseline if there is one. Returns whether it's a regression: slower than the threshold allows, or allocating more.
+ */
+bool printResult(const BenchmarkResult& r, const map<string, BenchmarkResult>& baseline, double threshold)
+{
+    char line[256];
+    snprintf(line, sizeof(line), "%-52s %14.1f ns %14.0f items/s %10.1f allocs %12.0f bytes",
+             r.name.c_str(), r.nsPerOp, r.itemsPerSecond, r.allocsPerOp, r.bytesPerOp);
+    cout << line;
+    if (r.cacheMissesPerOp >= 0)
+    {
+        snprintf(line, sizeof(line), " %12.0f misses", r.cacheMissesPerOp);
+        cout << line;
+    }
+    for (auto it = r.counters.begin(); it != r.counters.end(); ++it)
+    {
+        snprintf(line, sizeof(line), " %10.2f %s", it->second, it->first.c_str());
+        cout << line;
+    }
+    auto found = baseline.find(r.name);
+    if (found == baseline.end())
+    {
+        cout << (baseline.empty() ? "" : "   (new)") << endl;
+        return false;
+    }
+    double change = found->second.nsPerOp > 0 ? r.nsPerOp / found->second.nsPerOp - 1 : 0;
+    bool slower = change > threshold;
+    bool moreAllocations = r.allocsPerOp > found->second.allocsPerOp + 0.5;
+    snprintf(line, sizeof(line), "   %+6.1f%%", change * 100);
+    cout << line;
+    if (slower)
+        cout << "  SLOWER";
+    if (moreAllocations)
+        cout << "  MORE ALLOCATIONS (was " << found->second.allocsPerOp << ")";
+    cout << endl;
+    return slower  ||  moreAllocations;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        cout << "Usage: " << argv[0] << " mapdata.txt deliveries.txt [--filter text] [--output results.json]"
+             << " [--baseline results.json] [--threshold percent]" << endl;
+        return 1;
+    }
+    
+    string filter;
+    string outputFile;
+    string baselineFile;
+    double threshold = DEFAULT_THRESHOLD;
+    for (int i = 3; i + 1 < argc; i += 2)
+    {
+        string option = argv[i];
+        string value = argv[i + 1];
+        if (option == "--filter")
+            filter = value;
+        else if (option == "--output")
+            outputFile = value;
+        else if (option == "--baseline")
+            baselineFile = value;
+        else if (option == "--threshold")
+            threshold = atof(value.c_str()) / 100;
+        else
+        {
+            cerr << "Unknown option " << option << endl;
+            return 1;
+        }
+    }
+    
+    map<string, BenchmarkResult> baseline;
+    if (!baselineFile.empty()  &&  !readBaseline(baselineFile, baseline))
+    {
+        cerr << "Unable to read baseline file " << baselineFile << endl;
+        return 1;
+    }
+    Fixture fixture;
+    if (!setUpFixture(fixture, argv[1], argv[2]))
+    {
+        cerr << "Unable to load " << argv[1] << " and " << argv[2] << endl;
+        return 1;
+    }
+    
+    // run every benchmark whose name contains the filter, printing each result as soon as it's ready
+    vector<BenchmarkResult> results;
+    int numRegressions = 0;
+    vector<Benchmark> benchmarks = makeBenchmarks(fixture);
+    for (auto it = benchmarks.begin(); it != benchmarks.end(); ++it)
+    {
+        if (it->name.find(filter) == string::npos)
+            continue;
+        results.push_back(runBenchmark(*it));
+        if (printResult(results.back(), baseline, threshold))
+            ++numRegressions;
+    }
+    
+    if (!outputFile.empty())
+    {
+        ofstream outf(outputFile);
+        if (!outf)
+        {
+            cerr << "Unable to write results file " << outputFile << endl;
+            return 1;
+        }
+        writeResults(outf, fixture.mapFile, results);
+    }
+    if (!baseline.empty())
+        cout << numRegressions << " of " << results.size() << " benchmarks regressed" << endl;
+    return numRegressions == 0 ? 0 : 2;
+}
@@ -0,0 +1,592 @@
+#include "provided.h"
+#include "TimedDelivery.h"
+#include "FleetPlanner.h"
+#include "StreetGraph.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <random>
+#include <algorithm>
+#include <chrono>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <limits>
+using namespace std;
+
+// Separate program that measures how well and how quickly the delivery optimizers order deliveries.
+// Instances are either generated from the coordinates in the map data file or loaded from TSPLIB-style files; every
+// optimizer mode is run on every instance once per seed, and the results are written out as JSON.
+//
+// Modes: auto is DeliveryOptimizer, which solves small batches exactly and anneals the rest; timed is the time-window
+// local search of TimedDeliveryOptimizer; fleet splits the deliveries between vehicles with FleetPlanner and plans
+// every vehicle's route along the streets, so its miles are driven miles and are only compared with other fleet runs.
+
+// Instance sizes that are generated when none are given on the command line
+const int DEFAULT_SIZES[] = { 10, 15, 20, 24, 50, 100, 200 };
+// Larger sizes that are also generated with --scaling, and run once (with the first seed) in the modes that scale to
+// them. The annealer's time grows with about the cube of the size (10 seconds a call at 200 deliveries, 70 at 400), so
+// auto is only run on these if they're given with --sizes. Timed takes about 3, 50 and 1000 seconds a call on them and
+// fleet about 1, 2 and 3, which is why they're left out unless asked for.
+const int SCALING_SIZES[] = { 1000, 2000, 5000 };
+const char* const SCALING_MODES[] = { "timed", "fleet" };
+// Number of seeds each instance is run with when none is given on the command line
+const int DEFAULT_NUM_SEEDS = 3;
+// Seed that the coordinates of generated instances are picked with (mixed with the instance's size)
+const unsigned int INSTANCE_SEED = 20200311;
+// An optimizer is called repeatedly until at least this much time has passed, so that fast runs can be timed reliably
+const double MIN_MEASURE_SECONDS = 0.2;
+// Speed used by the timed optimizer, whose deliveries all have windows too wide to matter
+const double BENCHMARK_MILES_PER_HOUR = 25;
+// Deliveries each vehicle takes in fleet mode; there are just enough vehicles for all of them
+const int FLEET_VEHICLE_CAPACITY = 50;
+
+//******************** allocation counting *************************************
+
+// Every allocation the program makes goes through these replacements of the global operator new, so the
+// allocations made by an optimizer can be counted by reading the counters before and after calling it.
+
+atomic<long long> allocationCount(0);
+atomic<long long> allocatedBytes(0);
+
+void* operator new(size_t size)
+{
+    ++allocationCount;
+    allocatedBytes += size;
+    void* p = malloc(size == 0 ? 1 : size);
+    if (p == nullptr)
+        throw bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    operator delete(p);
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete[](void* p) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+    operator delete(p);
+}
+
+//******************** instances ***********************************************
+
+struct Instance
+{
+    string name;
+    GeoCoord depot;
+    vector<DeliveryRequest> deliveries;
+    double bestKnown;       // shortest known tour, in miles, as loaded from its file; 0 if none is known
+};
+
+struct RunResult
+{
+    string instance;
+    string mode;
+    int size;
+    unsigned int seed;
+    double startMiles;
+    double endMiles;
+    double bestKnown;       // what endMiles is measured against
+    double newBest;         // fewest miles any run found, if that beats a best known tour loaded from a file; else 0
+    double seconds;         // wall time of a single call
+    double callsPerSecond;
+    long long allocations;  // allocations made by a single call
+    long long bytes;        // bytes allocated by a single call
+};
+
+/*
+ Collects every distinct coordinate that starts or ends a segment in a map data file.
+ */
+bool loadMapCoordinates(string mapFile, vector<GeoCoord>& coords)
+{
+    ifstream inf(mapFile);
+    if (!inf)
+        return false;
+    set<pair<string, string>> seen;
+    string line;
+    while (getline(inf, line))
+    {
+        // every street name is followed by a line with its number of segments, then one line per segment
+        int numSegments;
+        if (!(inf >> numSegments))
+            return false;
+        inf.ignore(10000, '\n');
+        for (int i = 0; i < numSegments  &&  getline(inf, line); ++i)
+        {
+            istringstream iss(line);
+            string lat;
+            string lon;
+            while (iss >> lat >> lon)
+                if (seen.insert(make_pair(lat, lon)).second)
+                    coords.push_back(GeoCoord(lat, lon));
+        }
+    }
+    return !coords.empty();
+}
+
+/*
+ Drops the coordinates outside the map's largest strongly connected component, so every delivery of a generated
+ instance can be driven to from the depot and back, and fleet runs can plan every route.
+ */
+void keepLargestComponent(const StreetMap& sm, vector<GeoCoord>& coords)
+{
+    const StreetGraph* graph = getStreetGraph(&sm);
+    vector<int> componentSizes(graph->numStrongComponents(), 0);
+    for (int node = 0; node < graph->numNodes(); ++node)
+        ++componentSizes[graph->strongComponent(node)];
+    int largest = static_cast<int>(max_element(componentSizes.begin(), componentSizes.end()) - componentSizes.begin());
+    vector<GeoCoord> kept;
+    for (auto it = coords.begin(); it != coords.end(); ++it)
+        if (graph->strongComponent(graph->findNode(*it)) == largest)
+            kept.push_back(*it);
+    coords.swap(kept);
+}
+
+/*
+ Builds an instance of a given size out of distinct map coordinates picked with a seed that only depends on the size,
+ so the same instance is generated every time.
+ */
+Instance generateInstance(const vector<GeoCoord>& coords, int size)
+{
+    mt19937 generator(INSTANCE_SEED + size);
+    vector<int> picks;
+    for (int i = 0; i < static_cast<int>(coords.size()); ++i)
+        picks.push_back(i);
+    for (int i = 0; i <= size  &&  i < static_cast<int>(picks.size()); ++i)
+        swap(picks[i], picks[i + generator() % (picks.size() - i)]);
+    
+    Instance instance;
+    instance.name = "map-" + to_string(size);
+    instance.depot = coords[picks[0]];
+    for (int i = 1; i <= size  &&  i < static_cast<int>(picks.size()); ++i)
+        instance.deliveries.push_back(DeliveryRequest("stop " + to_string(i), coords[picks[i]]));
+    instance.bestKnown = 0;
+    return instance;
+}
+
+/*
+ Loads an instance from a TSPLIB-style file. Node coordinates are latitude and longitude in degrees, distances are
+ haversine miles, and the first node is the depot. A BEST_KNOWN line, if there is one, gives the shortest known tour.
+ */
+bool loadInstance(string instanceFile, Instance& instance)
+{
+    ifstream inf(instanceFile);
+    if (!inf)
+        return false;
+    instance.name = instanceFile;
+    instance.bestKnown = 0;
+    instance.deliveries.clear();
+    bool readingNodes = false;
+    bool haveDepot = false;
+    string line;
+    while (getline(inf, line))
+    {
+        if (line.empty())
+            continue;
+        if (line == "EOF")
+            break;
+        if (readingNodes)
+        {
+            istringstream iss(line);
+            string id;
+            string lat;
+            string lon;
+            if (!(iss >> id >> lat >> lon))
+                return false;
+            if (!haveDepot)
+                instance.depot = GeoCoord(lat, lon);
+            else
+                instance.deliveries.push_back(DeliveryRequest("node " + id, GeoCoord(lat, lon)));
+            haveDepot = true;
+            continue;
+        }
+        if (line.compare(0, 18, "NODE_COORD_SECTION") == 0)
+        {
+            readingNodes = true;
+            continue;
+        }
+        
+        // header lines look like "KEY : value"
+        size_t colon = line.find(':');
+        if (colon == string::npos)
+            continue;
+        string key = line.substr(0, colon);
+        key.erase(key.find_last_not_of(' ') + 1);
+        string value = line.substr(colon + 1);
+        value.erase(0, value.find_first_not_of(' '));
+        if (key == "NAME")
+            instance.name = value;
+        else if (key == "BEST_KNOWN")
+            instance.bestKnown = atof(value.c_str());
+    }
+    return haveDepot;
+}
+
+/*
+ Writes an instance to a TSPLIB-style file that loadInstance can read back.
+ */
+bool writeInstance(string instanceFile, const Instance& instance)
+{
+    ofstream outf(instanceFile);
+    if (!outf)
+        return false;
+    outf << "NAME : " << instance.name << "\n";
+    outf << "TYPE : TSP\n";
+    outf << "COMMENT : GooberEats deliveries; node 1 is the depot\n";
+    outf << "DIMENSION : " << instance.deliveries.size() + 1 << "\n";
+    outf << "EDGE_WEIGHT_TYPE : HAVERSINE_MILES\n";
+    if (instance.bestKnown > 0)
+    {
+        outf.setf(ios::fixed);
+        outf.precision(6);
+        outf << "BEST_KNOWN : " << instance.bestKnown << "\n";
+    }
+    outf << "NODE_COORD_SECTION\n";
+    outf << 1 << " " << instance.depot.latitudeText << " " << instance.depot.longitudeText << "\n";
+    for (int i = 0; i < static_cast<int>(instance.deliveries.size()); ++i)
+    {
+        const GeoCoord& location = instance.deliveries[i].location;
+        outf << i + 2 << " " << location.latitudeText << " " << location.longitudeText << "\n";
+    }
+    outf << "EOF\n";
+    return true;
+}
+
+//******************** runs ****************************************************
+
+/*
+ Returns the crow distance from the depot through the deliveries in order and back.
+ */
+double crowTourMiles(const GeoCoord& depot, const vector<DeliveryRequest>& deliveries)
+{
+    double miles = 0;
+    GeoCoord previous = depot;
+    for (auto it = deliveries.begin(); it != deliveries.end(); ++it)
+    {
+        miles += distanceEarthMiles(previous, it->location);
+        previous = it->location;
+    }
+    return miles + distanceEarthMiles(previous, depot);
+}
+
+/*
+ Runs one optimizer mode on an instance whose deliveries are shuffled with a seed, calling the optimizer until
+ MIN_MEASURE_SECONDS have passed and reporting the cost of a single call. A fleet run's start is the crow distance of
+ one vehicle visiting the deliveries in the shuffled order, and its end is the miles its vehicles drive.
+ */
+RunResult runOptimizer(const StreetMap& sm, const Instance& instance, string mode, unsigned int seed)
+{
+    RunResult result;
+    result.instance = instance.name;
+    result.mode = mode;
+    result.size = static_cast<int>(instance.deliveries.size());
+    result.seed = seed;
+    
+    // every seed starts the optimizer from a different order of the same deliveries
+    vector<DeliveryRequest> start = instance.deliveries;
+    mt19937 generator(seed);
+    shuffle(start.begin(), start.end(), generator);
+    vector<TimedDeliveryRequest> timedStart;
+    for (auto it = start.begin(); it != start.end(); ++it)
+        timedStart.push_back(TimedDeliveryRequest(it->item, it->location, 0, numeric_limits<double>::max(), 0));
+    
+    DeliveryOptimizer optimizer(&sm);
+    TimedDeliveryOptimizer timedOptimizer(&sm);
+    FleetPlanner fleetPlanner(&sm);
+    const int NUM_VEHICLES = (result.size + FLEET_VEHICLE_CAPACITY - 1) / FLEET_VEHICLE_CAPACITY;
+    int numCalls = 0;
+    long long startAllocations = allocationCount;
+    long long startBytes = allocatedBytes;
+    auto startTime = chrono::steady_clock::now();
+    double elapsed = 0;
+    while (numCalls == 0  ||  elapsed < MIN_MEASURE_SECONDS)
+    {
+        if (mode == "timed")
+        {
+            vector<TimedDeliveryRequest> deliveries = timedStart;
+            timedOptimizer.optimizeDeliveryOrder(instance.depot, 0, BENCHMARK_MILES_PER_HOUR, deliveries,
+                                                 result.startMiles, result.endMiles);
+        }
+        else if (mode == "fleet")
+        {
+            vector<vector<DeliveryCommand>> vehicleCommands;
+            vector<double> vehicleDistances;
+            vector<DeliveryRequest> unassigned;
+            if (fleetPlanner.generateFleetPlan(instance.depot, start, NUM_VEHICLES, FLEET_VEHICLE_CAPACITY, 0,
+                                               vehicleCommands, vehicleDistances, unassigned) != DELIVERY_SUCCESS)
+                cerr << "A vehicle's route in " << instance.name << " couldn't be planned" << endl;
+            result.startMiles = crowTourMiles(instance.depot, start);
+            result.endMiles = 0;
+            for (auto it = vehicleDistances.begin(); it != vehicleDistances.end(); ++it)
+                result.endMiles += *it;
+        }
+        else
+        {
+            vector<DeliveryRequest> deliveries = start;
+            optimizer.optimizeDeliveryOrder(instance.depot, deliveries, result.startMiles, result.endMiles);
+        }
+        ++numCalls;
+        elapsed = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+    }
+    
+    result.seconds = elapsed / numCalls;
+    result.callsPerSecond = numCalls / elapsed;
+    result.allocations = (allocationCount - startAllocations) / numCalls;
+    result.bytes = (allocatedBytes - startBytes) / numCalls;
+    return result;
+}
+
+/*
+ Writes a string as a JSON string literal.
+ */
+void writeJsonString(ostream& out, const string& s)
+{
+    out << '"';
+    for (auto it = s.begin(); it != s.end(); ++it)
+    {
+        if (*it == '"'  ||  *it == '\\')
+            out << '\\' << *it;
+        else if (static_cast<unsigned char>(*it) < 0x20)
+            out << ' ';
+        else
+            out << *it;
+    }
+    out << '"';
+}
+
+/*
+ Writes every run as JSON; each run's gap is how much longer its tour is than the best it's measured against.
+ */
+void writeResults(ostream& out, string mapFile, const vector<RunResult>& results)
+{
+    out.setf(ios::fixed);
+    out << "{\n  \"benchmark\": \"optimizer\",\n  \"map\": ";
+    writeJsonString(out, mapFile);
+    out << ",\n  \"runs\": [";
+    for (int i = 0; i < static_cast<int>(results.size()); ++i)
+    {
+        const RunResult& r = results[i];
+        out << (i == 0 ? "\n" : ",\n") << "    {\"instance\": ";
+        writeJsonString(out, r.instance);
+        out.precision(6);
+        out << ", \"mode\": \"" << r.mode << "\", \"size\": " << r.size << ", \"seed\": " << r.seed
+            << ", \"startMiles\": " << r.startMiles << ", \"miles\": " << r.endMiles
+            << ", \"bestKnownMiles\": " << r.bestKnown;
+        out.precision(3);
+        out << ", \"gapPercent\": " << (r.bestKnown > 0 ? (r.endMiles / r.bestKnown - 1) * 100 : 0);
+        out.precision(6);
+        if (r.newBest > 0)
+            out << ", \"newBestMiles\": " << r.newBest;
+        out << ", \"seconds\": " << r.seconds;
+        out.precision(1);
+        out << ", \"callsPerSecond\": " << r.callsPerSecond
+            << ", \"allocations\": " << r.allocations << ", \"allocatedBytes\": " << r.bytes << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+/*
+ Splits a comma-separated list.
+ */
+vector<string> splitList(string list)
+{
+    vector<string> items;
+    istringstream iss(list);
+    string item;
+    while (getline(iss, item, ','))
+        if (!item.empty())
+            items.push_back(item);
+    return items;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        cout << "Usage: " << argv[0] << " mapdata.txt [--sizes 10,20,...] [--scaling] [--seeds N]"
+             << " [--modes auto,timed,fleet] [--instance file.tsp]... [--write-instances directory]"
+             << " [--output results.json]" << endl;
+        return 1;
+    }
+    
+    string mapFile = argv[1];
+    vector<int> sizes;
+    vector<string> instanceFiles;
+    vector<string> modes = { "auto", "timed", "fleet" };
+    int numSeeds = DEFAULT_NUM_SEEDS;
+    string instanceDirectory;
+    string outputFile;
+    bool scaling = false;
+    for (int i = 2; i < argc; ++i)
+    {
+        string option = argv[i];
+        if (option == "--scaling")
+        {
+            scaling = true;
+            continue;
+        }
+        if (i + 1 == argc)
+        {
+            cerr << "Option " << option << " needs a value" << endl;
+            return 1;
+        }
+        string value = argv[++i];
+        if (option == "--sizes")
+        {
+            vector<string> items = splitList(value);
+            for (auto it = items.begin(); it != items.end(); ++it)
+                sizes.push_back(atoi(it->c_str()));
+        }
+        else if (option == "--seeds")
+            numSeeds = max(1, atoi(value.c_str()));
+        else if (option == "--modes")
+            modes = splitList(value);
+        else if (option == "--instance")
+            instanceFiles.push_back(value);
+        else if (option == "--write-instances")
+            instanceDirectory = value;
+        else if (option == "--output")
+            outputFile = value;
+        else
+        {
+            cerr << "Unknown option " << option << endl;
+            return 1;
+        }
+    }
+    if (sizes.empty()  &&  instanceFiles.empty())
+        sizes.assign(begin(DEFAULT_SIZES), end(DEFAULT_SIZES));
+    
+    // the scaling sizes only run in some modes, unless they were also given with --sizes
+    set<int> scalingSizes;
+    for (auto it = begin(SCALING_SIZES); scaling  &&  it != end(SCALING_SIZES); ++it)
+        if (find(sizes.begin(), sizes.end(), *it) == sizes.end())
+        {
+            sizes.push_back(*it);
+            scalingSizes.insert(*it);
+        }
+    
+    StreetMap sm;
+    vector<GeoCoord> coords;
+    if (!sm.load(mapFile)  ||  !loadMapCoordinates(mapFile, coords))
+    {
+        cerr << "Unable to load map data file " << mapFile << endl;
+        return 1;
+    }
+    keepLargestComponent(sm, coords);
+    
+    // gather the instances, keeping the order they were asked for in
+    vector<string> order;
+    map<string, Instance> instances;
+    for (auto it = sizes.begin(); it != sizes.end(); ++it)
+    {
+        Instance instance = generateInstance(coords, *it);
+        order.push_back(instance.name);
+        instances[instance.name] = instance;
+    }
+    for (auto it = instanceFiles.begin(); it != instanceFiles.end(); ++it)
+    {
+        Instance instance;
+        if (!loadInstance(*it, instance))
+        {
+            cerr << "Unable to load instance file " << *it << endl;
+            return 1;
+        }
+        order.push_back(instance.name);
+        instances[instance.name] = instance;
+    }
+    
+    // run every mode on every instance with every seed
+    vector<RunResult> results;
+    for (auto it = order.begin(); it != order.end(); ++it)
+    {
+        int size = static_cast<int>(instances[*it].deliveries.size());
+        bool scalingSize = scalingSizes.count(size) > 0;
+        for (auto mode = modes.begin(); mode != modes.end(); ++mode)
+        {
+            if (scalingSize  &&  find(begin(SCALING_MODES), end(SCALING_MODES), *mode) == end(SCALING_MODES))
+                continue;
+            for (unsigned int seed = 1; seed <= static_cast<unsigned int>(scalingSize ? 1 : numSeeds); ++seed)
+            {
+                cerr << "Running " << *mode << " on " << *it << " with seed " << seed << "..." << endl;
+                results.push_back(runOptimizer(sm, instances[*it], *mode, seed));
+            }
+        }
+    }
+    
+    // an instance's best known tour from its file stays the reference even when a run beats it, which is reported
+    // separately; an instance without one is measured against the best tour any run found for it, and a fleet run
+    // against the fewest miles any fleet run drove on it
+    map<string, double> bestMiles;
+    map<string, double> bestFleetMiles;
+    for (auto it = results.begin(); it != results.end(); ++it)
+    {
+        map<string, double>& best = it->mode == "fleet" ? bestFleetMiles : bestMiles;
+        auto found = best.find(it->instance);
+        if (found == best.end()  ||  it->endMiles < found->second)
+            best[it->instance] = it->endMiles;
+    }
+    for (auto it = results.begin(); it != results.end(); ++it)
+    {
+        double fileBest = instances[it->instance].bestKnown;
+        it->newBest = 0;
+        if (it->mode == "fleet")
+            it->bestKnown = bestFleetMiles[it->instance];
+        else if (fileBest <= 0)
+            it->bestKnown = bestMiles[it->instance];
+        else
+        {
+            it->bestKnown = fileBest;
+            if (bestMiles[it->instance] < fileBest)
+                it->newBest = bestMiles[it->instance];
+        }
+    }
+    
+    if (!instanceDirectory.empty())
+    {
+        for (auto it = instances.begin(); it != instances.end(); ++it)
+        {
+            // a written instance carries the shortest tour known once this run is done
+            auto found = bestMiles.find(it->first);
+            if (found != bestMiles.end()  &&  (it->second.bestKnown <= 0  ||  found->second < it->second.bestKnown))
+                it->second.bestKnown = found->second;
+            string fileName = it->second.name;
+            replace(fileName.begin(), fileName.end(), '/', '_');
+            if (!writeInstance(instanceDirectory + "/" + fileName + ".tsp", it->second))
+                cerr << "Unable to write instance " << it->second.name << endl;
+        }
+    }
+    
+    if (outputFile.empty())
+        writeResults(cout, mapFile, results);
+    else
+    {
+        ofstream outf(outputFile);
+        if (!outf)
+        {
+            cerr << "Unable to write results file " << outputFile << endl;
+            return 1;
+        }
+        writeResults(outf, mapFile, results);
+    }
+}
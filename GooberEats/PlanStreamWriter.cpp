@@ -0,0 +1,352 @@
+#include "provided.h"
+#include "PlanStreamWriter.h"
+#include <string>
+#include <vector>
+#include <list>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+using namespace std;
+
+// Buffered bytes past which a plan's records are written out before the plan ends, so huge plans stay bounded
+const size_t MAX_BUFFERED_BYTES = 1 << 20;
+
+// Feet per mile, for geometry tolerances
+const double FEET_PER_MILE = 5280;
+
+// Types of binary records
+const unsigned char PLAN_RECORD = 1;
+const unsigned char TEXT_RECORD = 2;
+const unsigned char LEG_RECORD = 3;
+const unsigned char END_RECORD = 4;
+
+// Statuses of END records, in the order of their binary codes
+const int UNREADABLE_STATUS = 3;
+const char* const STATUS_NAMES[] = { "ok", "no_route", "bad_coord", "unreadable" };
+
+// Names of command actions, in the order of their binary codes
+const char* const ACTION_NAMES[] = { "proceed", "turn", "deliver" };
+
+PlanStreamWriter::PlanStreamWriter(ostream& out, PlanFormat format, const GeometryOptions& geometry)
+    : m_out(out), m_format(format), m_options(geometry), m_numLegs(0), m_numTextsSent(0)
+{
+    m_buffer.reserve(64 * 1024);
+}
+
+/*
+ Destructor for PlanStreamWriter; anything a caller forgot to end is still written out.
+ */
+PlanStreamWriter::~PlanStreamWriter()
+{
+    if (!m_buffer.empty())
+    {
+        m_out.write(m_buffer.data(), m_buffer.size());
+        m_out.flush();
+    }
+}
+
+void PlanStreamWriter::beginPlan(const string& name, const GeoCoord& depot, size_t numDeliveries)
+{
+    m_numLegs = 0;
+    m_numTextsSent = 0;
+    if (m_format == PlanFormat::NDJSON)
+    {
+        append("{\"type\":\"plan\",\"name\":");
+        appendJsonString(name);
+        append(",\"depot\":");
+        appendCoordinate(depot.latitude, depot.longitude);
+        append(",\"deliveries\":");
+        append(to_string(numDeliveries));
+        append("}\n");
+    }
+    else
+    {
+        size_t start = beginRecord(PLAN_RECORD);
+        appendString(name);
+        appendDouble(depot.latitude);
+        appendDouble(depot.longitude);
+        appendInteger(numDeliveries, 4);
+        appendInteger(m_options.polyline ? 1 : 0, 1);
+        endRecord(start);
+    }
+}
+
+void PlanStreamWriter::writeLeg(const CompactPlan& plan, size_t firstCommand, const list<StreetSegment>& route, double miles)
+{
+    m_geometry.clear();
+    m_geometry.addRoute(route);
+    writeLeg(plan, firstCommand, miles);
+}
+
+void PlanStreamWriter::writeLeg(const CompactPlan& plan,
+                                size_t firstCommand,
+                                const StreetGraph& graph,
+                                const vector<int>& edges,
+                                double miles)
+{
+    m_geometry.clear();
+    m_geometry.addRoute(graph, edges);
+    writeLeg(plan, firstCommand, miles);
+}
+
+/*
+ Formats one leg's commands and the points of its geometry, which is simplified first if the options say so. Binary
+ legs refer to text by id, so any text the plan gained since the last leg is sent first.
+ */
+void PlanStreamWriter::writeLeg(const CompactPlan& plan, size_t firstCommand, double miles)
+{
+    if (m_options.simplify  ||  m_options.polyline)
+    {
+        m_geometry.mergeCollinear();
+        if (m_options.toleranceFeet > 0)
+            m_geometry.simplify(m_options.toleranceFeet / FEET_PER_MILE);
+    }
+    if (m_options.polyline)
+    {
+        m_polyline.clear();
+        m_geometry.appendPolyline(m_polyline, m_options.polylinePrecision);
+    }
+
+    if (m_format == PlanFormat::NDJSON)
+    {
+        append("{\"type\":\"leg\",\"index\":");
+        append(to_string(m_numLegs));
+        append(",\"miles\":");
+        appendNumber(miles, 6);
+        append(",\"commands\":[");
+        for (size_t i = firstCommand; i < plan.size(); ++i)
+        {
+            const CompactCommand& command = plan[i];
+            append(i > firstCommand ? ",{\"action\":\"" : "{\"action\":\"");
+            append(ACTION_NAMES[command.type]);
+            switch (command.type)
+            {
+              case CompactCommand::PROCEED:
+                append("\",\"direction\":\"");
+                append(headingName(command.heading));
+                append("\",\"street\":");
+                appendJsonString(plan.text(command.text));
+                append(",\"miles\":");
+                appendNumber(command.miles, 6);
+                break;
+              case CompactCommand::TURN:
+                append("\",\"direction\":\"");
+                append(turnName(command.turn));
+                append("\",\"street\":");
+                appendJsonString(plan.text(command.text));
+                break;
+              case CompactCommand::DELIVER:
+                append("\",\"item\":");
+                appendJsonString(plan.text(command.text));
+                break;
+            }
+            append("}");
+        }
+        if (m_options.polyline)
+        {
+            append("],\"polyline\":");
+            appendJsonString(m_polyline);
+            append("}\n");
+        }
+        else
+        {
+            append("],\"geometry\":[");
+            for (size_t i = 0; i < m_geometry.size(); ++i)
+            {
+                if (i > 0)
+                    append(",");
+                appendCoordinate(m_geometry.latitude(i), m_geometry.longitude(i));
+            }
+            append("]}\n");
+        }
+    }
+    else
+    {
+        for (; m_numTextsSent < plan.numTexts(); ++m_numTextsSent)
+        {
+            size_t start = beginRecord(TEXT_RECORD);
+            appendInteger(m_numTextsSent, 4);
+            appendString(plan.text(m_numTextsSent));
+            endRecord(start);
+        }
+        size_t start = beginRecord(LEG_RECORD);
+        appendInteger(m_numLegs, 4);
+        appendDouble(miles);
+        appendInteger(plan.size() - firstCommand, 4);
+        for (size_t i = firstCommand; i < plan.size(); ++i)
+        {
+            const CompactCommand& command = plan[i];
+            appendInteger(command.type, 1);
+            appendInteger(command.type == CompactCommand::TURN ? static_cast<unsigned long>(command.turn)
+                                                                 : static_cast<unsigned long>(command.heading), 1);
+            appendInteger(command.text, 4);
+            appendFloat(command.miles);
+        }
+        if (m_options.polyline)
+        {
+            appendInteger(m_polyline.size(), 4);
+            append(m_polyline);
+        }
+        else
+        {
+            appendInteger(m_geometry.size(), 4);
+            for (size_t i = 0; i < m_geometry.size(); ++i)
+            {
+                appendDouble(m_geometry.latitude(i));
+                appendDouble(m_geometry.longitude(i));
+            }
+        }
+        endRecord(start);
+    }
+    ++m_numLegs;
+    
+    // a plan with an enormous number of legs is written out in pieces rather than held in memory
+    if (m_buffer.size() > MAX_BUFFERED_BYTES)
+    {
+        m_out.write(m_buffer.data(), m_buffer.size());
+        m_buffer.clear();
+    }
+}
+
+void PlanStreamWriter::endPlan(DeliveryResult result, double totalMiles)
+{
+    finishPlan(static_cast<int>(result), totalMiles);
+}
+
+void PlanStreamWriter::endUnreadablePlan()
+{
+    finishPlan(UNREADABLE_STATUS, 0);
+}
+
+/*
+ Formats the END record, then writes out and flushes the whole plan.
+ */
+void PlanStreamWriter::finishPlan(int status, double totalMiles)
+{
+    if (m_format == PlanFormat::NDJSON)
+    {
+        append("{\"type\":\"end\",\"status\":\"");
+        append(STATUS_NAMES[status]);
+        append("\",\"miles\":");
+        appendNumber(totalMiles, 6);
+        append("}\n");
+    }
+    else
+    {
+        size_t start = beginRecord(END_RECORD);
+        appendInteger(status, 1);
+        appendDouble(totalMiles);
+        endRecord(start);
+    }
+    m_out.write(m_buffer.data(), m_buffer.size());
+    m_out.flush();
+    m_buffer.clear();
+}
+
+/*
+ Starts a binary record with its type and a placeholder for its length; returns where the record starts.
+ */
+size_t PlanStreamWriter::beginRecord(unsigned char type)
+{
+    size_t start = m_buffer.size();
+    appendInteger(type, 1);
+    appendInteger(0, 4);
+    return start;
+}
+
+/*
+ Fills in the length of the binary record that starts at start.
+ */
+void PlanStreamWriter::endRecord(size_t start)
+{
+    unsigned long length = m_buffer.size() - start - 5;
+    for (int i = 0; i < 4; ++i)
+        m_buffer[start + 1 + i] = static_cast<char>((length >> (8 * i)) & 0xFF);
+}
+
+void PlanStreamWriter::append(const char* text, size_t length)
+{
+    m_buffer.insert(m_buffer.end(), text, text + length);
+}
+
+void PlanStreamWriter::append(const char* text)
+{
+    append(text, strlen(text));
+}
+
+void PlanStreamWriter::append(const string& text)
+{
+    append(text.data(), text.size());
+}
+
+void PlanStreamWriter::appendNumber(double value, int precision)
+{
+    char number[32];
+    int length = snprintf(number, sizeof(number), "%.*f", precision, value);
+    append(number, length);
+}
+
+void PlanStreamWriter::appendJsonString(const string& text)
+{
+    append("\"", 1);
+    for (auto it = text.begin(); it != text.end(); ++it)
+    {
+        unsigned char c = static_cast<unsigned char>(*it);
+        if (c == '"'  ||  c == '\\')
+        {
+            char escaped[2] = { '\\', *it };
+            append(escaped, 2);
+        }
+        else if (c < 0x20)
+        {
+            char escaped[8];
+            int length = snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            append(escaped, length);
+        }
+        else
+            append(&*it, 1);
+    }
+    append("\"", 1);
+}
+
+/*
+ Formats a coordinate as a two-number JSON array, with as many decimal places as the map data uses.
+ */
+void PlanStreamWriter::appendCoordinate(double latitude, double longitude)
+{
+    append("[", 1);
+    appendNumber(latitude, 7);
+    append(",", 1);
+    appendNumber(longitude, 7);
+    append("]", 1);
+}
+
+void PlanStreamWriter::appendInteger(unsigned long value, int numBytes)
+{
+    for (int i = 0; i < numBytes; ++i)
+        m_buffer.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+void PlanStreamWriter::appendDouble(double value)
+{
+    unsigned long long bits;
+    static_assert(sizeof(bits) == sizeof(value), "doubles are written as 64-bit IEEE 754 values");
+    memcpy(&bits, &value, sizeof(bits));
+    for (int i = 0; i < 8; ++i)
+        m_buffer.push_back(static_cast<char>((bits >> (8 * i)) & 0xFF));
+}
+
+void PlanStreamWriter::appendFloat(float value)
+{
+    unsigned int bits;
+    static_assert(sizeof(bits) == sizeof(value), "floats are written as 32-bit IEEE 754 values");
+    memcpy(&bits, &value, sizeof(bits));
+    appendInteger(bits, 4);
+}
+
+void PlanStreamWriter::appendString(const string& text)
+{
+    size_t length = min(text.size(), static_cast<size_t>(0xFFFF));
+    appendInteger(length, 2);
+    append(text.data(), length);
+}
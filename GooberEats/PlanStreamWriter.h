@@ -0,0 +1,95 @@
+#ifndef PlanStreamWriter_h
+#define PlanStreamWriter_h
+
+#include "provided.h"
+#include "CompactPlan.h"
+#include "RouteGeometry.h"
+#include <string>
+#include <vector>
+#include <list>
+#include <ostream>
+
+// PlanStreamWriter.h
+
+// Writes delivery plans as machine-readable records instead of text. A plan is a PLAN record, one LEG record for every
+// leg as soon as it's routed (each delivery, then the return to the depot), and an END record. Records are formatted
+// into a buffer that's written out and flushed once per plan.
+//
+// NDJSON records are one JSON object per line:
+//     {"type":"plan","name":"deliveries.txt","depot":[34.0625329,-118.4470263],"deliveries":7}
+//     {"type":"leg","index":0,"miles":0.515098,
+//      "commands":[{"action":"proceed","direction":"north","street":"Broxton Avenue","miles":0.080214},
+//                  {"action":"turn","direction":"left","street":"Le Conte Avenue"},
+//                  {"action":"deliver","item":"Chicken tenders"}],
+//      "geometry":[[34.0625329,-118.4470263],[34.0632405,-118.4470467],...]}
+//     {"type":"end","status":"ok","miles":27.152051}
+// where status is "ok", "no_route", "bad_coord" or "unreadable" (the deliveries couldn't be read). A leg's geometry is
+// every point along its route unless GeometryOptions (see RouteGeometry.h) say to simplify it; with the polyline
+// option, "geometry" is replaced by "polyline":"_p~iF~ps|U_ulLnnqC".
+//
+// Binary records are a one-byte type, a four-byte length of the fields that follow, and the fields. Numbers are
+// little-endian and doubles and floats are IEEE 754; strings are a u16 length followed by their bytes.
+//     1 PLAN   string name, f64 depot latitude, f64 depot longitude, u32 number of deliveries,
+//              u8 geometry (0 points, 1 encoded polyline)
+//     2 TEXT   u32 id, string text        (a street name or item, sent before the first leg that refers to it)
+//     3 LEG    u32 index, f64 miles, u32 number of commands, then for every command
+//                  u8 action (0 proceed, 1 turn, 2 deliver), u8 heading or turn (as in CompactPlan.h),
+//                  u32 text id, f32 miles,
+//              then either u32 number of points and for every point f64 latitude, f64 longitude,
+//              or a u32 length and the encoded polyline
+//     4 END    u8 status (0 ok, 1 no route, 2 bad coordinate, 3 unreadable), f64 total miles
+
+enum class PlanFormat { NDJSON, BINARY };
+
+class PlanStreamWriter
+{
+public:
+    PlanStreamWriter(std::ostream& out, PlanFormat format, const GeometryOptions& geometry = GeometryOptions());
+    ~PlanStreamWriter();
+
+    void beginPlan(const std::string& name, const GeoCoord& depot, size_t numDeliveries);
+
+      // Writes the leg made up of plan's commands from firstCommand on, which follow route (miles long).
+    void writeLeg(const CompactPlan& plan, size_t firstCommand, const std::list<StreetSegment>& route, double miles);
+
+      // Same as above for a route given as edges of the map's graph.
+    void writeLeg(const CompactPlan& plan,
+                  size_t firstCommand,
+                  const StreetGraph& graph,
+                  const std::vector<int>& edges,
+                  double miles);
+
+      // End the plan and write it out; endUnreadablePlan is for deliveries that couldn't be read at all.
+    void endPlan(DeliveryResult result, double totalMiles);
+    void endUnreadablePlan();
+
+      // We prevent a PlanStreamWriter object from being copied or assigned.
+    PlanStreamWriter(const PlanStreamWriter&) = delete;
+    PlanStreamWriter& operator=(const PlanStreamWriter&) = delete;
+private:
+    std::ostream& m_out;
+    PlanFormat m_format;
+    GeometryOptions m_options;
+    RouteGeometry m_geometry;
+    std::string m_polyline;
+    std::vector<char> m_buffer;
+    int m_numLegs;
+    int m_numTextsSent;
+
+    void writeLeg(const CompactPlan& plan, size_t firstCommand, double miles);
+    void finishPlan(int status, double totalMiles);
+    size_t beginRecord(unsigned char type);
+    void endRecord(size_t start);
+    void append(const char* text, size_t length);
+    void append(const char* text);
+    void append(const std::string& text);
+    void appendNumber(double value, int precision);
+    void appendJsonString(const std::string& text);
+    void appendCoordinate(double latitude, double longitude);
+    void appendInteger(unsigned long value, int numBytes);
+    void appendDouble(double value);
+    void appendFloat(float value);
+    void appendString(const std::string& text);
+};
+
+#endif /* PlanStreamWriter_h */
@@ -0,0 +1,185 @@
+#include "provided.h"
+#include "RouteGeometry.h"
+#include "StreetGraph.h"
+#include <string>
+#include <vector>
+#include <list>
+#include <cmath>
+using namespace std;
+
+// Miles per degree of latitude (and of longitude at the equator)
+const double MILES_PER_DEGREE = 69.0933;
+// Furthest (in miles, about half an inch) a point can be from the line through its neighbours and still be on it
+const double COLLINEAR_MILES = 1e-5;
+
+RouteGeometry::RouteGeometry()
+{
+}
+
+void RouteGeometry::clear()
+{
+    m_points.clear();
+}
+
+void RouteGeometry::addRoute(const list<StreetSegment>& route)
+{
+    if (route.empty())
+        return;
+    addPoint(route.front().start.latitude, route.front().start.longitude);
+    for (auto it = route.begin(); it != route.end(); ++it)
+        addPoint(it->end.latitude, it->end.longitude);
+}
+
+void RouteGeometry::addRoute(const StreetGraph& graph, const vector<int>& edges)
+{
+    if (edges.empty())
+        return;
+    const GeoCoord& start = graph.coord(graph.edgeFrom(edges.front()));
+    addPoint(start.latitude, start.longitude);
+    for (auto it = edges.begin(); it != edges.end(); ++it)
+    {
+        const GeoCoord& end = graph.coord(graph.edgeTo(*it));
+        addPoint(end.latitude, end.longitude);
+    }
+}
+
+/*
+ Walks the points once, comparing each one with the line from the last point that was kept to the point after it, so a
+ long straight run collapses to its two ends.
+ */
+void RouteGeometry::mergeCollinear()
+{
+    if (size() < 3)
+        return;
+    m_keep.assign(size(), 0);
+    m_keep.front() = m_keep.back() = 1;
+    size_t lastKept = 0;
+    for (size_t i = 1; i + 1 < size(); ++i)
+    {
+        if (offsetMiles(i, lastKept, i + 1) > COLLINEAR_MILES)
+        {
+            m_keep[i] = 1;
+            lastKept = i;
+        }
+    }
+    keepMarked();
+}
+
+/*
+ Douglas-Peucker simplification: a range of points is replaced by the line between its ends unless some point in it is
+ further than the tolerance from that line, in which case the furthest point is kept and both halves are simplified the
+ same way. Ranges are kept on a stack instead of recursing, so long routes can't overflow the call stack.
+ */
+void RouteGeometry::simplify(double toleranceMiles)
+{
+    if (size() < 3)
+        return;
+    m_keep.assign(size(), 0);
+    m_keep.front() = m_keep.back() = 1;
+    m_ranges.clear();
+    m_ranges.push_back(0);
+    m_ranges.push_back(size() - 1);
+    while (!m_ranges.empty())
+    {
+        size_t last = m_ranges.back();
+        m_ranges.pop_back();
+        size_t first = m_ranges.back();
+        m_ranges.pop_back();
+        
+        // find the point furthest from the line between the ends of the range
+        double furthestMiles = 0;
+        size_t furthest = first;
+        for (size_t i = first + 1; i < last; ++i)
+        {
+            double miles = offsetMiles(i, first, last);
+            if (miles > furthestMiles)
+            {
+                furthestMiles = miles;
+                furthest = i;
+            }
+        }
+        if (furthestMiles > toleranceMiles)
+        {
+            m_keep[furthest] = 1;
+            m_ranges.push_back(first);
+            m_ranges.push_back(furthest);
+            m_ranges.push_back(furthest);
+            m_ranges.push_back(last);
+        }
+    }
+    keepMarked();
+}
+
+/*
+ Encodes every coordinate as its difference from the previous point's, rounded to the precision, in chunks of five bits
+ (lowest first) that are each written as a printable character; the sign goes in the lowest bit.
+ */
+void RouteGeometry::appendPolyline(string& out, int precision) const
+{
+    const double FACTOR = pow(10.0, precision);
+    long long previous[2] = { 0, 0 };
+    for (size_t i = 0; i < m_points.size(); ++i)
+    {
+        long long value = llround(m_points[i] * FACTOR);
+        long long delta = value - previous[i % 2];
+        previous[i % 2] = value;
+        unsigned long long bits = delta < 0 ? ~(static_cast<unsigned long long>(delta) << 1)
+                                            : static_cast<unsigned long long>(delta) << 1;
+        while (bits >= 0x20)
+        {
+            out += static_cast<char>((0x20 | (bits & 0x1F)) + 63);
+            bits >>= 5;
+        }
+        out += static_cast<char>(bits + 63);
+    }
+}
+
+/*
+ Adds a point, unless it's the same as the last one (as when a leg starts where the one before it ended).
+ */
+void RouteGeometry::addPoint(double latitude, double longitude)
+{
+    if (!m_points.empty()  &&  m_points[m_points.size() - 2] == latitude  &&  m_points.back() == longitude)
+        return;
+    m_points.push_back(latitude);
+    m_points.push_back(longitude);
+}
+
+/*
+ Returns how far (in miles) a point is from the line between two others. Over the length of a route the earth is flat
+ enough to measure on a plane with longitude scaled for the latitude.
+ */
+double RouteGeometry::offsetMiles(size_t point, size_t first, size_t last) const
+{
+    const double X_SCALE = MILES_PER_DEGREE * cos(deg2rad(latitude(first)));
+    double x = (longitude(point) - longitude(first)) * X_SCALE;
+    double y = (latitude(point) - latitude(first)) * MILES_PER_DEGREE;
+    double lineX = (longitude(last) - longitude(first)) * X_SCALE;
+    double lineY = (latitude(last) - latitude(first)) * MILES_PER_DEGREE;
+    
+    // the closest spot on the line is where the point projects onto it, as long as that's between its ends
+    double lengthSquared = lineX * lineX + lineY * lineY;
+    double along = lengthSquared > 0 ? (x * lineX + y * lineY) / lengthSquared : 0;
+    along = along < 0 ? 0 : along > 1 ? 1 : along;
+    double dx = x - along * lineX;
+    double dy = y - along * lineY;
+    return sqrt(dx * dx + dy * dy);
+}
+
+/*
+ Removes every point that isn't marked to be kept, moving the rest down in place.
+ */
+void RouteGeometry::keepMarked()
+{
+    size_t kept = 0;
+    for (size_t i = 0; i < size(); ++i)
+    {
+        if (m_keep[i])
+        {
+            m_points[2 * kept] = m_points[2 * i];
+            m_points[2 * kept + 1] = m_points[2 * i + 1];
+            ++kept;
+        }
+    }
+    m_points.resize(2 * kept);
+}
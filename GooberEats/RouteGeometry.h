@@ -0,0 +1,68 @@
+#ifndef RouteGeometry_h
+#define RouteGeometry_h
+
+#include "provided.h"
+#include <string>
+#include <vector>
+#include <list>
+
+// RouteGeometry.h
+
+// The shape of a route as a flat array of points, for clients that draw it rather than follow its commands. A route's
+// segments become one point per segment end; points that lie on a straight line between their neighbours can be
+// dropped, and the rest can be thinned out with Douglas-Peucker simplification to within a tolerance. The points can
+// then be written as an encoded polyline (the format Google's map APIs use), which takes a few bytes per point.
+
+class StreetGraph;
+
+struct GeometryOptions
+{
+    GeometryOptions()
+     : simplify(false), toleranceFeet(0), polyline(false), polylinePrecision(5)
+    {}
+
+    bool simplify;          // drop points on straight lines, and more within the tolerance
+    double toleranceFeet;   // furthest the simplified shape may stray from the route; 0 keeps every bend
+    bool polyline;          // write the points as an encoded polyline instead of coordinates
+    int polylinePrecision;  // decimal places the polyline keeps; 5 is the usual, 6 is used by some routing engines
+};
+
+class RouteGeometry
+{
+public:
+    RouteGeometry();
+
+    void clear();
+
+      // Append the points of a route, given as segments or as edges of the map's graph; a route that's empty (its
+      // start and end are the same) adds no points.
+    void addRoute(const std::list<StreetSegment>& route);
+    void addRoute(const StreetGraph& graph, const std::vector<int>& edges);
+
+      // Drops every point that lies on a straight line between the points on either side of it.
+    void mergeCollinear();
+
+      // Drops points (never the first or last) as long as no part of the route is further than toleranceMiles from
+      // the shape that's left.
+    void simplify(double toleranceMiles);
+
+    size_t size() const { return m_points.size() / 2; }
+    double latitude(size_t i) const { return m_points[2 * i]; }
+    double longitude(size_t i) const { return m_points[2 * i + 1]; }
+
+      // Appends the points as an encoded polyline with a number of decimal places.
+    void appendPolyline(std::string& out, int precision = 5) const;
+
+private:
+    // latitude and longitude of every point, back to back
+    std::vector<double> m_points;
+    // reused by simplify
+    std::vector<char> m_keep;
+    std::vector<size_t> m_ranges;
+
+    void addPoint(double latitude, double longitude);
+    double offsetMiles(size_t point, size_t first, size_t last) const;
+    void keepMarked();
+};
+
+#endif /* RouteGeometry_h */
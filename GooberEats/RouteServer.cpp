@@ -0,0 +1,1111 @@
+#include "provided.h"
+#include "RouteServer.h"
+#include "CompactPlan.h"
+#include "GraphRouter.h"
+#include "StreetGraph.h"
+#include "MapUpdates.h"
+#include "SearchStats.h"
+#include "Trace.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+using namespace std;
+
+// Longest request line the server accepts, in bytes
+const size_t MAX_REQUEST_BYTES = 1 << 20;
+// Most requests a single connection may have waiting for or being planned before the server stops reading from it
+const int MAX_IN_FLIGHT_PER_CONNECTION = 64;
+// Most requests all connections together may have in flight before the server stops reading from every connection
+const int MAX_IN_FLIGHT = 1024;
+// Most unsent response bytes a connection may have before the server stops reading its requests
+const size_t MAX_PENDING_OUTPUT_BYTES = 4 << 20;
+// Number of bytes read from a connection at a time
+const size_t READ_CHUNK_BYTES = 64 * 1024;
+// Number of pending connections the listening socket queues up
+const int LISTEN_BACKLOG = 128;
+
+// Write end of the pipe that wakes up the event loop; the signal handler writes to it to stop the server
+int wakeFd = -1;
+volatile sig_atomic_t stopRequested = 0;
+
+void handleStopSignal(int)
+{
+    stopRequested = 1;
+    if (wakeFd >= 0)
+    {
+        char byte = 0;
+        ssize_t ignored = write(wakeFd, &byte, 1);
+        (void)ignored;
+    }
+}
+
+//******************** JSON ****************************************************
+
+/*
+ A parsed JSON value. Numbers keep their original text, since coordinates are looked up by their text.
+ */
+struct JsonValue
+{
+    enum Type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+    Type type;
+    string text;                // text of a number, contents of a string, or "true"/"false"
+    vector<JsonValue> items;    // elements of an array or values of an object
+    vector<string> keys;        // keys of an object, in the same order as its values
+    
+    JsonValue() : type(NUL) {}
+    
+    /// Returns the value of a key of an object, or nullptr if the value isn't an object or has no such key.
+    const JsonValue* find(const string& key) const
+    {
+        if (type != OBJECT)
+            return nullptr;
+        for (size_t i = 0; i < keys.size(); ++i)
+            if (keys[i] == key)
+                return &items[i];
+        return nullptr;
+    }
+};
+
+/*
+ Recursive-descent parser for a single JSON value.
+ */
+class JsonParser
+{
+public:
+    JsonParser(const string& text) : m_text(text), m_pos(0) {}
+    
+    /// Parses the whole text as one value; returns false if it isn't valid JSON.
+    bool parse(JsonValue& value)
+    {
+        if (!parseValue(value, 0))
+            return false;
+        skipSpace();
+        return m_pos == m_text.size();
+    }
+private:
+    // Deepest nesting of arrays and objects the parser accepts
+    static const int MAX_DEPTH = 32;
+    
+    const string& m_text;
+    size_t m_pos;
+    
+    void skipSpace()
+    {
+        while (m_pos < m_text.size()  &&  (m_text[m_pos] == ' '  ||  m_text[m_pos] == '\t'  ||
+                                          m_text[m_pos] == '\r'  ||  m_text[m_pos] == '\n'))
+            ++m_pos;
+    }
+    
+    bool consume(char c)
+    {
+        skipSpace();
+        if (m_pos < m_text.size()  &&  m_text[m_pos] == c)
+        {
+            ++m_pos;
+            return true;
+        }
+        return false;
+    }
+    
+    bool parseValue(JsonValue& value, int depth)
+    {
+        skipSpace();
+        if (m_pos >= m_text.size()  ||  depth > MAX_DEPTH)
+            return false;
+        char c = m_text[m_pos];
+        if (c == '{')
+            return parseObject(value, depth);
+        if (c == '[')
+            return parseArray(value, depth);
+        if (c == '"')
+        {
+            value.type = JsonValue::STRING;
+            return parseString(value.text);
+        }
+        if (m_text.compare(m_pos, 4, "true") == 0  ||  m_text.compare(m_pos, 5, "false") == 0)
+        {
+            value.type = JsonValue::BOOLEAN;
+            value.text = c == 't' ? "true" : "false";
+            m_pos += value.text.size();
+            return true;
+        }
+        if (m_text.compare(m_pos, 4, "null") == 0)
+        {
+            value.type = JsonValue::NUL;
+            m_pos += 4;
+            return true;
+        }
+        
+        // anything else has to be a number: -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+        size_t start = m_pos;
+        if (m_text[m_pos] == '-')
+            ++m_pos;
+        if (m_pos < m_text.size()  &&  m_text[m_pos] == '0')
+            ++m_pos;
+        else if (skipDigits() == 0)
+            return false;
+        if (m_pos < m_text.size()  &&  m_text[m_pos] == '.')
+        {
+            ++m_pos;
+            if (skipDigits() == 0)
+                return false;
+        }
+        if (m_pos < m_text.size()  &&  (m_text[m_pos] == 'e'  ||  m_text[m_pos] == 'E'))
+        {
+            ++m_pos;
+            if (m_pos < m_text.size()  &&  (m_text[m_pos] == '+'  ||  m_text[m_pos] == '-'))
+                ++m_pos;
+            if (skipDigits() == 0)
+                return false;
+        }
+        value.type = JsonValue::NUMBER;
+        value.text = m_text.substr(start, m_pos - start);
+        return true;
+    }
+    
+    // Moves past a run of decimal digits and returns how many there were
+    size_t skipDigits()
+    {
+        size_t start = m_pos;
+        while (m_pos < m_text.size()  &&  m_text[m_pos] >= '0'  &&  m_text[m_pos] <= '9')
+            ++m_pos;
+        return m_pos - start;
+    }
+    
+    bool parseString(string& out)
+    {
+        // the opening quote has already been checked
+        ++m_pos;
+        out.clear();
+        while (m_pos < m_text.size())
+        {
+            char c = m_text[m_pos++];
+            if (c == '"')
+                return true;
+            if (c != '\\')
+            {
+                out += c;
+                continue;
+            }
+            if (m_pos >= m_text.size())
+                return false;
+            char escaped = m_text[m_pos++];
+            switch (escaped)
+            {
+              case 'n': out += '\n'; break;
+              case 't': out += '\t'; break;
+              case 'r': out += '\r'; break;
+              case 'b': out += '\b'; break;
+              case 'f': out += '\f'; break;
+              case 'u':
+              {
+                // only characters that fit in one byte are kept; anything else becomes '?'
+                if (m_pos + 4 > m_text.size())
+                    return false;
+                unsigned long code = strtoul(m_text.substr(m_pos, 4).c_str(), nullptr, 16);
+                out += code < 0x80 ? static_cast<char>(code) : '?';
+                m_pos += 4;
+                break;
+              }
+              default: out += escaped; break;
+            }
+        }
+        return false;
+    }
+    
+    bool parseArray(JsonValue& value, int depth)
+    {
+        ++m_pos;
+        value.type = JsonValue::ARRAY;
+        if (consume(']'))
+            return true;
+        do
+        {
+            value.items.push_back(JsonValue());
+            if (!parseValue(value.items.back(), depth + 1))
+                return false;
+        } while (consume(','));
+        return consume(']');
+    }
+    
+    bool parseObject(JsonValue& value, int depth)
+    {
+        ++m_pos;
+        value.type = JsonValue::OBJECT;
+        if (consume('}'))
+            return true;
+        do
+        {
+            skipSpace();
+            if (m_pos >= m_text.size()  ||  m_text[m_pos] != '"')
+                return false;
+            value.keys.push_back(string());
+            if (!parseString(value.keys.back())  ||  !consume(':'))
+                return false;
+            value.items.push_back(JsonValue());
+            if (!parseValue(value.items.back(), depth + 1))
+                return false;
+        } while (consume(','));
+        return consume('}');
+    }
+};
+
+/*
+ Appends a string to out as a JSON string literal.
+ */
+void appendJsonString(string& out, const string& s)
+{
+    out += '"';
+    for (auto it = s.begin(); it != s.end(); ++it)
+    {
+        unsigned char c = static_cast<unsigned char>(*it);
+        if (c == '"'  ||  c == '\\')
+        {
+            out += '\\';
+            out += *it;
+        }
+        else if (c < 0x20)
+        {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        }
+        else
+            out += *it;
+    }
+    out += '"';
+}
+
+/*
+ Reads a coordinate written as a two-element array of numbers or strings; returns false if it isn't one.
+ */
+bool parseCoordinate(const JsonValue* value, GeoCoord& coord)
+{
+    if (value == nullptr  ||  value->type != JsonValue::ARRAY  ||  value->items.size() != 2)
+        return false;
+    const JsonValue& lat = value->items[0];
+    const JsonValue& lon = value->items[1];
+    if ((lat.type != JsonValue::NUMBER  &&  lat.type != JsonValue::STRING)  ||
+        (lon.type != JsonValue::NUMBER  &&  lon.type != JsonValue::STRING))
+        return false;
+    try
+    {
+        coord = GeoCoord(lat.text, lon.text);
+    }
+    catch (const exception&)
+    {
+        // GeoCoord throws if the text isn't a number
+        return false;
+    }
+    return true;
+}
+
+/*
+ Reads the kind of change an update makes to a segment; returns false if it isn't one.
+ */
+bool parseChangeKind(const string& text, SegmentChangeKind& kind)
+{
+    const string NAMES[] = { "close", "reopen", "slow", "remove", "add" };
+    const SegmentChangeKind KINDS[] = { SegmentChangeKind::CLOSE, SegmentChangeKind::REOPEN, SegmentChangeKind::SLOW,
+                                        SegmentChangeKind::REMOVE, SegmentChangeKind::ADD };
+    for (size_t i = 0; i < sizeof(KINDS) / sizeof(KINDS[0]); ++i)
+    {
+        if (text == NAMES[i])
+        {
+            kind = KINDS[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+//******************** RouteServerImpl *****************************************
+
+/*
+ One version of the map the server answers requests with, and the router and planner made for it. The first version
+ is the map the server was given; an update that adds segments loads a new map, which its version owns. A request
+ holds on to the version it started with, so a version is only destroyed once every request using it has finished.
+ */
+struct ServedMap
+{
+    ServedMap(StreetMap* sm, size_t depotCacheBytes, unique_ptr<StreetMap> owned)
+        : ownedMap(move(owned)), map(sm), router(sm), planner(sm), GRAPH(getStreetGraph(sm))
+    {
+        planner.cacheDepotRoutes(depotCacheBytes);
+    }
+
+    unique_ptr<StreetMap> ownedMap;
+    StreetMap* map;
+    GraphRouter router;
+    CompactDeliveryPlanner planner;
+    const StreetGraph* GRAPH;
+};
+
+/*
+ A request line waiting for a worker, and the response a worker made for it. Requests are numbered per connection so
+ that their responses can be put back in order.
+ */
+struct ServerJob
+{
+    long connection;
+    long sequence;
+    string request;
+    string response;
+};
+
+/*
+ An update request waiting for the rebuild thread, which answers it like a worker would have.
+ */
+struct UpdateJob
+{
+    ServerJob job;
+    string id;
+    vector<SegmentChange> changes;
+    bool adds;
+};
+
+/*
+ The event loop's state for one client.
+ */
+struct ServerConnection
+{
+    int fd;
+    string input;                   // bytes read that don't make up a whole request yet
+    string output;                  // response bytes that haven't been written yet
+    long nextSequence;              // number the next request read from this connection gets
+    long nextToSend;                // number of the next response to write
+    map<long, string> finished;     // responses that are waiting for earlier ones to finish
+    int inFlight;                   // requests that have been read but whose responses haven't been queued to write
+    bool inputClosed;               // no more requests will be read; close once every response is written
+    bool broken;                    // the client can't be written to; close once no worker is using the connection
+};
+
+/*
+ Definition of RouteServerImpl.
+ One thread runs an event loop over every socket with poll(): it accepts connections, reads requests, hands each
+ request line to a fixed pool of worker threads, and writes the responses back in order. Workers plan with a shared
+ router and planner and wake the loop through a pipe when they finish a request. Updates that add segments rebuild the
+ whole map, so they're handed on to a thread of their own to keep the workers answering requests meanwhile.
+ */
+class RouteServerImpl
+{
+public:
+    RouteServerImpl(StreetMap* sm, size_t depotCacheBytes);
+    ~RouteServerImpl();
+    bool serve(string address, int numWorkers);
+private:
+    // the latest version of the map; updates are made one at a time, and once one has been handed to the rebuild
+    // thread every update after it is too until the thread has caught up, so they're made in the order they're taken
+    shared_ptr<const ServedMap> m_map;
+    size_t m_depotCacheBytes;
+    mutex m_updateMutex;
+    int m_numQueuedUpdates;
+
+    // requests waiting for a worker and responses waiting for the event loop
+    deque<ServerJob> m_pending;
+    deque<ServerJob> m_done;
+    deque<UpdateJob> m_updates;
+    mutex m_mutex;
+    condition_variable m_jobAvailable;
+    condition_variable m_updateAvailable;
+    bool m_stopping;
+    int m_wakePipe[2];
+
+    int listenOn(string address) const;
+    void work();
+    void rebuild();
+    void finishJob(const ServerJob& job);
+    string handleRequest(const ServerJob& job);
+    string handleRoute(const string& id, const JsonValue& request, const ServedMap& served) const;
+    string handlePlan(const string& id, const JsonValue& request, const ServedMap& served) const;
+    string handleStats(const string& id, const ServedMap& served) const;
+    string handleUpdate(const string& id, const JsonValue& request, const ServerJob& job);
+    string applyUpdate(const string& id, const vector<SegmentChange>& changes, bool adds);
+    string handleMetrics(const string& id) const;
+    string handleTrace(const string& id, const JsonValue& request) const;
+    void dispatchRequests(long id, ServerConnection& connection, int& totalInFlight);
+    void collectResponses(map<long, ServerConnection>& connections, int& totalInFlight);
+    void sendFinished(ServerConnection& connection) const;
+};
+
+/*
+ Constructor for RouteServerImpl; makes the first version of the map from the StreetMap argument, with a router and
+ a planner that has its depot cache.
+ */
+RouteServerImpl::RouteServerImpl(StreetMap* sm, size_t depotCacheBytes)
+    : m_map(make_shared<ServedMap>(sm, depotCacheBytes, nullptr)), m_depotCacheBytes(depotCacheBytes),
+      m_numQueuedUpdates(0), m_stopping(false)
+{
+    m_wakePipe[0] = m_wakePipe[1] = -1;
+}
+
+/*
+ Destructor for RouteServerImpl; serve() closes everything it opens, so this destructor does nothing.
+ */
+RouteServerImpl::~RouteServerImpl()
+{
+}
+
+/*
+ Opens a non-blocking listening socket: a TCP socket on localhost if the address is a port number, or a Unix domain
+ socket at the address's path otherwise. Returns the socket, or -1 if it couldn't be opened.
+ */
+int RouteServerImpl::listenOn(string address) const
+{
+    int fd;
+    if (!address.empty()  &&  address.find_first_not_of("0123456789") == string::npos)
+    {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0)
+            return -1;
+        int reuse = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(stoi(address)));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+        {
+            close(fd);
+            return -1;
+        }
+    }
+    else
+    {
+        sockaddr_un addr;
+        if (address.empty()  ||  address.size() >= sizeof(addr.sun_path))
+            return -1;
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+            return -1;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, address.c_str(), sizeof(addr.sun_path) - 1);
+        // a socket file left behind by an earlier server would make bind fail
+        unlink(address.c_str());
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+        {
+            close(fd);
+            return -1;
+        }
+    }
+    if (listen(fd, LISTEN_BACKLOG) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+/*
+ Runs the event loop until a stop signal arrives.
+ */
+bool RouteServerImpl::serve(string address, int numWorkers)
+{
+    int listenFd = listenOn(address);
+    if (listenFd < 0  ||  pipe(m_wakePipe) < 0)
+    {
+        if (listenFd >= 0)
+            close(listenFd);
+        return false;
+    }
+    fcntl(m_wakePipe[0], F_SETFL, fcntl(m_wakePipe[0], F_GETFL) | O_NONBLOCK);
+    fcntl(m_wakePipe[1], F_SETFL, fcntl(m_wakePipe[1], F_GETFL) | O_NONBLOCK);
+
+    // writing to a client that hung up should fail with an error rather than kill the server
+    signal(SIGPIPE, SIG_IGN);
+    stopRequested = 0;
+    wakeFd = m_wakePipe[1];
+    signal(SIGINT, handleStopSignal);
+    signal(SIGTERM, handleStopSignal);
+
+    m_stopping = false;
+    vector<thread> workers;
+    for (int i = 0; i < max(1, numWorkers); ++i)
+        workers.push_back(thread(&RouteServerImpl::work, this));
+    thread rebuilder(&RouteServerImpl::rebuild, this);
+
+    // connections are identified by a number that's never reused, unlike their file descriptors
+    map<long, ServerConnection> connections;
+    long nextConnection = 0;
+    int totalInFlight = 0;
+    vector<pollfd> fds;
+    vector<long> fdConnections;
+    char buffer[READ_CHUNK_BYTES];
+
+    while (!stopRequested)
+    {
+        // stop reading from connections that are over their limits, and from all of them if the workers are saturated
+        fds.clear();
+        fdConnections.clear();
+        fds.push_back(pollfd{ m_wakePipe[0], POLLIN, 0 });
+        fds.push_back(pollfd{ listenFd, POLLIN, 0 });
+        for (auto it = connections.begin(); it != connections.end(); ++it)
+        {
+            ServerConnection& c = it->second;
+            short events = 0;
+            if (!c.inputClosed  &&  totalInFlight < MAX_IN_FLIGHT  &&  c.inFlight < MAX_IN_FLIGHT_PER_CONNECTION  &&
+                c.output.size() < MAX_PENDING_OUTPUT_BYTES)
+                events |= POLLIN;
+            if (!c.output.empty()  &&  !c.broken)
+                events |= POLLOUT;
+            // poll() reports a hang-up whether it's asked for or not, so a connection that's only waiting for its
+            // responses to be planned is left out; otherwise every poll would return at once until they're done
+            fds.push_back(pollfd{ events == 0  &&  c.inputClosed ? -1 : c.fd, events, 0 });
+            fdConnections.push_back(it->first);
+        }
+        if (poll(fds.data(), fds.size(), -1) < 0  &&  errno != EINTR)
+            break;
+        
+        // take in every response the workers have finished
+        if (fds[0].revents & POLLIN)
+        {
+            while (read(m_wakePipe[0], buffer, sizeof(buffer)) > 0)
+                ;
+        }
+        collectResponses(connections, totalInFlight);
+        
+        // accept every client that's waiting
+        if (fds[1].revents & POLLIN)
+        {
+            int clientFd;
+            while ((clientFd = accept(listenFd, nullptr, nullptr)) >= 0)
+            {
+                fcntl(clientFd, F_SETFL, fcntl(clientFd, F_GETFL) | O_NONBLOCK);
+                ServerConnection& c = connections[nextConnection++];
+                c.fd = clientFd;
+                c.nextSequence = 0;
+                c.nextToSend = 0;
+                c.inFlight = 0;
+                c.inputClosed = false;
+                c.broken = false;
+            }
+        }
+        
+        // read requests from and write responses to every client that's ready
+        for (size_t i = 2; i < fds.size(); ++i)
+        {
+            ServerConnection& c = connections[fdConnections[i - 2]];
+            if (!c.inputClosed  &&  (fds[i].revents & (POLLIN | POLLHUP | POLLERR)))
+            {
+                ssize_t numRead = read(c.fd, buffer, sizeof(buffer));
+                if (numRead > 0)
+                    c.input.append(buffer, numRead);
+                else if (numRead == 0  ||  (errno != EAGAIN  &&  errno != EWOULDBLOCK  &&  errno != EINTR))
+                    c.inputClosed = true;
+            }
+            if ((fds[i].revents & POLLOUT)  &&  !c.output.empty())
+            {
+                ssize_t numWritten = write(c.fd, c.output.data(), c.output.size());
+                if (numWritten > 0)
+                    c.output.erase(0, numWritten);
+                else if (numWritten < 0  &&  errno != EAGAIN  &&  errno != EWOULDBLOCK  &&  errno != EINTR)
+                {
+                    // the client can't be written to any more, so there's no point in finishing its requests
+                    c.broken = true;
+                    c.inputClosed = true;
+                    c.input.clear();
+                    c.output.clear();
+                }
+            }
+        }
+        
+        // hand whole request lines to the workers, then close connections that are finished
+        for (auto it = connections.begin(); it != connections.end(); )
+        {
+            dispatchRequests(it->first, it->second, totalInFlight);
+            ServerConnection& c = it->second;
+            bool drained = c.inFlight == 0  &&  c.output.empty()  &&  c.input.find('\n') == string::npos;
+            if ((c.broken  &&  c.inFlight == 0)  ||  (c.inputClosed  &&  drained))
+            {
+                close(c.fd);
+                it = connections.erase(it);
+            }
+            else
+                ++it;
+        }
+    }
+
+    // stop the workers, then close every socket
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_jobAvailable.notify_all();
+    m_updateAvailable.notify_all();
+    for (auto it = workers.begin(); it != workers.end(); ++it)
+        it->join();
+    rebuilder.join();
+    for (auto it = connections.begin(); it != connections.end(); ++it)
+        close(it->second.fd);
+    close(listenFd);
+    if (address.find_first_not_of("0123456789") != string::npos)
+        unlink(address.c_str());
+    wakeFd = -1;
+    close(m_wakePipe[0]);
+    close(m_wakePipe[1]);
+    m_pending.clear();
+    m_done.clear();
+    m_updates.clear();
+    m_numQueuedUpdates = 0;
+    return true;
+}
+
+/*
+ Splits a connection's input into request lines and queues them for the workers, as long as the connection and the
+ server are under their limits. A line that's too long gets an error and ends the connection.
+ */
+void RouteServerImpl::dispatchRequests(long id, ServerConnection& connection, int& totalInFlight)
+{
+    size_t start = 0;
+    size_t newline;
+    bool queued = false;
+    while (!connection.broken  &&  connection.inFlight < MAX_IN_FLIGHT_PER_CONNECTION  &&  totalInFlight < MAX_IN_FLIGHT  &&
+           (newline = connection.input.find('\n', start)) != string::npos)
+    {
+        string request = connection.input.substr(start, newline - start);
+        start = newline + 1;
+        if (request.find_first_not_of(" \t\r") == string::npos)
+            continue;
+        ServerJob job;
+        job.connection = id;
+        job.sequence = connection.nextSequence++;
+        job.request.swap(request);
+        ++connection.inFlight;
+        ++totalInFlight;
+        lock_guard<mutex> lock(m_mutex);
+        m_pending.push_back(job);
+        queued = true;
+    }
+    connection.input.erase(0, start);
+    if (queued)
+        m_jobAvailable.notify_all();
+
+    if (connection.input.size() > MAX_REQUEST_BYTES  &&  connection.input.find('\n') == string::npos)
+    {
+        // the error goes after every response that's still owed, so it's ordered like any other response
+        connection.finished[connection.nextSequence++] = "{\"id\":null,\"status\":\"error\",\"error\":\"bad_request\"}\n";
+        connection.input.clear();
+        connection.inputClosed = true;
+        sendFinished(connection);
+    }
+}
+
+/*
+ Moves finished responses to their connections, writing out each connection's responses in the order its requests came.
+ */
+void RouteServerImpl::collectResponses(map<long, ServerConnection>& connections, int& totalInFlight)
+{
+    deque<ServerJob> done;
+    {
+        lock_guard<mutex> lock(m_mutex);
+        done.swap(m_done);
+    }
+    for (auto it = done.begin(); it != done.end(); ++it)
+    {
+        --totalInFlight;
+        auto found = connections.find(it->connection);
+        if (found == connections.end())
+            continue;
+        ServerConnection& c = found->second;
+        --c.inFlight;
+        if (!c.broken)
+        {
+            c.finished[it->sequence].swap(it->response);
+            sendFinished(c);
+        }
+    }
+}
+
+/*
+ Queues every finished response of a connection that no longer has to wait for an earlier one to be written.
+ */
+void RouteServerImpl::sendFinished(ServerConnection& connection) const
+{
+    for (auto next = connection.finished.find(connection.nextToSend);
+         next != connection.finished.end();
+         next = connection.finished.find(connection.nextToSend))
+    {
+        connection.output += next->second;
+        connection.finished.erase(next);
+        ++connection.nextToSend;
+    }
+}
+
+/*
+ Loop run by every worker: takes the oldest request and answers it, unless it's an update that was handed on to the
+ rebuild thread, which answers it instead.
+ */
+void RouteServerImpl::work()
+{
+    for (;;)
+    {
+        ServerJob job;
+        {
+            unique_lock<mutex> lock(m_mutex);
+            m_jobAvailable.wait(lock, [this]() { return m_stopping  ||  !m_pending.empty(); });
+            if (m_stopping)
+                return;
+            job = m_pending.front();
+            m_pending.pop_front();
+        }
+        job.response = handleRequest(job);
+        if (!job.response.empty())
+            finishJob(job);
+    }
+}
+
+/*
+ Loop run by the rebuild thread: makes the oldest update handed to it, then lets updates be made by the workers again
+ if no more are waiting.
+ */
+void RouteServerImpl::rebuild()
+{
+    for (;;)
+    {
+        UpdateJob update;
+        {
+            unique_lock<mutex> lock(m_mutex);
+            m_updateAvailable.wait(lock, [this]() { return m_stopping  ||  !m_updates.empty(); });
+            if (m_stopping)
+                return;
+            update = m_updates.front();
+            m_updates.pop_front();
+        }
+        update.job.response = applyUpdate(update.id, update.changes, update.adds);
+        {
+            lock_guard<mutex> lock(m_updateMutex);
+            --m_numQueuedUpdates;
+        }
+        finishJob(update.job);
+    }
+}
+
+/*
+ Queues a job's response for the event loop and wakes the loop up to send it.
+ */
+void RouteServerImpl::finishJob(const ServerJob& job)
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_done.push_back(job);
+    }
+    char byte = 0;
+    ssize_t ignored = write(m_wakePipe[1], &byte, 1);
+    (void)ignored;
+}
+
+/*
+ Answers one request line with one response line, using the version of the map that's latest when it starts. Returns
+ an empty string for an update that was handed on to the rebuild thread.
+ */
+string RouteServerImpl::handleRequest(const ServerJob& job)
+{
+    JsonValue value;
+    JsonParser parser(job.request);
+    if (!parser.parse(value)  ||  value.type != JsonValue::OBJECT)
+        return "{\"id\":null,\"status\":\"error\",\"error\":\"bad_request\"}\n";
+
+    // the id is echoed back as it was sent; anything but a number or a string is sent back as null
+    string id = "null";
+    const JsonValue* idValue = value.find("id");
+    if (idValue != nullptr  &&  idValue->type == JsonValue::NUMBER)
+        id = idValue->text;
+    else if (idValue != nullptr  &&  idValue->type == JsonValue::STRING)
+    {
+        id.clear();
+        appendJsonString(id, idValue->text);
+    }
+
+    shared_ptr<const ServedMap> served = atomic_load(&m_map);
+    const JsonValue* type = value.find("type");
+    if (type != nullptr  &&  type->type == JsonValue::STRING  &&  type->text == "route")
+        return handleRoute(id, value, *served);
+    if (type != nullptr  &&  type->type == JsonValue::STRING  &&  type->text == "plan")
+        return handlePlan(id, value, *served);
+    if (type != nullptr  &&  type->type == JsonValue::STRING  &&  type->text == "stats")
+        return handleStats(id, *served);
+    if (type != nullptr  &&  type->type == JsonValue::STRING  &&  type->text == "update")
+        return handleUpdate(id, value, job);
+    if (type != nullptr  &&  type->type == JsonValue::STRING  &&  type->text == "metrics")
+        return handleMetrics(id);
+    if (type != nullptr  &&  type->type == JsonValue::STRING  &&  type->text == "trace")
+        return handleTrace(id, value);
+    return "{\"id\":" + id + ",\"status\":\"error\",\"error\":\"bad_request\"}\n";
+}
+
+/*
+ Returns the start of a response; every response starts with its id and status.
+ */
+string responseStart(const string& id, DeliveryResult result)
+{
+    string response = "{\"id\":" + id;
+    switch (result)
+    {
+      case DELIVERY_SUCCESS:
+        response += ",\"status\":\"ok\"";
+        break;
+      case NO_ROUTE:
+        response += ",\"status\":\"error\",\"error\":\"no_route\"";
+        break;
+      case BAD_COORD:
+        response += ",\"status\":\"error\",\"error\":\"bad_coord\"";
+        break;
+    }
+    return response;
+}
+
+/*
+ Answers a route request with the route's length and the coordinates along it, and with the work the search did if the
+ request asks for its stats.
+ */
+string RouteServerImpl::handleRoute(const string& id, const JsonValue& request, const ServedMap& served) const
+{
+    GeoCoord from;
+    GeoCoord to;
+    if (!parseCoordinate(request.find("from"), from)  ||  !parseCoordinate(request.find("to"), to))
+        return "{\"id\":" + id + ",\"status\":\"error\",\"error\":\"bad_request\"}\n";
+    
+    vector<int> route;
+    double miles;
+    SearchStats stats;
+    DeliveryResult result = served.router.generatePointToPointRoute(from, to, route, miles, stats);
+    string response = responseStart(id, result);
+    const JsonValue* wantStats = request.find("stats");
+    if (wantStats != nullptr  &&  wantStats->type == JsonValue::BOOLEAN  &&  wantStats->text == "true")
+    {
+        ostringstream text;
+        text << ",\"stats\":{\"nodesSettled\":" << stats.nodesSettled << ",\"edgesRelaxed\":" << stats.edgesRelaxed
+             << ",\"heapPushes\":" << stats.heapPushes << ",\"heapPops\":" << stats.heapPops << ",\"duplicatePops\":"
+             << stats.duplicatePops << ",\"peakQueueSize\":" << stats.peakQueueSize << ",\"seconds\":"
+             << stats.seconds << "}";
+        response += text.str();
+    }
+    if (result == DELIVERY_SUCCESS)
+    {
+        char number[32];
+        snprintf(number, sizeof(number), "%.6f", miles);
+        response += ",\"miles\":";
+        response += number;
+        response += ",\"path\":[[" + from.latitudeText + "," + from.longitudeText + "]";
+        for (auto it = route.begin(); it != route.end(); ++it)
+        {
+            const GeoCoord& end = served.GRAPH->coord(served.GRAPH->edgeTo(*it));
+            response += ",[" + end.latitudeText + "," + end.longitudeText + "]";
+        }
+        response += "]";
+    }
+    return response + "}\n";
+}
+
+/*
+ Answers a plan request with the plan's length and a description of every command in it.
+ */
+string RouteServerImpl::handlePlan(const string& id, const JsonValue& request, const ServedMap& served) const
+{
+    GeoCoord depot;
+    const JsonValue* deliveryList = request.find("deliveries");
+    if (!parseCoordinate(request.find("depot"), depot)  ||  deliveryList == nullptr  ||
+        deliveryList->type != JsonValue::ARRAY)
+        return "{\"id\":" + id + ",\"status\":\"error\",\"error\":\"bad_request\"}\n";
+    vector<DeliveryRequest> deliveries;
+    for (auto it = deliveryList->items.begin(); it != deliveryList->items.end(); ++it)
+    {
+        const JsonValue* item = it->find("item");
+        GeoCoord location;
+        if (item == nullptr  ||  item->type != JsonValue::STRING  ||  !parseCoordinate(it->find("location"), location))
+            return "{\"id\":" + id + ",\"status\":\"error\",\"error\":\"bad_request\"}\n";
+        deliveries.push_back(DeliveryRequest(item->text, location));
+    }
+
+    CompactPlan plan;
+    double miles;
+    DeliveryResult result = served.planner.generateDeliveryPlan(depot, deliveries, plan, miles);
+    string response = responseStart(id, result);
+    if (result == DELIVERY_SUCCESS)
+    {
+        char number[32];
+        snprintf(number, sizeof(number), "%.6f", miles);
+        response += ",\"miles\":";
+        response += number;
+        response += ",\"commands\":[";
+        for (size_t i = 0; i < plan.size(); ++i)
+        {
+            if (i > 0)
+                response += ",";
+            appendJsonString(response, plan.description(i));
+        }
+        response += "]";
+    }
+    return response + "}\n";
+}
+
+/*
+ Answers a stats request with the counts from the planner's depot cache and the histograms of every search so far.
+ */
+string RouteServerImpl::handleStats(const string& id, const ServedMap& served) const
+{
+    DepotCacheStats cache = served.planner.depotCacheStats();
+    ostringstream response;
+    response << "{\"id\":" << id << ",\"status\":\"ok\",\"depotCache\":{\"depots\":" << cache.depots
+             << ",\"bytes\":" << cache.bytes << ",\"maxBytes\":" << cache.maxBytes << ",\"hits\":" << cache.hits
+             << ",\"misses\":" << cache.misses << ",\"builds\":" << cache.builds << ",\"evictions\":"
+             << cache.evictions << ",\"invalidations\":" << cache.invalidations << "},\"search\":"
+             << searchStatsJson() << "}\n";
+    return response.str();
+}
+
+/*
+ Reads an update request's changes and makes them, unless any of them adds a segment or an earlier update is still
+ waiting for the rebuild thread, in which case it's handed to that thread and an empty string is returned.
+ */
+string RouteServerImpl::handleUpdate(const string& id, const JsonValue& request, const ServerJob& job)
+{
+    const JsonValue* changeList = request.find("changes");
+    if (changeList == nullptr  ||  changeList->type != JsonValue::ARRAY)
+        return "{\"id\":" + id + ",\"status\":\"error\",\"error\":\"bad_request\"}\n";
+    vector<SegmentChange> changes;
+    bool adds = false;
+    for (auto it = changeList->items.begin(); it != changeList->items.end(); ++it)
+    {
+        SegmentChange change;
+        const JsonValue* kind = it->find("change");
+        const JsonValue* street = it->find("street");
+        const JsonValue* oneWay = it->find("oneWay");
+        const JsonValue* factor = it->find("factor");
+        if (kind == nullptr  ||  kind->type != JsonValue::STRING  ||  !parseChangeKind(kind->text, change.kind)  ||
+            !parseCoordinate(it->find("from"), change.start)  ||  !parseCoordinate(it->find("to"), change.end)  ||
+            (street != nullptr  &&  street->type != JsonValue::STRING)  ||
+            (oneWay != nullptr  &&  oneWay->type != JsonValue::BOOLEAN)  ||
+            (factor != nullptr  &&  factor->type != JsonValue::NUMBER))
+            return "{\"id\":" + id + ",\"status\":\"error\",\"error\":\"bad_request\"}\n";
+        if (street != nullptr)
+            change.name = street->text;
+        if (oneWay != nullptr)
+            change.bothWays = oneWay->text != "true";
+        if (factor != nullptr)
+            change.factor = strtod(factor->text.c_str(), nullptr);
+        adds = adds  ||  change.kind == SegmentChangeKind::ADD;
+        changes.push_back(change);
+    }
+
+    lock_guard<mutex> lock(m_updateMutex);
+    if (adds  ||  m_numQueuedUpdates > 0)
+    {
+        ++m_numQueuedUpdates;
+        {
+            lock_guard<mutex> queueLock(m_mutex);
+            m_updates.push_back(UpdateJob{ job, id, changes, adds });
+        }
+        m_updateAvailable.notify_one();
+        return "";
+    }
+    return applyUpdate(id, changes, adds);
+}
+
+/*
+ Makes an update and answers it with the version of the map's costs it made, and whether the map had to be loaded
+ again. Closures, reopenings, slowdowns and removals are made to the latest map in place; if any change adds a segment,
+ a new map is loaded from the latest one with every change made, and requests that start after that use it. Only one
+ thread makes updates at a time: a worker holding m_updateMutex, or the rebuild thread while updates are queued for it.
+ */
+string RouteServerImpl::applyUpdate(const string& id, const vector<SegmentChange>& changes, bool adds)
+{
+    shared_ptr<const ServedMap> served = atomic_load(&m_map);
+    string error;
+    bool updated;
+    if (!adds)
+        updated = updateStreetMap(served->map, changes, error);
+    else
+    {
+        unique_ptr<StreetMap> sm(new StreetMap);
+        updated = loadUpdatedStreetMap(sm.get(), served->map, changes, error);
+        if (updated)
+        {
+            StreetMap* map = sm.get();
+            served = make_shared<ServedMap>(map, m_depotCacheBytes, move(sm));
+            atomic_store(&m_map, served);
+        }
+    }
+    if (!updated)
+    {
+        string response = "{\"id\":" + id + ",\"status\":\"error\",\"error\":\"bad_update\",\"message\":";
+        appendJsonString(response, error);
+        return response + "}\n";
+    }
+    ostringstream response;
+    response << "{\"id\":" << id << ",\"status\":\"ok\",\"version\":" << served->GRAPH->costs()->version
+             << ",\"rebuilt\":" << (adds ? "true" : "false") << "}\n";
+    return response.str();
+}
+
+/*
+ Answers a metrics request with the search histograms in Prometheus's text format, as one JSON string.
+ */
+string RouteServerImpl::handleMetrics(const string& id) const
+{
+    string response = "{\"id\":" + id + ",\"status\":\"ok\",\"metrics\":";
+    appendJsonString(response, searchStatsPrometheus());
+    return response + "}\n";
+}
+
+/*
+ Answers a trace request with the events traced so far, after starting or stopping tracing if the request has
+ "tracing": true or false, and forgetting the old events if it has "clear": true.
+ */
+string RouteServerImpl::handleTrace(const string& id, const JsonValue& request) const
+{
+    const JsonValue* tracing = request.find("tracing");
+    const JsonValue* clear = request.find("clear");
+    if (tracing != nullptr  &&  tracing->type == JsonValue::BOOLEAN)
+    {
+        if (tracing->text == "true")
+            startTracing();
+        else
+            stopTracing();
+    }
+    string response = "{\"id\":" + id + ",\"status\":\"ok\",\"trace\":" + traceJson() + "}\n";
+    if (clear != nullptr  &&  clear->type == JsonValue::BOOLEAN  &&  clear->text == "true")
+        clearTrace();
+    return response;
+}
+
+//******************** RouteServer functions **********************************
+
+// These functions simply delegate to RouteServerImpl's functions.
+
+RouteServer::RouteServer(StreetMap* sm, size_t depotCacheBytes)
+{
+    m_impl = new RouteServerImpl(sm, depotCacheBytes);
+}
+
+RouteServer::~RouteServer()
+{
+    delete m_impl;
+}
+
+bool RouteServer::serve(string address, int numWorkers)
+{
+    return m_impl->serve(address, numWorkers);
+}
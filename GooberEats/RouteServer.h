@@ -0,0 +1,69 @@
+#ifndef RouteServer_h
+#define RouteServer_h
+
+#include "provided.h"
+#include "DepotRouteCache.h"
+#include <string>
+
+// RouteServer.h
+
+// A long-running server that keeps a StreetMap loaded and answers requests over a local socket. Every request and
+// every response is one line of JSON. Requests look like
+//
+//     {"id": 1, "type": "route", "from": [34.0625329, -118.4470263], "to": [34.0685657, -118.4489289]}
+//     {"id": 2, "type": "plan", "depot": [34.0625329, -118.4470263],
+//      "deliveries": [{"item": "Chicken tenders", "location": [34.0712323, -118.4505969]}, ...]}
+//     {"id": 3, "type": "stats"}
+//     {"id": 4, "type": "metrics"}
+//     {"id": 5, "type": "trace", "tracing": true}
+//     {"id": 6, "type": "update", "changes": [{"change": "close", "from": [34.0625329, -118.4470263],
+//      "to": [34.0632405, -118.4470467], "street": "Broxton Avenue"}, ...]}
+//
+// Coordinates may be numbers or strings; either way their text has to match the map data exactly. The id is echoed
+// back unchanged. Successful responses have "status": "ok" along with "miles" and either the route's "path" (a list
+// of coordinates) or the plan's "commands" (a list of descriptions); failed ones have "status": "error" and an
+// "error" of "bad_request", "bad_coord" or "no_route". A route request with "stats": true also gets back the work its
+// search did in "stats" (see SearchStats.h). A stats request is answered with the counts from the planner's depot cache
+// (see DepotRouteCache.h) in "depotCache" and the histograms of every search so far in "search"; a metrics request
+// gets the same histograms in Prometheus's text format, as the string "metrics". A trace request gets the events
+// traced so far as a Chrome trace in "trace" (see Trace.h); "tracing": true or false starts or stops tracing first,
+// and "clear": true forgets the events once they've been sent.
+//
+// An update request changes the map while it's being served (see MapUpdates.h). Each change is "close", "reopen",
+// "slow", "remove" or "add", applies to the segment between "from" and "to" on "street" (any street if it's left out,
+// though "add" needs one), and to the segment back the other way too unless "oneWay" is true; "slow" has a "factor" of
+// at least 1. The response has the "version" of the map's costs the update made and "rebuilt": true if it added
+// segments and so loaded a new map, which requests that start after it use while those under way finish with the old
+// one. An update that can't be made changes nothing and gets the error "bad_update" with a "message" saying why.
+//
+// Adding segments costs a full rebuild of the map (about 40 ms for mapdata.txt), so those updates are made on a thread
+// of their own and the workers go on answering other requests meanwhile. Updates that come after one wait for it and
+// are made on that thread too, in order; closures and the like otherwise take well under a millisecond.
+//
+// A client may send many requests without waiting for their responses; responses on a connection always come back in
+// the order the requests were sent. The server stops reading from a connection while it has too many requests in
+// flight or too much unsent output, and from every connection while its workers are saturated, so clients that send
+// faster than it can plan are slowed down instead of piling up memory.
+
+class RouteServerImpl;
+
+class RouteServer
+{
+public:
+      // Plans are made with a cache of routes out of and into depots that takes up at most depotCacheBytes.
+    RouteServer(StreetMap* sm, size_t depotCacheBytes = DEFAULT_DEPOT_CACHE_BYTES);
+    ~RouteServer();
+
+      // Listens on address, which is either a TCP port on localhost (e.g. "7878") or the path of a Unix domain socket,
+      // and answers requests on numWorkers threads until the process receives SIGINT or SIGTERM. Returns false if the
+      // address couldn't be listened on.
+    bool serve(std::string address, int numWorkers);
+
+      // We prevent a RouteServer object from being copied or assigned.
+    RouteServer(const RouteServer&) = delete;
+    RouteServer& operator=(const RouteServer&) = delete;
+private:
+    RouteServerImpl* m_impl;
+};
+
+#endif /* RouteServer_h */
@@ -0,0 +1,236 @@
+#include "SearchStats.h"
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <algorithm>
+#include <cstdio>
+using namespace std;
+
+// Upper bounds of the histogram buckets: wall time in nanoseconds from 50 microseconds to a second, and counts in
+// powers of four from 16 to about a million; values past the last bound go in an extra bucket
+const long long SECONDS_BOUNDS[] = { 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000, 25000000,
+                                     50000000, 100000000, 250000000, 500000000, 1000000000 };
+const long long COUNT_BOUNDS[] = { 16, 64, 256, 1024, 4096, 16384, 65536, 262144, 1048576 };
+const int NUM_SECONDS_BOUNDS = sizeof(SECONDS_BOUNDS) / sizeof(SECONDS_BOUNDS[0]);
+const int NUM_COUNT_BOUNDS = sizeof(COUNT_BOUNDS) / sizeof(COUNT_BOUNDS[0]);
+const int MAX_BOUNDS = NUM_SECONDS_BOUNDS;
+
+// Names used for each kind of search in exported labels
+const char* const SEARCH_KIND_NAMES[NUM_SEARCH_KINDS] = { "graph", "turn_aware" };
+
+/*
+ What's measured about every search, with how its histogram is exported. Seconds are kept in nanoseconds so every
+ histogram can be made of integers.
+ */
+struct SearchMetric
+{
+    const char* name;
+    const char* help;
+    const long long* bounds;
+    int numBounds;
+    double scale;           // multiplies a kept value to give the exported one
+};
+
+const SearchMetric METRICS[] = {
+    { "seconds", "Wall time of a search", SECONDS_BOUNDS, NUM_SECONDS_BOUNDS, 1e-9 },
+    { "nodes_settled", "Nodes (or edges, for turn-aware searches) settled by a search", COUNT_BOUNDS, NUM_COUNT_BOUNDS,
+      1 },
+    { "edges_relaxed", "Neighbours whose cost a search lowered", COUNT_BOUNDS, NUM_COUNT_BOUNDS, 1 },
+    { "heap_pushes", "Entries a search pushed onto its queue", COUNT_BOUNDS, NUM_COUNT_BOUNDS, 1 },
+    { "heap_pops", "Entries a search took off its queue", COUNT_BOUNDS, NUM_COUNT_BOUNDS, 1 },
+    { "duplicate_pops", "Entries a search took off its queue for something already settled", COUNT_BOUNDS,
+      NUM_COUNT_BOUNDS, 1 },
+    { "peak_queue_size", "Most entries a search's queue held at once", COUNT_BOUNDS, NUM_COUNT_BOUNDS, 1 },
+};
+const int NUM_METRICS = sizeof(METRICS) / sizeof(METRICS[0]);
+
+/*
+ One thread's histograms, for every kind of search and every metric. Only the owning thread writes them, so a value is
+ bumped with a plain load and store; they're atomic so an export on another thread can read them at any time.
+ */
+struct SearchHistograms
+{
+    atomic<long long> buckets[NUM_SEARCH_KINDS][NUM_METRICS][MAX_BOUNDS + 1];
+    atomic<long long> sums[NUM_SEARCH_KINDS][NUM_METRICS];
+    atomic<long long> counts[NUM_SEARCH_KINDS];
+    
+    SearchHistograms();
+    ~SearchHistograms();
+    void add(atomic<long long>& value, long long amount)
+    {
+        value.store(value.load(memory_order_relaxed) + amount, memory_order_relaxed);
+    }
+    void addTo(vector<long long>& totals) const;
+};
+
+// Every live thread's histograms, and the totals of threads that have finished
+mutex registryMutex;
+vector<const SearchHistograms*> liveHistograms;
+vector<long long> retiredTotals;
+
+// Position of each value in a flattened copy of a set of histograms
+const int TOTALS_PER_KIND = NUM_METRICS * (MAX_BOUNDS + 2) + 1;
+
+int bucketIndex(int kind, int metric, int bucket)
+{
+    return kind * TOTALS_PER_KIND + metric * (MAX_BOUNDS + 2) + bucket;
+}
+
+int sumIndex(int kind, int metric)
+{
+    return bucketIndex(kind, metric, MAX_BOUNDS + 1);
+}
+
+int countIndex(int kind)
+{
+    return kind * TOTALS_PER_KIND + NUM_METRICS * (MAX_BOUNDS + 2);
+}
+
+SearchHistograms::SearchHistograms()
+{
+    for (int kind = 0; kind < NUM_SEARCH_KINDS; ++kind)
+    {
+        counts[kind] = 0;
+        for (int metric = 0; metric < NUM_METRICS; ++metric)
+        {
+            sums[kind][metric] = 0;
+            for (int bucket = 0; bucket <= MAX_BOUNDS; ++bucket)
+                buckets[kind][metric][bucket] = 0;
+        }
+    }
+    lock_guard<mutex> lock(registryMutex);
+    liveHistograms.push_back(this);
+}
+
+/*
+ A finishing thread's counts are folded into the retired totals, so they aren't lost from later exports.
+ */
+SearchHistograms::~SearchHistograms()
+{
+    lock_guard<mutex> lock(registryMutex);
+    addTo(retiredTotals);
+    liveHistograms.erase(find(liveHistograms.begin(), liveHistograms.end(), this));
+}
+
+void SearchHistograms::addTo(vector<long long>& totals) const
+{
+    totals.resize(NUM_SEARCH_KINDS * TOTALS_PER_KIND, 0);
+    for (int kind = 0; kind < NUM_SEARCH_KINDS; ++kind)
+    {
+        totals[countIndex(kind)] += counts[kind].load(memory_order_relaxed);
+        for (int metric = 0; metric < NUM_METRICS; ++metric)
+        {
+            totals[sumIndex(kind, metric)] += sums[kind][metric].load(memory_order_relaxed);
+            for (int bucket = 0; bucket <= MAX_BOUNDS; ++bucket)
+                totals[bucketIndex(kind, metric, bucket)] += buckets[kind][metric][bucket].load(memory_order_relaxed);
+        }
+    }
+}
+
+void recordSearch(SearchKind kind, const SearchStats& stats)
+{
+    if (!SEARCH_STATS)
+        return;
+    static thread_local SearchHistograms histograms;
+    const long long VALUES[NUM_METRICS] = { static_cast<long long>(stats.seconds * 1e9), stats.nodesSettled,
+                                            stats.edgesRelaxed, stats.heapPushes, stats.heapPops, stats.duplicatePops,
+                                            stats.peakQueueSize };
+    int k = static_cast<int>(kind);
+    histograms.add(histograms.counts[k], 1);
+    for (int metric = 0; metric < NUM_METRICS; ++metric)
+    {
+        const SearchMetric& m = METRICS[metric];
+        int bucket = static_cast<int>(lower_bound(m.bounds, m.bounds + m.numBounds, VALUES[metric]) - m.bounds);
+        histograms.add(histograms.buckets[k][metric][bucket], 1);
+        histograms.add(histograms.sums[k][metric], VALUES[metric]);
+    }
+}
+
+/*
+ Adds up the histograms of every thread that has recorded a search.
+ */
+vector<long long> totalSearchStats()
+{
+    lock_guard<mutex> lock(registryMutex);
+    vector<long long> totals = retiredTotals;
+    totals.resize(NUM_SEARCH_KINDS * TOTALS_PER_KIND, 0);
+    for (auto it = liveHistograms.begin(); it != liveHistograms.end(); ++it)
+        (*it)->addTo(totals);
+    return totals;
+}
+
+/*
+ Formats an exported value; whole numbers are written without a fraction.
+ */
+string formatValue(double value)
+{
+    char text[32];
+    snprintf(text, sizeof(text), value == static_cast<long long>(value) ? "%.0f" : "%.9g", value);
+    return text;
+}
+
+/*
+ Writes every metric as a Prometheus histogram named goobereats_search_<metric>, with the kind of search as its
+ "router" label. Bucket counts are cumulative, as Prometheus expects.
+ */
+string searchStatsPrometheus()
+{
+    vector<long long> totals = totalSearchStats();
+    string out;
+    for (int metric = 0; metric < NUM_METRICS; ++metric)
+    {
+        const SearchMetric& m = METRICS[metric];
+        string name = string("goobereats_search_") + m.name;
+        out += "# HELP " + name + " " + m.help + "\n";
+        out += "# TYPE " + name + " histogram\n";
+        for (int kind = 0; kind < NUM_SEARCH_KINDS; ++kind)
+        {
+            string label = string("router=\"") + SEARCH_KIND_NAMES[kind] + "\"";
+            long long cumulative = 0;
+            for (int bucket = 0; bucket <= m.numBounds; ++bucket)
+            {
+                cumulative += totals[bucketIndex(kind, metric, bucket)];
+                string bound = bucket < m.numBounds ? formatValue(m.bounds[bucket] * m.scale) : "+Inf";
+                out += name + "_bucket{" + label + ",le=\"" + bound + "\"} " + to_string(cumulative) + "\n";
+            }
+            out += name + "_sum{" + label + "} " + formatValue(totals[sumIndex(kind, metric)] * m.scale) + "\n";
+            out += name + "_count{" + label + "} " + to_string(totals[countIndex(kind)]) + "\n";
+        }
+    }
+    return out;
+}
+
+/*
+ Writes the same histograms as a JSON object with one member per kind of search, e.g.
+     {"graph": {"searches": 12, "seconds": {"sum": 0.01, "le": [...], "counts": [...]}, ...}, "turn_aware": {...}}
+ where counts are cumulative like Prometheus's and the last bound is null (no limit).
+ */
+string searchStatsJson()
+{
+    vector<long long> totals = totalSearchStats();
+    string out = "{";
+    for (int kind = 0; kind < NUM_SEARCH_KINDS; ++kind)
+    {
+        out += string(kind == 0 ? "" : ",") + "\"" + SEARCH_KIND_NAMES[kind] + "\":{\"searches\":" +
+               to_string(totals[countIndex(kind)]);
+        for (int metric = 0; metric < NUM_METRICS; ++metric)
+        {
+            const SearchMetric& m = METRICS[metric];
+            string bounds;
+            string counts;
+            long long cumulative = 0;
+            for (int bucket = 0; bucket <= m.numBounds; ++bucket)
+            {
+                cumulative += totals[bucketIndex(kind, metric, bucket)];
+                bounds += string(bucket == 0 ? "" : ",");
+                bounds += bucket < m.numBounds ? formatValue(m.bounds[bucket] * m.scale) : "null";
+                counts += string(bucket == 0 ? "" : ",") + to_string(cumulative);
+            }
+            out += string(",\"") + m.name + "\":{\"sum\":" + formatValue(totals[sumIndex(kind, metric)] * m.scale) +
+                   ",\"le\":[" + bounds + "],\"counts\":[" + counts + "]}";
+        }
+        out += "}";
+    }
+    return out + "}";
+}
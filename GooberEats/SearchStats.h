@@ -0,0 +1,48 @@
+#ifndef SearchStats_h
+#define SearchStats_h
+
+#include <string>
+
+// SearchStats.h
+
+// Instrumentation for the routers' searches. Every search can hand back a SearchStats describing the work it did, and
+// every search is also added to histograms kept separately by each thread (so recording one costs a few uncontended
+// writes), which are summed when they're exported as Prometheus text or JSON.
+//
+// Building with GOOBEREATS_SEARCH_STATS defined as 0 removes the instrumentation: the counting in the searches is
+// compiled away, stats come back as zeros, and nothing is recorded.
+
+#ifndef GOOBEREATS_SEARCH_STATS
+#define GOOBEREATS_SEARCH_STATS 1
+#endif
+
+  // Whether searches count their work; the counting checks this, so the compiler drops it when it's false.
+const bool SEARCH_STATS = GOOBEREATS_SEARCH_STATS != 0;
+
+struct SearchStats
+{
+    SearchStats()
+     : nodesSettled(0), edgesRelaxed(0), heapPushes(0), heapPops(0), duplicatePops(0), peakQueueSize(0), seconds(0)
+    {}
+
+    long long nodesSettled;     // nodes (or, for edge-based searches, edges) taken off the queue for the first time
+    long long edgesRelaxed;     // neighbours whose cost was lowered
+    long long heapPushes;
+    long long heapPops;
+    long long duplicatePops;    // entries taken off the queue for something already settled, and skipped
+    long long peakQueueSize;
+    double seconds;             // wall time of the search
+};
+
+  // The searches whose stats are kept apart.
+enum class SearchKind { GRAPH, TURN_AWARE };
+const int NUM_SEARCH_KINDS = 2;
+
+  // Adds a search to the calling thread's histograms; does nothing if stats are compiled out.
+void recordSearch(SearchKind kind, const SearchStats& stats);
+
+  // Returns every thread's histograms summed, as Prometheus text exposition format or as a JSON object.
+std::string searchStatsPrometheus();
+std::string searchStatsJson();
+
+#endif /* SearchStats_h */
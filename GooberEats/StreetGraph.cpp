@@ -0,0 +1,599 @@
+#include "provided.h"
+#include "StreetGraph.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <queue>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+using namespace std;
+
+// Largest change in bearing that each kind of turn covers, from straight to sharp (20, 60, 120 and 170 degrees);
+// anything beyond the last one is a U-turn
+const int STRAIGHT_UNITS = 20 * BEARING_UNITS / 360;
+const int SLIGHT_UNITS = 60 * BEARING_UNITS / 360;
+const int TURN_UNITS = 120 * BEARING_UNITS / 360;
+const int SHARP_UNITS = 170 * BEARING_UNITS / 360;
+
+// Latitudes and longitudes are placed on a grid this many cells across (2^16) to find their place along a curve
+const int CURVE_CELLS = 65536;
+// Most components of each kind that writeComponents lists
+const int COMPONENTS_LISTED = 10;
+
+unsigned short quantizeBearing(double degrees)
+{
+    long units = lround(degrees * BEARING_UNITS / 360);
+    return static_cast<unsigned short>(units & (BEARING_UNITS - 1));
+}
+
+TurnKind classifyTurn(unsigned short fromBearing, unsigned short toBearing)
+{
+    // bearings that grow by less than half a circle are to the left, just like the planner's turn commands
+    int angle = static_cast<unsigned short>(toBearing - fromBearing);
+    bool left = angle < BEARING_UNITS / 2;
+    int change = left ? angle : BEARING_UNITS - angle;
+    if (change <= STRAIGHT_UNITS)
+        return TurnKind::STRAIGHT;
+    if (change <= SLIGHT_UNITS)
+        return left ? TurnKind::SLIGHT_LEFT : TurnKind::SLIGHT_RIGHT;
+    if (change <= TURN_UNITS)
+        return left ? TurnKind::LEFT : TurnKind::RIGHT;
+    if (change <= SHARP_UNITS)
+        return left ? TurnKind::SHARP_LEFT : TurnKind::SHARP_RIGHT;
+    return TurnKind::U_TURN;
+}
+
+/*
+ Returns the distance along a Hilbert curve through a CURVE_CELLS by CURVE_CELLS grid of the cell in column x and row
+ y. Each step rotates the quadrant the cell is in so that consecutive quadrants meet, which keeps cells that are close
+ on the curve close on the grid.
+ */
+unsigned long long hilbertIndex(unsigned int x, unsigned int y)
+{
+    unsigned long long index = 0;
+    for (unsigned int half = CURVE_CELLS / 2; half > 0; half /= 2)
+    {
+        unsigned int right = (x & half) != 0 ? 1 : 0;
+        unsigned int up = (y & half) != 0 ? 1 : 0;
+        index += static_cast<unsigned long long>(half) * half * ((3 * right) ^ up);
+        if (up == 0)
+        {
+            if (right == 1)
+            {
+                x = CURVE_CELLS - 1 - x;
+                y = CURVE_CELLS - 1 - y;
+            }
+            swap(x, y);
+        }
+    }
+    return index;
+}
+
+/*
+ Returns the distance along a Morton (Z-order) curve of the cell in column x and row y, which is just their bits
+ interleaved.
+ */
+unsigned long long mortonIndex(unsigned int x, unsigned int y)
+{
+    unsigned long long index = 0;
+    for (int bit = 0; bit < 16; ++bit)
+    {
+        index |= static_cast<unsigned long long>((x >> bit) & 1) << (2 * bit);
+        index |= static_cast<unsigned long long>((y >> bit) & 1) << (2 * bit + 1);
+    }
+    return index;
+}
+
+StreetGraph::StreetGraph()
+{
+    m_firstEdge.push_back(0);
+    m_firstChain.push_back(0);
+    m_numComponents = 0;
+    m_numStrongComponents = 0;
+}
+
+/*
+ Returns a coordinate's node, adding it to the node table if it's new; nodes are numbered in the order they first
+ appear.
+ */
+int StreetGraph::addNode(const GeoCoord& gc)
+{
+    const int* found = m_nodeIds.find(gc);
+    if (found != nullptr)
+        return *found;
+    int node = numNodes();
+    m_nodeIds.associate(gc, node);
+    m_coords.push_back(gc);
+    return node;
+}
+
+/*
+ Keeps only the ids of the segment's ends and name until finish(), after the edges already in the graph.
+ */
+void StreetGraph::addSegment(const GeoCoord& start, const GeoCoord& end, const string& name)
+{
+    m_edgeFrom.push_back(addNode(start));
+    m_edgeTo.push_back(addNode(end));
+    auto named = m_nameIds.emplace(name, static_cast<int>(m_names.size()));
+    if (named.second)
+        m_names.push_back(name);
+    m_edgeName.push_back(named.first->second);
+}
+
+/*
+ Returns the new id of every node (indexed by its current id) for numbering them in the given order. Curve orders place
+ every node on a grid stretched over the graph's bounding box; nodes in the same cell keep their current order. A
+ breadth-first order visits the nodes reachable from node 0, then those reachable from the next node not yet visited,
+ and so on, following the segments in the order they were added.
+ */
+vector<int> StreetGraph::nodeOrder(NodeOrder order, const vector<int>& from, const vector<int>& to) const
+{
+    const int NUM_NODES = numNodes();
+    vector<int> newId(NUM_NODES);
+    if (order == NodeOrder::LOADED)
+    {
+        for (int node = 0; node < NUM_NODES; ++node)
+            newId[node] = node;
+        return newId;
+    }
+    
+    // the nodes in their new order
+    vector<int> nodes;
+    nodes.reserve(NUM_NODES);
+    if (order == NodeOrder::BFS)
+    {
+        // a temporary list of every node's neighbours, in runs like the edges'
+        vector<int> firstNeighbour(NUM_NODES + 1, 0);
+        for (size_t i = 0; i < from.size(); ++i)
+            ++firstNeighbour[from[i] + 1];
+        for (int node = 0; node < NUM_NODES; ++node)
+            firstNeighbour[node + 1] += firstNeighbour[node];
+        vector<int> neighbours(from.size());
+        vector<int> nextSlot(firstNeighbour.begin(), firstNeighbour.end() - 1);
+        for (size_t i = 0; i < from.size(); ++i)
+            neighbours[nextSlot[from[i]]++] = to[i];
+        
+        vector<bool> visited(NUM_NODES, false);
+        queue<int> frontier;
+        for (int root = 0; root < NUM_NODES; ++root)
+        {
+            if (visited[root])
+                continue;
+            visited[root] = true;
+            frontier.push(root);
+            while (!frontier.empty())
+            {
+                int node = frontier.front();
+                frontier.pop();
+                nodes.push_back(node);
+                for (int i = firstNeighbour[node]; i != firstNeighbour[node + 1]; ++i)
+                {
+                    if (!visited[neighbours[i]])
+                    {
+                        visited[neighbours[i]] = true;
+                        frontier.push(neighbours[i]);
+                    }
+                }
+            }
+        }
+    }
+    else
+    {
+        double minLatitude = 0;
+        double maxLatitude = 0;
+        double minLongitude = 0;
+        double maxLongitude = 0;
+        for (int node = 0; node < NUM_NODES; ++node)
+        {
+            const GeoCoord& gc = m_coords[node];
+            minLatitude = node == 0 ? gc.latitude : min(minLatitude, gc.latitude);
+            maxLatitude = node == 0 ? gc.latitude : max(maxLatitude, gc.latitude);
+            minLongitude = node == 0 ? gc.longitude : min(minLongitude, gc.longitude);
+            maxLongitude = node == 0 ? gc.longitude : max(maxLongitude, gc.longitude);
+        }
+        // a map that's a single point or a straight north-south or east-west line is all in one column or row
+        double latitudeScale = maxLatitude > minLatitude ? (CURVE_CELLS - 1) / (maxLatitude - minLatitude) : 0;
+        double longitudeScale = maxLongitude > minLongitude ? (CURVE_CELLS - 1) / (maxLongitude - minLongitude) : 0;
+        vector<pair<unsigned long long, int>> keys(NUM_NODES);
+        for (int node = 0; node < NUM_NODES; ++node)
+        {
+            unsigned int x = static_cast<unsigned int>((m_coords[node].longitude - minLongitude) * longitudeScale);
+            unsigned int y = static_cast<unsigned int>((m_coords[node].latitude - minLatitude) * latitudeScale);
+            keys[node] = make_pair(order == NodeOrder::HILBERT ? hilbertIndex(x, y) : mortonIndex(x, y), node);
+        }
+        sort(keys.begin(), keys.end());
+        for (auto it = keys.begin(); it != keys.end(); ++it)
+            nodes.push_back(it->second);
+    }
+    for (int i = 0; i < NUM_NODES; ++i)
+        newId[nodes[i]] = i;
+    return newId;
+}
+
+/*
+ Renumbers the nodes in the given order, moving their coordinates and index entries along with them, then sorts the
+ segments into runs by the node they leave (keeping their order within each run), works out every edge's length and
+ bearing, pairs every edge with its reverse, indexes the edges by the node they arrive at, classifies every turn between an arriving and a leaving edge from their
+ bearings, and compresses the edges into chains. Edges from an earlier finish() are already in runs in the order they
+ were added, so sorting them again with the new ones after them keeps the edges leaving each node in the order they
+ were loaded.
+ */
+void StreetGraph::finish(NodeOrder order)
+{
+    // the segments in the order they were added
+    vector<int> from;
+    vector<int> to;
+    vector<int> name;
+    from.swap(m_edgeFrom);
+    to.swap(m_edgeTo);
+    name.swap(m_edgeName);
+    
+    // renumber the nodes, and the ends of every segment with them
+    vector<int> newId = nodeOrder(order, from, to);
+    vector<GeoCoord> coords(numNodes());
+    for (int node = 0; node < numNodes(); ++node)
+    {
+        *m_nodeIds.find(m_coords[node]) = newId[node];
+        coords[newId[node]] = std::move(m_coords[node]);
+    }
+    m_coords.swap(coords);
+    for (size_t i = 0; i < from.size(); ++i)
+    {
+        from[i] = newId[from[i]];
+        to[i] = newId[to[i]];
+    }
+    
+    // count the edges leaving every node, then place every segment after the ones before it that leave the same node
+    const size_t NUM_SEGMENTS = from.size();
+    m_firstEdge.assign(numNodes() + 1, 0);
+    for (size_t i = 0; i < NUM_SEGMENTS; ++i)
+        ++m_firstEdge[from[i] + 1];
+    for (int node = 0; node < numNodes(); ++node)
+        m_firstEdge[node + 1] += m_firstEdge[node];
+    vector<int> nextSlot(m_firstEdge.begin(), m_firstEdge.end() - 1);
+    m_edgeFrom.resize(NUM_SEGMENTS);
+    m_edgeTo.resize(NUM_SEGMENTS);
+    m_edgeMiles.resize(NUM_SEGMENTS);
+    m_edgeName.resize(NUM_SEGMENTS);
+    m_edgeBearing.resize(NUM_SEGMENTS);
+    for (size_t i = 0; i < NUM_SEGMENTS; ++i)
+    {
+        int edge = nextSlot[from[i]]++;
+        const GeoCoord& start = m_coords[from[i]];
+        const GeoCoord& end = m_coords[to[i]];
+        m_edgeFrom[edge] = from[i];
+        m_edgeTo[edge] = to[i];
+        m_edgeMiles[edge] = distanceEarthMiles(start, end);
+        m_edgeName[edge] = name[i];
+        // the same angle angleOfLine gives, without building a StreetSegment
+        double degrees = rad2deg(atan2(end.latitude - start.latitude, end.longitude - start.longitude));
+        m_edgeBearing[edge] = quantizeBearing(degrees < 0 ? degrees + 360 : degrees);
+    }
+    
+    // the map holds every segment in both directions, so an edge's reverse is the one leaving its end for its start
+    // on the same street
+    m_edgeReverse.assign(numEdges(), -1);
+    for (int edge = 0; edge < numEdges(); ++edge)
+    {
+        int node = m_edgeTo[edge];
+        for (int back = firstEdge(node); back != endEdge(node)  &&  m_edgeReverse[edge] == -1; ++back)
+        {
+            if (m_edgeTo[back] == m_edgeFrom[edge]  &&  m_edgeName[back] == m_edgeName[edge])
+                m_edgeReverse[edge] = back;
+        }
+    }
+    
+    // index the edges by the node they arrive at, the same way they're stored by the node they leave
+    m_firstInEdge.assign(numNodes() + 1, 0);
+    for (int edge = 0; edge < numEdges(); ++edge)
+        ++m_firstInEdge[m_edgeTo[edge] + 1];
+    for (int node = 0; node < numNodes(); ++node)
+        m_firstInEdge[node + 1] += m_firstInEdge[node];
+    m_inEdges.resize(numEdges());
+    vector<int> nextInSlot(m_firstInEdge.begin(), m_firstInEdge.end() - 1);
+    for (int edge = 0; edge < numEdges(); ++edge)
+        m_inEdges[nextInSlot[m_edgeTo[edge]]++] = edge;
+    
+    // every edge's turns line up with the edges leaving the node it arrives at
+    m_firstTurn.assign(numEdges() + 1, 0);
+    for (int edge = 0; edge < numEdges(); ++edge)
+        m_firstTurn[edge + 1] = m_firstTurn[edge] + endEdge(m_edgeTo[edge]) - firstEdge(m_edgeTo[edge]);
+    m_turnKinds.resize(m_firstTurn[numEdges()]);
+    for (int edge = 0; edge < numEdges(); ++edge)
+    {
+        int node = m_edgeTo[edge];
+        for (int next = firstEdge(node); next != endEdge(node); ++next)
+        {
+            // heading straight back to where the edge came from is a U-turn whatever the angle says
+            TurnKind kind = m_edgeTo[next] == m_edgeFrom[edge] ? TurnKind::U_TURN
+                                                                : classifyTurn(m_edgeBearing[edge], m_edgeBearing[next]);
+            m_turnKinds[turnId(edge, next)] = static_cast<unsigned char>(kind);
+        }
+    }
+    
+    compressChains();
+    labelComponents();
+    
+    // every edge starts out open and costing its length
+    shared_ptr<EdgeCosts> costs = make_shared<EdgeCosts>();
+    costs->version = m_costs != nullptr ? m_costs->version + 1 : 0;
+    costs->edgeCost = m_edgeMiles;
+    costs->chainCost = m_chainMiles;
+    costs->edgeFactor.assign(numEdges(), 1);
+    costs->edgeState.assign(numEdges(), EdgeState::OPEN);
+    publishCosts(costs);
+}
+
+/*
+ Returns the edge that carries on from an edge arriving at a node that isn't a junction: the one of the node's two
+ leaving edges that doesn't go back where the edge came from.
+ */
+int StreetGraph::nextChainEdge(int edge) const
+{
+    int first = firstEdge(m_edgeTo[edge]);
+    return m_edgeTo[first] == m_edgeFrom[edge] ? first + 1 : first;
+}
+
+/*
+ Picks the junctions and walks every chain from them. A node is passed through (not a junction) if exactly two edges
+ leave it and two arrive, and the two leaving edges go to different nodes and have reverses; going in by one of them
+ the only way on is out by the other. Chains are numbered in runs by the junction they leave, in the order of its
+ edges, so the chains leaving a junction are stored together like its edges are.
+ */
+void StreetGraph::compressChains()
+{
+    vector<int> inDegree(numNodes(), 0);
+    for (int edge = 0; edge < numEdges(); ++edge)
+        ++inDegree[m_edgeTo[edge]];
+    vector<bool> junction(numNodes());
+    for (int node = 0; node < numNodes(); ++node)
+    {
+        int first = firstEdge(node);
+        junction[node] = endEdge(node) - first != 2  ||  inDegree[node] != 2  ||
+                         m_edgeTo[first] == m_edgeTo[first + 1]  ||
+                         m_edgeReverse[first] == -1  ||  m_edgeReverse[first + 1] == -1;
+    }
+    
+    // a loop with no junction on it would be walked forever, so its first node is made one; walking both ways from
+    // each node that isn't a junction finds the loops and marks the nodes that aren't on one
+    vector<bool> walked(numNodes(), false);
+    for (int node = 0; node < numNodes(); ++node)
+    {
+        if (junction[node]  ||  walked[node])
+            continue;
+        walked[node] = true;
+        for (int edge = firstEdge(node); edge != endEdge(node)  &&  !junction[node]; ++edge)
+        {
+            int next = edge;
+            while (!junction[m_edgeTo[next]]  &&  m_edgeTo[next] != node)
+            {
+                walked[m_edgeTo[next]] = true;
+                next = nextChainEdge(next);
+            }
+            if (m_edgeTo[next] == node)
+                junction[node] = true;
+        }
+    }
+    
+    m_firstChain.assign(numNodes() + 1, 0);
+    m_chainTo.clear();
+    m_chainMiles.clear();
+    m_firstChainEdge.assign(1, 0);
+    m_chainEdges.clear();
+    m_edgeChain.assign(numEdges(), -1);
+    m_edgeChainPosition.assign(numEdges(), -1);
+    for (int node = 0; node < numNodes(); ++node)
+    {
+        m_firstChain[node] = numChains();
+        if (!junction[node])
+            continue;
+        for (int edge = firstEdge(node); edge != endEdge(node); ++edge)
+        {
+            int chain = numChains();
+            double miles = 0;
+            for (int next = edge; ; next = nextChainEdge(next))
+            {
+                m_edgeChain[next] = chain;
+                m_edgeChainPosition[next] = static_cast<int>(m_chainEdges.size());
+                m_chainEdges.push_back(next);
+                miles += m_edgeMiles[next];
+                if (junction[m_edgeTo[next]])
+                {
+                    m_chainTo.push_back(m_edgeTo[next]);
+                    break;
+                }
+            }
+            m_chainMiles.push_back(miles);
+            m_firstChainEdge.push_back(static_cast<int>(m_chainEdges.size()));
+        }
+    }
+    m_firstChain[numNodes()] = numChains();
+}
+
+/*
+ Labels connected components by joining the ends of every edge in a union-find forest, and strongly connected ones
+ with Tarjan's algorithm, keeping its depth-first path in an explicit stack (a recursive search would overflow the call
+ stack on a long street). Tarjan's algorithm finishes a component only after every component reachable from it, so
+ numbering them in the order they finish makes every edge between two of them go from a higher id to a lower one.
+ */
+void StreetGraph::labelComponents()
+{
+    const int NUM_NODES = numNodes();
+    
+    // every node's parent in the forest, halving the path to the root on every lookup
+    vector<int> parent(NUM_NODES);
+    for (int node = 0; node < NUM_NODES; ++node)
+        parent[node] = node;
+    auto root = [&parent](int node) {
+        while (parent[node] != node)
+            node = parent[node] = parent[parent[node]];
+        return node;
+    };
+    for (int edge = 0; edge < numEdges(); ++edge)
+    {
+        int from = root(m_edgeFrom[edge]);
+        int to = root(m_edgeTo[edge]);
+        if (from != to)
+            parent[max(from, to)] = min(from, to);
+    }
+    // a root is always the lowest node in its tree, so components are numbered before any of their nodes is reached
+    m_component.assign(NUM_NODES, -1);
+    m_numComponents = 0;
+    for (int node = 0; node < NUM_NODES; ++node)
+        m_component[node] = root(node) == node ? m_numComponents++ : m_component[root(node)];
+    
+    m_strongComponent.assign(NUM_NODES, -1);
+    m_numStrongComponents = 0;
+    vector<int> order(NUM_NODES, -1);     // when each node was first visited
+    vector<int> lowest(NUM_NODES);        // earliest visit that the node's unfinished descendants lead back to
+    vector<int> unfinished;               // visited nodes not yet in a component, in the order they were visited
+    vector<pair<int, int>> path;          // the nodes on the depth-first path, each with the next edge to follow
+    int numVisited = 0;
+    for (int start = 0; start < NUM_NODES; ++start)
+    {
+        if (order[start] != -1)
+            continue;
+        order[start] = lowest[start] = numVisited++;
+        unfinished.push_back(start);
+        path.push_back(make_pair(start, firstEdge(start)));
+        while (!path.empty())
+        {
+            int node = path.back().first;
+            int edge = path.back().second;
+            if (edge != endEdge(node))
+            {
+                ++path.back().second;
+                int next = m_edgeTo[edge];
+                if (order[next] == -1)
+                {
+                    order[next] = lowest[next] = numVisited++;
+                    unfinished.push_back(next);
+                    path.push_back(make_pair(next, firstEdge(next)));
+                }
+                else if (m_strongComponent[next] == -1)
+                    lowest[node] = min(lowest[node], order[next]);
+                continue;
+            }
+            
+            // every edge has been followed, so the node is done; if nothing leads back before it, it and every node
+            // visited after it that's still unfinished make up a component
+            path.pop_back();
+            if (!path.empty())
+                lowest[path.back().first] = min(lowest[path.back().first], lowest[node]);
+            if (lowest[node] == order[node])
+            {
+                int member;
+                do
+                {
+                    member = unfinished.back();
+                    unfinished.pop_back();
+                    m_strongComponent[member] = m_numStrongComponents;
+                } while (member != node);
+                ++m_numStrongComponents;
+            }
+        }
+    }
+}
+
+/*
+ Writes one kind of component: its nodes and the edges between them, and where to find it unless it's the biggest.
+ */
+void writeComponentTable(ostream& out, string title, const StreetGraph& graph, const vector<int>& labels,
+                         int numLabels)
+{
+    vector<int> nodes(numLabels, 0);
+    vector<int> edges(numLabels, 0);
+    vector<int> someNode(numLabels, NO_NODE);
+    for (int node = 0; node < graph.numNodes(); ++node)
+    {
+        ++nodes[labels[node]];
+        someNode[labels[node]] = node;
+    }
+    for (int edge = 0; edge < graph.numEdges(); ++edge)
+    {
+        if (labels[graph.edgeFrom(edge)] == labels[graph.edgeTo(edge)])
+            ++edges[labels[graph.edgeFrom(edge)]];
+    }
+    vector<int> bySize(numLabels);
+    for (int label = 0; label < numLabels; ++label)
+        bySize[label] = label;
+    stable_sort(bySize.begin(), bySize.end(), [&nodes](int a, int b) { return nodes[a] > nodes[b]; });
+    
+    out << title << ": " << numLabels << endl;
+    out << "  component       nodes       edges   share   at" << endl;
+    for (int i = 0; i < numLabels  &&  i < COMPONENTS_LISTED; ++i)
+    {
+        int label = bySize[i];
+        out << setw(11) << label << setw(12) << nodes[label] << setw(12) << edges[label] << setw(7) << fixed
+            << setprecision(1) << 100.0 * nodes[label] / graph.numNodes() << "%";
+        if (i > 0)
+        {
+            const GeoCoord& gc = graph.coord(someNode[label]);
+            out << "   " << gc.latitudeText << " " << gc.longitudeText;
+        }
+        out << endl;
+    }
+    if (numLabels > COMPONENTS_LISTED)
+    {
+        out << "  ... and " << numLabels - COMPONENTS_LISTED << " more with at most "
+            << nodes[bySize[COMPONENTS_LISTED]] << " nodes each" << endl;
+    }
+    out << defaultfloat << setprecision(6);
+}
+
+/*
+ A map where every street can be driven both ways has one strongly connected component for each connected one; any
+ more are nodes a route can get into but not back out of, or the other way around.
+ */
+void StreetGraph::writeComponents(ostream& out) const
+{
+    writeComponentTable(out, "Connected components", *this, m_component, m_numComponents);
+    writeComponentTable(out, "Strongly connected components", *this, m_strongComponent, m_numStrongComponents);
+}
+
+int StreetGraph::findNode(const GeoCoord& gc) const
+{
+    const int* found = m_nodeIds.find(gc);
+    return found != nullptr ? *found : NO_NODE;
+}
+
+/*
+ Every table is one component, except that the edge tables are added up into one and coordinates and names include
+ their text.
+ */
+void StreetGraph::memoryUsage(MemoryUsage& usage) const
+{
+    size_t coordBytes = vectorHeapBytes(m_coords);
+    for (auto it = m_coords.begin(); it != m_coords.end(); ++it)
+        coordBytes += coordHeapBytes(*it);
+    usage.add("graph node coordinates", coordBytes, m_coords.size());
+    m_nodeIds.memoryUsage(usage, "graph node index", [](const GeoCoord& gc, int) { return coordHeapBytes(gc); });
+    usage.add("graph edges", vectorHeapBytes(m_firstEdge) + vectorHeapBytes(m_edgeFrom) + vectorHeapBytes(m_edgeTo) +
+              vectorHeapBytes(m_edgeReverse) + vectorHeapBytes(m_firstInEdge) + vectorHeapBytes(m_inEdges) +
+              vectorHeapBytes(m_edgeMiles) + vectorHeapBytes(m_edgeName) +
+              vectorHeapBytes(m_edgeBearing), m_edgeTo.size());
+    size_t nameBytes = vectorHeapBytes(m_names);
+    for (auto it = m_names.begin(); it != m_names.end(); ++it)
+        nameBytes += stringHeapBytes(*it);
+    usage.add("graph street names", nameBytes, m_names.size());
+    usage.add("graph turns", vectorHeapBytes(m_firstTurn) + vectorHeapBytes(m_turnKinds), m_turnKinds.size());
+    usage.add("graph chains", vectorHeapBytes(m_firstChain) + vectorHeapBytes(m_chainTo) + vectorHeapBytes(m_chainMiles) +
+              vectorHeapBytes(m_firstChainEdge) + vectorHeapBytes(m_chainEdges) + vectorHeapBytes(m_edgeChain) +
+              vectorHeapBytes(m_edgeChainPosition), m_chainTo.size());
+    shared_ptr<const EdgeCosts> latest = costs();
+    if (latest != nullptr)
+    {
+        usage.add("graph edge costs", vectorHeapBytes(latest->edgeCost) + vectorHeapBytes(latest->chainCost) +
+                  vectorHeapBytes(latest->edgeFactor) + vectorHeapBytes(latest->edgeState), latest->edgeCost.size());
+    }
+    usage.add("graph components", vectorHeapBytes(m_component) + vectorHeapBytes(m_strongComponent),
+              m_numComponents + m_numStrongComponents);
+}
+
+StreetSegment StreetGraph::segment(int edge) const
+{
+    return StreetSegment(m_coords[m_edgeFrom[edge]], m_coords[m_edgeTo[edge]], m_names[m_edgeName[edge]]);
+}
@@ -0,0 +1,244 @@
+#ifndef StreetGraph_h
+#define StreetGraph_h
+
+#include "provided.h"
+#include "ExpandableHashMap.h"
+#include "MemoryUsage.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <limits>
+#include <iosfwd>
+
+// StreetGraph.h
+
+// An array-based store of a loaded StreetMap that searches can walk without copying StreetSegments. Nodes are the map's
+// distinct coordinates and edges are its directed segments (every segment in the map file is an edge in each
+// direction); both are numbered from 0. The edges leaving a node are stored next to each other, so a search reads
+// them as one contiguous run.
+//
+// Once the map is loaded, nodes are renumbered so that nodes near each other on the map have ids near each other (by
+// default along a Hilbert curve over latitude and longitude), and the edges are numbered to match. The ends of an edge
+// are then about 80 ids apart on average instead of about 1000 in the order the sample map was loaded, so the entries
+// a search reads as it follows edges are closer together in memory. A search only reads the entries of junctions,
+// though, which are spread out among the other nodes, so on the sample map it still reads only about 5% fewer cache
+// lines of a per-node table (see GraphRouter/nodeOrder/* in Microbenchmarks.cpp, which report both figures).
+//
+// The graph is the only copy of the map that's kept: every coordinate is stored once in the node table however many
+// segments share it, every street name once in a pool of names, and an edge is just the ids of its ends and its name.
+//
+// Every edge's bearing is stored quantized to 16 bits, so directions and turns can be worked out with integer math
+// instead of trigonometry.
+//
+// The graph also classifies every turn a driver can make at a node, from each edge arriving there onto each edge
+// leaving it. Turns are stored one byte apiece, in runs that line up with the leaving edges, so the edge-expanded
+// (line) graph used by turn-aware searches never has to be built.
+//
+// Streets are stored as many short segments, so most nodes are just a point partway along a street with one neighbour
+// on either side. The graph also keeps a compressed view for searches: junctions are the nodes that aren't like that
+// (dead ends, intersections, and one node on every loop that has no other junction), and a chain is the run of edges
+// from a junction through such points to the next junction, with its total length. Every edge is in exactly one chain,
+// so a search can step from junction to junction and still give its route as the original edges.
+//
+// Every node is also labelled with its connected component (ignoring which way edges go) and its strongly connected
+// component, so a search between parts of the map that no route joins can be turned down without exploring everything
+// reachable from its start.
+//
+// Searches don't use the edges' lengths directly but their costs (see EdgeCosts below), which start out as the lengths
+// and change when segments are closed or slowed down on a live map (see MapUpdates.h). Nodes and edges never change
+// once the graph is finished; the costs are replaced a whole version at a time.
+
+const int NO_NODE = -1;
+
+  // Orders nodes can be numbered in: as they first appeared in the map file, along a Hilbert or Morton (Z-order) curve
+  // over their latitude and longitude, or breadth first through the streets from the first node loaded.
+enum class NodeOrder
+{
+    LOADED, HILBERT, MORTON, BFS
+};
+const int NUM_NODE_ORDERS = 4;
+
+  // Kinds of turns, by how far the heading changes: straight is within 20 degrees, slight up to 60, a plain turn up to
+  // 120, sharp up to 170, and anything more (including going back the way you came) is a U-turn.
+enum class TurnKind : unsigned char
+{
+    STRAIGHT, SLIGHT_LEFT, LEFT, SHARP_LEFT, SLIGHT_RIGHT, RIGHT, SHARP_RIGHT, U_TURN
+};
+const int NUM_TURN_KINDS = 8;
+
+  // Bearings are counterclockwise from east, like angleOfLine, in units of 1/65536 of a full circle; differences between
+  // them wrap around correctly when they're computed as unsigned shorts.
+const int BEARING_UNITS = 65536;
+
+  // Converts an angle in degrees (e.g. from angleOfLine) to a bearing, rounding to the nearest unit.
+unsigned short quantizeBearing(double degrees);
+
+  // Returns the kind of turn from an edge with one bearing onto an edge with another.
+TurnKind classifyTurn(unsigned short fromBearing, unsigned short toBearing);
+
+  // Cost of an edge that can't be driven
+const double CLOSED_COST = std::numeric_limits<double>::infinity();
+
+  // Whether an edge can be driven. A removed edge is closed for good, and isn't one of the map's segments any more.
+enum class EdgeState : unsigned char
+{
+    OPEN, CLOSED, REMOVED
+};
+
+  // One version of what it costs to drive every edge and chain. A version is never changed once it's published; a
+  // change makes a new one, so a search that holds on to the version it started with sees the same costs throughout.
+struct EdgeCosts
+{
+    long long version;                  // 0 for the costs a graph is finished with, and one more for every change
+    std::vector<double> edgeCost;       // an edge's miles times its factor, or CLOSED_COST if it isn't open
+    std::vector<double> chainCost;      // the total of the costs of a chain's edges
+    std::vector<float> edgeFactor;      // how many times its length it costs to drive an edge, at least 1
+    std::vector<EdgeState> edgeState;
+};
+
+class StreetGraph
+{
+public:
+    StreetGraph();
+
+      // Building: addSegment() adds a directed segment (storing its coordinates and name only if they're new), and
+      // finish() numbers the nodes in the given order and the edges, old and new, to match, and works out their turns.
+      // The graph can't be searched between adding a segment and calling finish(), and node and edge ids from before
+      // finish() aren't kept.
+    void addSegment(const GeoCoord& start, const GeoCoord& end, const std::string& name);
+    void finish(NodeOrder order = NodeOrder::HILBERT);
+
+    int numNodes() const { return static_cast<int>(m_coords.size()); }
+    int numEdges() const { return static_cast<int>(m_edgeTo.size()); }
+
+      // Returns the node at a coordinate, or NO_NODE if the coordinate isn't on the map.
+    int findNode(const GeoCoord& gc) const;
+    const GeoCoord& coord(int node) const { return m_coords[node]; }
+
+      // The edges leaving a node are the ids from firstEdge(node) up to (not including) endEdge(node).
+    int firstEdge(int node) const { return m_firstEdge[node]; }
+    int endEdge(int node) const { return m_firstEdge[node + 1]; }
+
+    int edgeFrom(int edge) const { return m_edgeFrom[edge]; }
+    int edgeTo(int edge) const { return m_edgeTo[edge]; }
+      // Returns the edge that drives the same segment the other way, or -1 if the segment is one-way.
+    int reverseEdge(int edge) const { return m_edgeReverse[edge]; }
+      // The edges arriving at a node are inEdge(position) for positions from firstInEdge(node) up to (not including)
+      // endInEdge(node), in the order of their ids; unlike the reverses of the edges leaving it, they include one-way
+      // segments.
+    int firstInEdge(int node) const { return m_firstInEdge[node]; }
+    int endInEdge(int node) const { return m_firstInEdge[node + 1]; }
+    int inEdge(int position) const { return m_inEdges[position]; }
+    double edgeMiles(int edge) const { return m_edgeMiles[edge]; }
+    int edgeNameId(int edge) const { return m_edgeName[edge]; }
+    unsigned short edgeBearing(int edge) const { return m_edgeBearing[edge]; }
+    const std::string& edgeName(int edge) const { return m_names[m_edgeName[edge]]; }
+    const std::string& name(int nameId) const { return m_names[nameId]; }
+    int numNames() const { return static_cast<int>(m_names.size()); }
+
+      // Builds the StreetSegment an edge stands for.
+    StreetSegment segment(int edge) const;
+
+      // Turns from fromEdge onto the edges leaving edgeTo(fromEdge) have ids from firstTurn(fromEdge) on, in the same
+      // order as those edges; turnId gives the id of the turn onto one of them.
+    int numTurns() const { return static_cast<int>(m_turnKinds.size()); }
+    int firstTurn(int fromEdge) const { return m_firstTurn[fromEdge]; }
+    int turnId(int fromEdge, int toEdge) const { return m_firstTurn[fromEdge] + toEdge - firstEdge(m_edgeTo[fromEdge]); }
+    TurnKind turnKind(int turn) const { return static_cast<TurnKind>(m_turnKinds[turn]); }
+
+      // Chains leaving a junction have ids from firstChain(node) up to (not including) endChain(node); a node that
+      // isn't a junction has none. A chain's edges are chainEdge(position) for positions from chainBegin(chain) up to
+      // chainEnd(chain), in driving order, and edgeChain and edgeChainPosition give the chain an edge is in and where.
+      // A node no edge leaves (the end of a one-way street) is a junction with no chains.
+    bool isJunction(int node) const
+    {
+        return m_firstChain[node] != m_firstChain[node + 1]  ||  m_firstEdge[node] == m_firstEdge[node + 1];
+    }
+    int numChains() const { return static_cast<int>(m_chainTo.size()); }
+    int firstChain(int node) const { return m_firstChain[node]; }
+    int endChain(int node) const { return m_firstChain[node + 1]; }
+    int chainTo(int chain) const { return m_chainTo[chain]; }
+    double chainMiles(int chain) const { return m_chainMiles[chain]; }
+    int chainBegin(int chain) const { return m_firstChainEdge[chain]; }
+    int chainEnd(int chain) const { return m_firstChainEdge[chain + 1]; }
+    int chainEdge(int position) const { return m_chainEdges[position]; }
+    int edgeChain(int edge) const { return m_edgeChain[edge]; }
+    int edgeChainPosition(int edge) const { return m_edgeChainPosition[edge]; }
+
+      // Connected components are numbered from 0 in the order of their first nodes. Strongly connected components are
+      // numbered from 0 so that an edge between two of them always leaves the one with the higher id.
+    int numComponents() const { return m_numComponents; }
+    int numStrongComponents() const { return m_numStrongComponents; }
+    int component(int node) const { return m_component[node]; }
+    int strongComponent(int node) const { return m_strongComponent[node]; }
+      // Returns false if there's certainly no route from one node to another; otherwise there is one if they're in the
+      // same strongly connected component, and may be if they aren't.
+    bool mayReach(int from, int to) const
+    {
+        return m_component[from] == m_component[to]  &&  m_strongComponent[from] >= m_strongComponent[to];
+    }
+
+      // Returns the latest version of the costs; a search should get it once and use it throughout. publishCosts makes
+      // a new version the latest, without waiting for searches using an older one, which stays alive until they finish.
+    std::shared_ptr<const EdgeCosts> costs() const { return std::atomic_load(&m_costs); }
+    void publishCosts(std::shared_ptr<const EdgeCosts> costs) { std::atomic_store(&m_costs, costs); }
+
+      // Writes how many nodes and edges are in each component, largest first, with a coordinate in each small one so it
+      // can be found on the map.
+    void writeComponents(std::ostream& out) const;
+
+      // Adds what the graph's tables and node index take up to usage.
+    void memoryUsage(MemoryUsage& usage) const;
+
+      // We prevent a StreetGraph object from being copied or assigned.
+    StreetGraph(const StreetGraph&) = delete;
+    StreetGraph& operator=(const StreetGraph&) = delete;
+private:
+    std::vector<GeoCoord> m_coords;
+    ExpandableHashMap<GeoCoord, int> m_nodeIds;
+    std::vector<int> m_firstEdge;
+    std::vector<int> m_edgeFrom;
+    std::vector<int> m_edgeTo;
+    std::vector<int> m_edgeReverse;
+    std::vector<int> m_firstInEdge;
+    std::vector<int> m_inEdges;
+    std::vector<double> m_edgeMiles;
+    std::vector<int> m_edgeName;
+    std::vector<unsigned short> m_edgeBearing;
+    std::vector<std::string> m_names;
+    std::vector<int> m_firstTurn;
+    std::vector<unsigned char> m_turnKinds;
+    std::vector<int> m_firstChain;
+    std::vector<int> m_chainTo;
+    std::vector<double> m_chainMiles;
+    std::vector<int> m_firstChainEdge;
+    std::vector<int> m_chainEdges;
+    std::vector<int> m_edgeChain;
+    std::vector<int> m_edgeChainPosition;
+    int m_numComponents;
+    int m_numStrongComponents;
+    std::vector<int> m_component;
+    std::vector<int> m_strongComponent;
+    std::shared_ptr<const EdgeCosts> m_costs;
+    // ids of the names in the pool, so every segment of a street gets the same one
+    std::unordered_map<std::string, int> m_nameIds;
+
+    int addNode(const GeoCoord& gc);
+    std::vector<int> nodeOrder(NodeOrder order, const std::vector<int>& from, const std::vector<int>& to) const;
+    int nextChainEdge(int edge) const;
+    void compressChains();
+    void labelComponents();
+};
+
+  // Returns the graph of a loaded map, which lives as long as the map does and changes only when it's loaded again.
+const StreetGraph* getStreetGraph(const StreetMap* sm);
+
+  // Adds every segment in a map file to a graph in both directions, as StreetMap::load does, and finishes it with its
+  // nodes in the given order; returns false if the file can't be read.
+bool loadStreetGraph(std::string mapFile, StreetGraph& graph, NodeOrder order = NodeOrder::HILBERT);
+
+  // Returns a map's graph so its costs can be changed (see MapUpdates.h), or segments added while it's empty.
+StreetGraph* getEditableStreetGraph(StreetMap* sm);
+
+#endif /* StreetGraph_h */
@@ -1,10 +1,16 @@
 #include "provided.h"
 #include "ExpandableHashMap.h"
+#include "StreetGraph.h"
+#include "Trace.h"
+#include "MemoryUsage.h"
 #include <string>
 #include <vector>
 #include <functional>
 #include <iostream>
 #include <fstream>
+#include <mutex>
+#include <unordered_map>
+#include <memory>
 using namespace std;
 
 // Constant representing number of coordinate doubles per street segment
@@ -19,45 +25,11 @@ unsigned int hasher(const GeoCoord& g)
 }
 
 /*
- Definition of StreetMapImpl; private members were added to spec's skeleton code.
- */
-class StreetMapImpl
-{
-public:
-    StreetMapImpl();
-    ~StreetMapImpl();
-    bool load(string mapFile);
-    bool getSegmentsThatStartWith(const GeoCoord& gc, vector<StreetSegment>& segs) const;
-private:
-    ExpandableHashMap<GeoCoord, std::vector<StreetSegment*>> coordToSegments;
-    std::list<StreetSegment*> allSegments;
-    
-    void addSegment(StreetSegment* segment);
-    StreetSegment* reverse(const StreetSegment* original);
-};
-
-/*
- Constructor for StreetMapImpl; class has no dynamically-allocated objects at its creation,
- so this constructor does nothing.
+ Loads street segments from a text file into a graph, in both directions. Their coordinates and names go into the
+ graph's tables (see StreetGraph.h), so a coordinate shared by several segments or a name shared by a whole street is
+ only stored once.
  */
-StreetMapImpl::StreetMapImpl()
-{
-}
-
-/*
- Destructor for StreetMapImpl; deletes all dynamically-allocated StreetSegment objects created during its lifetime.
- */
-StreetMapImpl::~StreetMapImpl()
-{
-    for (auto it = allSegments.begin(); it != allSegments.end(); ++it)
-        delete *it;
-}
-
-/*
- Loads StreetSegment representations from a text file into an std::list and creates a mapping between their
- starting GeoCoord objects and the segments in an ExpandableHashMap.
- */
-bool StreetMapImpl::load(string mapFile)
+bool loadStreetGraph(string mapFile, StreetGraph& graph, NodeOrder order)
 {
     // file stream object created to the file indicated with mapFile
     std::ifstream fileStream;
@@ -67,12 +39,11 @@ bool StreetMapImpl::load(string mapFile)
     if (!fileStream)
         return false;
     
-    // variables that will be reused throughout the loading process of all StreetSegment objects
+    // variables that will be reused throughout the loading process of all street segments
     // (streets and their names)
-    StreetSegment* street;
     std::string streetName;
     
-    // variables that will be reused throughout the loading process of all StreetSegment objects
+    // variables that will be reused throughout the loading process of all street segments
     // (intermediary variables between file line load and StreetSegment creation)
     int numStreetSegments;
     std::string coordData[NUMS_PER_SEGMENT];
@@ -106,72 +77,135 @@ bool StreetMapImpl::load(string mapFile)
                 startIndex = endIndex + 1;
             }
             
-            // build StreetSegment object with these coordinates and the current street name
-            street = new StreetSegment(GeoCoord(coordData[0], coordData[1]),
-                                       GeoCoord(coordData[2], coordData[3]),
-                                       streetName);
-            // add this StreetSegment to StretMap's containers
-            addSegment(street);
-            // add this reversed segment to StreetMap's containers
-            addSegment(reverse(street));
+            // add the segment with these coordinates and the current street name to the graph, then its reverse
+            GeoCoord start(coordData[0], coordData[1]);
+            GeoCoord end(coordData[2], coordData[3]);
+            graph.addSegment(start, end, streetName);
+            graph.addSegment(end, start, streetName);
         }
     }
-    //end of file, so all segments were imported
+    //end of file, so all segments were imported; number them for the graph
+    graph.finish(order);
     return true;
 }
 
+/*
+ Definition of StreetMapImpl; private members were added to spec's skeleton code.
+ */
+class StreetMapImpl
+{
+public:
+    StreetMapImpl();
+    ~StreetMapImpl();
+    bool load(string mapFile);
+    bool getSegmentsThatStartWith(const GeoCoord& gc, vector<StreetSegment>& segs) const;
+    const StreetGraph* getGraph() const;
+    StreetGraph* getGraph();
+    void memoryUsage(MemoryUsage& usage) const;
+private:
+    // every segment in both directions, with each coordinate and street name stored once; added to whenever a file is
+    // loaded
+    StreetGraph graph;
+};
+
+/*
+ Constructor for StreetMapImpl; class has no dynamically-allocated objects at its creation,
+ so this constructor does nothing.
+ */
+StreetMapImpl::StreetMapImpl()
+{
+}
+
+/*
+ Destructor for StreetMapImpl; the graph owns everything the map stores, so this destructor does nothing.
+ */
+StreetMapImpl::~StreetMapImpl()
+{
+}
+
+/*
+ Loads the file's segments into the map's graph, which numbers its nodes along a Hilbert curve so searches over
+ neighbouring streets read neighbouring memory.
+ */
+bool StreetMapImpl::load(string mapFile)
+{
+    TraceScope trace("StreetMap::load");
+    return loadStreetGraph(mapFile, graph);
+}
+
 /*
  Sets reference vector as the StreetSegments with the same starting coordinate as the GeoCoord that's passed in.
  */
 bool StreetMapImpl::getSegmentsThatStartWith(const GeoCoord& gc, vector<StreetSegment>& segs) const
 {
-    // use ExpandableHashMap's find() function to get a pointer to a vector of StreetSegment pointers that have the same
-    // starting coordinate as the one passed-in
-    const vector<StreetSegment*>* found = coordToSegments.find(gc);
-    // if there aren't any, then the pointer is nullptr; in that case, return false as there aren't any segments that have
+    // find the coordinate's node in the graph; if it isn't one, return false as there aren't any segments that have
     // that starting coordinate
-    if (found == nullptr)
+    int node = graph.findNode(gc);
+    if (node == NO_NODE)
         return false;
     // if the passed-in reference vector has elements, remove all of them
     if (!segs.empty())
         segs.clear();
-    // for each StreetSegment pointed to in the found vector, copy its value to the passed-in reference vector
-    for (auto it = found->begin(); it != found->end(); ++it)
-        segs.push_back(**it);
+    // build a StreetSegment for every edge leaving the node, in the order they were loaded, except those that have
+    // been removed from the map since
+    shared_ptr<const EdgeCosts> costs = graph.costs();
+    for (int edge = graph.firstEdge(node); edge != graph.endEdge(node); ++edge)
+    {
+        if (costs->edgeState[edge] != EdgeState::REMOVED)
+            segs.push_back(graph.segment(edge));
+    }
     // we found at least one segment, so return true
     return true;
 }
 
 /*
- Adds the passed-in StreetSegment pointer to StreetMap's containers.
+ Returns the graph built from the segments loaded so far.
  */
-void StreetMapImpl::addSegment(StreetSegment* segment)
-{
-    // add the segment to the std::list that keeps track of all allocated segments
-    allSegments.push_back(segment);
-    // get pointer to vector of segment pointers with the same starting location that are currently in the ExpandableHashMap
-    std::vector<StreetSegment*>* sharesStartCoord = coordToSegments.find(segment->start);
-    // if there's at least one segment found, then add the new segment's pointer to the existing vector
-    if (sharesStartCoord != nullptr)
-    {
-        sharesStartCoord->push_back(segment);
-    }
-    // if there are currently no segments with that starting location, make a vector that will store such segments,
-    // add the new one, and associate the start of this new segment with the new vector
-    else
-    {
-        std::vector<StreetSegment*> newVector;
-        newVector.push_back(segment);
-        coordToSegments.associate(segment->start, newVector);
-    }
+const StreetGraph* StreetMapImpl::getGraph() const
+{
+    return &graph;
 }
+
+StreetGraph* StreetMapImpl::getGraph()
+{
+    return &graph;
+}
+
 /*
- Create new segment with the same coordinates, but with swapped coordinates so its direction is reversed.
+ Everything the map stores is in the graph.
  */
-inline
-StreetSegment* StreetMapImpl::reverse(const StreetSegment* original)
+void StreetMapImpl::memoryUsage(MemoryUsage& usage) const
 {
-    return new StreetSegment(original->end, original->start, original->name);
+    graph.memoryUsage(usage);
+}
+
+// Every StreetMap's implementation, so getStreetGraph can reach the graph a map builds without StreetMap's
+// declaration changing
+std::mutex implementationsMutex;
+std::unordered_map<const StreetMap*, StreetMapImpl*> implementations;
+
+const StreetGraph* getStreetGraph(const StreetMap* sm)
+{
+    std::lock_guard<std::mutex> lock(implementationsMutex);
+    auto found = implementations.find(sm);
+    return found != implementations.end() ? found->second->getGraph() : nullptr;
+}
+
+StreetGraph* getEditableStreetGraph(StreetMap* sm)
+{
+    std::lock_guard<std::mutex> lock(implementationsMutex);
+    auto found = implementations.find(sm);
+    return found != implementations.end() ? found->second->getGraph() : nullptr;
+}
+
+MemoryUsage getStreetMapMemoryUsage(const StreetMap* sm)
+{
+    MemoryUsage usage;
+    std::lock_guard<std::mutex> lock(implementationsMutex);
+    auto found = implementations.find(sm);
+    if (found != implementations.end())
+        found->second->memoryUsage(usage);
+    return usage;
 }
 
 //******************** StreetMap functions ************************************
@@ -182,10 +216,16 @@ StreetSegment* StreetMapImpl::reverse(const StreetSegment* original)
 StreetMap::StreetMap()
 {
     m_impl = new StreetMapImpl;
+    std::lock_guard<std::mutex> lock(implementationsMutex);
+    implementations[this] = m_impl;
 }
 
 StreetMap::~StreetMap()
 {
+    {
+        std::lock_guard<std::mutex> lock(implementationsMutex);
+        implementations.erase(this);
+    }
     delete m_impl;
 }
 
@@ -0,0 +1,683 @@
+#include "provided.h"
+#include "StreetGraph.h"
+#include "GraphRouter.h"
+#include "DepotRouteCache.h"
+#include "DeliveryTour.h"
+#include "MapUpdates.h"
+#include "TourSolvers.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <queue>
+#include <random>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <limits>
+#include <utility>
+#include <cmath>
+#include <cstdio>
+using namespace std;
+
+// Separate program that checks the routing and optimizing code against slow, obviously correct versions of the same
+// thing: exact tour solvers against trying every order, time-window summaries against stepping through the stops, the
+// router against plain Dijkstra, and so on. Every test is a function that reports each check that fails; the program
+// runs the tests whose names contain a filter and exits with 1 if any check failed. CTest runs each test on its own.
+
+// Seed for everything that's picked at random, so every run checks the same cases
+const unsigned int TEST_SEED = 20200311;
+// Largest batch the exact solvers are checked on; trying every order of it takes a few million steps
+const int MAX_BRUTE_FORCE_DELIVERIES = 9;
+// How many pairs of nodes the router is checked on, and how many segments are closed and slowed down for the check
+const int NUM_ROUTE_PAIRS = 500;
+const int NUM_CHANGED_SEGMENTS = 300;
+// Distances that differ by less than this (in miles or minutes) are the same
+const double TOLERANCE = 1e-6;
+
+//******************** checks **************************************************
+
+int numFailures = 0;
+
+/*
+ Reports a check that failed, with what was being checked.
+ */
+void check(bool passed, const string& what)
+{
+    if (passed)
+        return;
+    ++numFailures;
+    cout << "    FAILED: " << what << endl;
+}
+
+/*
+ Returns a coordinate whose text is made from two numbers, for building small graphs; the text is all that matters to
+ the graph, and it's only used for distances by the router's heuristic.
+ */
+GeoCoord testCoord(double latitude, double longitude)
+{
+    char lat[32];
+    char lon[32];
+    snprintf(lat, sizeof(lat), "%.7f", latitude);
+    snprintf(lon, sizeof(lon), "%.7f", longitude);
+    return GeoCoord(lat, lon);
+}
+
+/*
+ Returns the length of a round trip from the depot (node 0 of the matrix) through the deliveries in order.
+ */
+double tourLength(const vector<float>& miles, const vector<int>& order)
+{
+    const int STRIDE = static_cast<int>(order.size()) + 1;
+    double length = 0;
+    int previous = 0;
+    for (auto it = order.begin(); it != order.end(); ++it)
+    {
+        length += miles[previous * STRIDE + *it + 1];
+        previous = *it + 1;
+    }
+    return length + miles[previous * STRIDE];
+}
+
+/*
+ Fills a distance matrix with the straight-line distances between random points in a unit square, with the depot
+ first.
+ */
+void randomMatrix(mt19937& generator, int numDeliveries, vector<float>& miles)
+{
+    uniform_real_distribution<double> coordinate(0, 1);
+    vector<pair<double, double>> points(numDeliveries + 1);
+    for (auto it = points.begin(); it != points.end(); ++it)
+        *it = make_pair(coordinate(generator), coordinate(generator));
+    const int STRIDE = numDeliveries + 1;
+    miles.assign(STRIDE * STRIDE, 0);
+    for (int a = 0; a < STRIDE; ++a)
+        for (int b = 0; b < STRIDE; ++b)
+            miles[a * STRIDE + b] = static_cast<float>(hypot(points[a].first - points[b].first,
+                                                             points[a].second - points[b].second));
+}
+
+/*
+ Returns the length of the shortest round trip, found by trying every order.
+ */
+double bruteForceLength(const vector<float>& miles, int numDeliveries)
+{
+    vector<int> order(numDeliveries);
+    for (int i = 0; i < numDeliveries; ++i)
+        order[i] = i;
+    double best = numeric_limits<double>::infinity();
+    do
+        best = min(best, tourLength(miles, order));
+    while (next_permutation(order.begin(), order.end()));
+    return best;
+}
+
+/*
+ Returns whether an order visits every delivery exactly once.
+ */
+bool isPermutation(vector<int> order, int numDeliveries)
+{
+    sort(order.begin(), order.end());
+    for (int i = 0; i < static_cast<int>(order.size()); ++i)
+        if (order[i] != i)
+            return false;
+    return static_cast<int>(order.size()) == numDeliveries;
+}
+
+/*
+ Returns the cheapest cost from a node to every other over the graph's latest costs, with plain Dijkstra over every
+ edge; nodes that can't be reached cost infinity.
+ */
+vector<double> dijkstra(const StreetGraph& graph, const EdgeCosts& costs, int start)
+{
+    vector<double> cost(graph.numNodes(), numeric_limits<double>::infinity());
+    typedef pair<double, int> QueueEntry;
+    priority_queue<QueueEntry, vector<QueueEntry>, greater<QueueEntry>> open;
+    cost[start] = 0;
+    open.push(QueueEntry(0, start));
+    while (!open.empty())
+    {
+        QueueEntry entry = open.top();
+        open.pop();
+        if (entry.first > cost[entry.second])
+            continue;
+        for (int edge = graph.firstEdge(entry.second); edge != graph.endEdge(entry.second); ++edge)
+        {
+            if (costs.edgeCost[edge] == CLOSED_COST)
+                continue;
+            double next = entry.first + costs.edgeCost[edge];
+            if (next < cost[graph.edgeTo(edge)])
+            {
+                cost[graph.edgeTo(edge)] = next;
+                open.push(QueueEntry(next, graph.edgeTo(edge)));
+            }
+        }
+    }
+    return cost;
+}
+
+/*
+ Checks the router's routes between random pairs of nodes against Dijkstra: every route has to be a connected walk
+ from start to end over open edges, cost what Dijkstra says the cheapest route costs, and be reported with its length;
+ pairs Dijkstra can't join have to be turned down. Half of the pairs start or end partway along a chain.
+ */
+void checkRoutes(const StreetGraph& graph, const GraphRouter& router, mt19937& generator, const string& what)
+{
+    vector<int> inner;
+    for (int node = 0; node < graph.numNodes(); ++node)
+        if (!graph.isJunction(node))
+            inner.push_back(node);
+    uniform_int_distribution<int> anyNode(0, graph.numNodes() - 1);
+    uniform_int_distribution<int> innerNode(0, static_cast<int>(inner.size()) - 1);
+    shared_ptr<const EdgeCosts> costs = graph.costs();
+    for (int pair = 0; pair < NUM_ROUTE_PAIRS; ++pair)
+    {
+        int start = pair % 2 == 0  ||  inner.empty() ? anyNode(generator) : inner[innerNode(generator)];
+        int end = pair % 4 < 2  ||  inner.empty() ? anyNode(generator) : inner[innerNode(generator)];
+        double cheapest = dijkstra(graph, *costs, start)[end];
+        vector<int> edges;
+        double miles;
+        DeliveryResult result = router.generatePointToPointRoute(graph.coord(start), graph.coord(end), edges, miles);
+        string pairName = what + " from node " + to_string(start) + " to node " + to_string(end);
+        if (cheapest == numeric_limits<double>::infinity())
+        {
+            check(result == NO_ROUTE, pairName + " is turned down");
+            continue;
+        }
+        check(result == DELIVERY_SUCCESS, pairName + " is found");
+        if (result != DELIVERY_SUCCESS)
+            continue;
+        int node = start;
+        double cost = 0;
+        double length = 0;
+        bool connected = true;
+        for (auto it = edges.begin(); it != edges.end(); ++it)
+        {
+            connected = connected  &&  graph.edgeFrom(*it) == node  &&  costs->edgeState[*it] == EdgeState::OPEN;
+            node = graph.edgeTo(*it);
+            cost += costs->edgeCost[*it];
+            length += graph.edgeMiles(*it);
+        }
+        check(connected  &&  node == end, pairName + " is a walk over open edges");
+        check(fabs(cost - cheapest) < TOLERANCE, pairName + " is the cheapest");
+        check(fabs(length - miles) < TOLERANCE, pairName + " has its length reported");
+    }
+}
+
+//******************** tests ***************************************************
+
+/*
+ Held-Karp has to find a shortest round trip of every batch small enough to try every order of.
+ */
+void testHeldKarp(const string&)
+{
+    mt19937 generator(TEST_SEED);
+    for (int numDeliveries = 1; numDeliveries <= MAX_BRUTE_FORCE_DELIVERIES; ++numDeliveries)
+    {
+        for (int instance = 0; instance < 5; ++instance)
+        {
+            vector<float> miles;
+            randomMatrix(generator, numDeliveries, miles);
+            vector<int> order;
+            solveHeldKarp(miles, numDeliveries, order);
+            string what = "Held-Karp on " + to_string(numDeliveries) + " deliveries, instance " + to_string(instance);
+            check(isPermutation(order, numDeliveries), what + " visits every delivery once");
+            check(fabs(tourLength(miles, order) - bruteForceLength(miles, numDeliveries)) < 1e-4, what + " is shortest");
+        }
+    }
+}
+
+/*
+ Branch and bound starts from the matrix's order and has to end up with a shortest round trip: either it finds one, or
+ the matrix's order already is one.
+ */
+void testBranchAndBound(const string&)
+{
+    mt19937 generator(TEST_SEED + 1);
+    for (int numDeliveries = 2; numDeliveries <= MAX_BRUTE_FORCE_DELIVERIES; ++numDeliveries)
+    {
+        for (int instance = 0; instance < 5; ++instance)
+        {
+            vector<float> miles;
+            randomMatrix(generator, numDeliveries, miles);
+            vector<int> order(numDeliveries);
+            for (int i = 0; i < numDeliveries; ++i)
+                order[i] = i;
+            double initial = tourLength(miles, order);
+            bool improved = searchBranchAndBound(miles, numDeliveries, order);
+            string what = "branch and bound on " + to_string(numDeliveries) + " deliveries, instance " +
+                          to_string(instance);
+            check(isPermutation(order, numDeliveries), what + " visits every delivery once");
+            check(!improved  ||  tourLength(miles, order) < initial, what + " only reports shorter orders");
+            check(fabs(tourLength(miles, order) - bruteForceLength(miles, numDeliveries)) < 1e-4, what + " is shortest");
+        }
+    }
+}
+
+/*
+ Concatenating the summaries of random stops has to give what stepping through them does, starting service at the
+ first stop at either end of the range the summary gives: a driver who arrives early waits, and one who arrives late
+ is sent back to the end of the window and the lateness is counted as time warp.
+ */
+void testTimeWindows(const string&)
+{
+    mt19937 generator(TEST_SEED + 2);
+    uniform_real_distribution<double> opening(0, 600);
+    uniform_real_distribution<double> width(0, 120);
+    uniform_real_distribution<double> minutes(0, 30);
+    for (int instance = 0; instance < 200; ++instance)
+    {
+        int numStops = 1 + instance % 12;
+        vector<TimeWindowData> stops(numStops);
+        vector<double> travel(numStops);
+        for (int i = 0; i < numStops; ++i)
+        {
+            double earliest = opening(generator);
+            stops[i] = TimeWindowData{ minutes(generator), 0, earliest, earliest + width(generator) };
+            travel[i] = minutes(generator);
+        }
+        // joined left to right, and also as two halves, which has to give the same summary
+        TimeWindowData joined = stops[0];
+        for (int i = 1; i < numStops; ++i)
+            joined = concatenate(joined, travel[i - 1], stops[i]);
+        int half = numStops / 2;
+        if (half > 0)
+        {
+            TimeWindowData first = stops[0];
+            for (int i = 1; i < half; ++i)
+                first = concatenate(first, travel[i - 1], stops[i]);
+            TimeWindowData second = stops[half];
+            for (int i = half + 1; i < numStops; ++i)
+                second = concatenate(second, travel[i - 1], stops[i]);
+            TimeWindowData halves = concatenate(first, travel[half - 1], second);
+            check(fabs(halves.duration - joined.duration) < TOLERANCE  &&
+                  fabs(halves.timeWarp - joined.timeWarp) < TOLERANCE, "concatenation is associative, instance " +
+                  to_string(instance));
+        }
+        
+        string what = "time windows of " + to_string(numStops) + " stops, instance " + to_string(instance);
+        check(joined.earliest <= joined.latest + TOLERANCE, what + " have a range of start times");
+        for (double start : { joined.earliest, joined.latest })
+        {
+            double time = start;
+            double warp = 0;
+            for (int i = 0; i < numStops; ++i)
+            {
+                if (i > 0)
+                    time += travel[i - 1];
+                time = max(time, stops[i].earliest);
+                if (time > stops[i].latest)
+                {
+                    warp += time - stops[i].latest;
+                    time = stops[i].latest;
+                }
+                time += stops[i].duration;
+            }
+            check(fabs(warp - joined.timeWarp) < TOLERANCE, what + " have the simulated time warp");
+            check(fabs(time - start - (joined.duration - joined.timeWarp)) < TOLERANCE,
+                  what + " take the simulated time");
+        }
+    }
+}
+
+/*
+ The router has to agree with Dijkstra on the map, and again once segments have been closed and slowed down.
+ */
+void testGraphRouter(const string& mapFile)
+{
+    StreetMap sm;
+    check(sm.load(mapFile), "map loads");
+    const StreetGraph* graph = getStreetGraph(&sm);
+    GraphRouter router(&sm);
+    mt19937 generator(TEST_SEED + 3);
+    checkRoutes(*graph, router, generator, "route");
+    
+    uniform_int_distribution<int> anyEdge(0, graph->numEdges() - 1);
+    vector<SegmentChange> changes;
+    for (int i = 0; i < NUM_CHANGED_SEGMENTS; ++i)
+    {
+        int edge = anyEdge(generator);
+        SegmentChange change;
+        change.kind = i % 2 == 0 ? SegmentChangeKind::CLOSE : SegmentChangeKind::SLOW;
+        change.start = graph->coord(graph->edgeFrom(edge));
+        change.end = graph->coord(graph->edgeTo(edge));
+        change.bothWays = i % 3 != 0;
+        change.factor = 1 + i % 4;
+        changes.push_back(change);
+    }
+    string error;
+    check(updateStreetMap(&sm, changes, error), "segments close and slow down: " + error);
+    checkRoutes(*graph, router, generator, "route around closures");
+}
+
+/*
+ Components are checked on small random graphs against reachability found by breadth-first search: a node may only be
+ in the same strong component as another if each reaches the other, and mayReach has to be true whenever one reaches
+ the other. A route between nodes that can't reach each other has to be turned down.
+ */
+void testComponents(const string&)
+{
+    mt19937 generator(TEST_SEED + 4);
+    for (int instance = 0; instance < 20; ++instance)
+    {
+        const int NUM_NODES = 30;
+        StreetGraph graph;
+        vector<GeoCoord> coords;
+        for (int i = 0; i < NUM_NODES; ++i)
+            coords.push_back(testCoord(34 + 0.001 * (i % 6), -118 - 0.001 * (i / 6)));
+        uniform_int_distribution<int> anyNode(0, NUM_NODES - 1);
+        for (int segment = 0; segment < NUM_NODES; ++segment)
+        {
+            int from = anyNode(generator);
+            int to = anyNode(generator);
+            // coordinates that aren't on any segment are left out of the graph
+            if (from == to)
+                continue;
+            graph.addSegment(coords[from], coords[to], "Test Street");
+            if (segment % 3 == 0)
+                graph.addSegment(coords[to], coords[from], "Test Street");
+        }
+        graph.finish();
+        GraphRouter router(&graph);
+        
+        vector<vector<bool>> reaches(graph.numNodes(), vector<bool>(graph.numNodes(), false));
+        for (int start = 0; start < graph.numNodes(); ++start)
+        {
+            queue<int> open;
+            open.push(start);
+            reaches[start][start] = true;
+            while (!open.empty())
+            {
+                int node = open.front();
+                open.pop();
+                for (int edge = graph.firstEdge(node); edge != graph.endEdge(node); ++edge)
+                {
+                    if (!reaches[start][graph.edgeTo(edge)])
+                    {
+                        reaches[start][graph.edgeTo(edge)] = true;
+                        open.push(graph.edgeTo(edge));
+                    }
+                }
+            }
+        }
+        string what = "components of random graph " + to_string(instance);
+        for (int a = 0; a < graph.numNodes(); ++a)
+        {
+            for (int b = 0; b < graph.numNodes(); ++b)
+            {
+                bool mutual = reaches[a][b]  &&  reaches[b][a];
+                check((graph.strongComponent(a) == graph.strongComponent(b)) == mutual,
+                      what + ": nodes " + to_string(a) + " and " + to_string(b) + " share a strong component");
+                check(!reaches[a][b]  ||  graph.mayReach(a, b),
+                      what + ": node " + to_string(a) + " may reach node " + to_string(b));
+                check(!reaches[a][b]  ||  graph.component(a) == graph.component(b),
+                      what + ": nodes " + to_string(a) + " and " + to_string(b) + " share a component");
+            }
+        }
+        for (int a = 0; a < graph.numNodes(); ++a)
+        {
+            for (int b = 0; b < graph.numNodes(); ++b)
+            {
+                if (reaches[a][b])
+                    continue;
+                vector<int> edges;
+                double miles;
+                check(router.generatePointToPointRoute(graph.coord(a), graph.coord(b), edges, miles) == NO_ROUTE,
+                      what + ": no route from node " + to_string(a) + " to node " + to_string(b));
+            }
+        }
+    }
+    
+    // a one-way street into a two-way loop: the loop can't get back out
+    StreetGraph graph;
+    GeoCoord a = testCoord(34, -118);
+    GeoCoord b = testCoord(34.001, -118);
+    GeoCoord c = testCoord(34.002, -118);
+    graph.addSegment(a, b, "One Way");
+    graph.addSegment(b, c, "Loop");
+    graph.addSegment(c, b, "Loop");
+    graph.finish();
+    int nodeA = graph.findNode(a);
+    int nodeB = graph.findNode(b);
+    int nodeC = graph.findNode(c);
+    check(graph.numComponents() == 1  &&  graph.numStrongComponents() == 2, "one-way street makes two strong components");
+    check(graph.mayReach(nodeA, nodeC)  &&  !graph.mayReach(nodeC, nodeA), "one-way street is only followed one way");
+    check(graph.strongComponent(nodeB) == graph.strongComponent(nodeC), "two-way loop is one strong component");
+}
+
+/*
+ Deliveries that have been made stay at the front of the tour, in order, whatever is added and cancelled after them.
+ */
+void testDeliveryTour(const string& mapFile)
+{
+    StreetMap sm;
+    check(sm.load(mapFile), "map loads");
+    const StreetGraph* graph = getStreetGraph(&sm);
+    mt19937 generator(TEST_SEED + 5);
+    uniform_int_distribution<int> anyNode(0, graph->numNodes() - 1);
+    vector<DeliveryRequest> deliveries;
+    for (int i = 0; i < 12; ++i)
+        deliveries.push_back(DeliveryRequest("Item " + to_string(i), graph->coord(anyNode(generator))));
+    
+    DeliveryTour tour(&sm);
+    tour.setTour(graph->coord(anyNode(generator)), deliveries);
+    const int NUM_COMPLETED = 5;
+    tour.markCompleted(NUM_COMPLETED);
+    for (int change = 0; change < 40; ++change)
+    {
+        if (change % 3 == 2)
+        {
+            int size = static_cast<int>(tour.deliveries().size());
+            check(!tour.cancelDelivery(change % NUM_COMPLETED), "a made delivery can't be cancelled");
+            if (size > NUM_COMPLETED)
+                check(tour.cancelDelivery(NUM_COMPLETED + change % (size - NUM_COMPLETED)),
+                      "a delivery that hasn't been made can be cancelled");
+        }
+        else
+        {
+            int position = tour.addDelivery(DeliveryRequest("Added " + to_string(change),
+                                                            graph->coord(anyNode(generator))));
+            check(position >= NUM_COMPLETED, "an added delivery goes after the made ones");
+        }
+        bool kept = static_cast<int>(tour.deliveries().size()) >= NUM_COMPLETED;
+        for (int i = 0; kept  &&  i < NUM_COMPLETED; ++i)
+            kept = tour.deliveries()[i].item == deliveries[i].item;
+        check(kept, "made deliveries stay at the front after change " + to_string(change));
+    }
+}
+
+/*
+ Closing a segment on a depot's tree has to drop the depot from the cache, so the next leg out of it goes around the
+ closure; closing one that isn't on either tree leaves it alone, and reopening drops it again since routes can only
+ have got shorter.
+ */
+void testDepotCacheUpdates(const string& mapFile)
+{
+    StreetMap sm;
+    check(sm.load(mapFile), "map loads");
+    const StreetGraph* graph = getStreetGraph(&sm);
+    DepotRouteCache cache(&sm);
+    GraphRouter router(&sm);
+    mt19937 generator(TEST_SEED + 6);
+    uniform_int_distribution<int> anyNode(0, graph->numNodes() - 1);
+    
+    // a depot with a route of a few edges to a destination
+    GeoCoord depot;
+    GeoCoord destination;
+    vector<int> edges;
+    double miles;
+    DeliveryResult result;
+    do
+    {
+        depot = graph->coord(anyNode(generator));
+        destination = graph->coord(anyNode(generator));
+    } while (router.generatePointToPointRoute(depot, destination, edges, miles) != DELIVERY_SUCCESS  ||
+             edges.size() < 4);
+    check(cache.addDepot(depot), "depot is cached");
+    check(cache.findRoute(depot, destination, edges, miles, result)  &&  result == DELIVERY_SUCCESS,
+          "leg out of the depot comes from the cache");
+    
+    int closed = edges[edges.size() / 2];
+    SegmentChange change;
+    change.kind = SegmentChangeKind::CLOSE;
+    change.start = graph->coord(graph->edgeFrom(closed));
+    change.end = graph->coord(graph->edgeTo(closed));
+    change.name = graph->edgeName(closed);
+    string error;
+    check(updateStreetMap(&sm, { change }, error), "segment on the depot's tree closes: " + error);
+    check(cache.stats().depots == 0  &&  cache.stats().invalidations == 1, "closure drops the depot");
+    check(!cache.findRoute(depot, destination, edges, miles, result), "dropped depot isn't used");
+    
+    check(cache.addDepot(depot), "depot is cached again");
+    vector<int> around;
+    double aroundMiles;
+    check(cache.findRoute(depot, destination, around, aroundMiles, result), "leg comes from the new trees");
+    vector<int> routed;
+    double routedMiles;
+    DeliveryResult routedResult = router.generatePointToPointRoute(depot, destination, routed, routedMiles);
+    check(result == routedResult, "cache and router agree on whether there's a route around the closure");
+    check(find(around.begin(), around.end(), closed) == around.end(), "leg goes around the closure");
+    check(result != DELIVERY_SUCCESS  ||  fabs(aroundMiles - routedMiles) < TOLERANCE,
+          "leg around the closure is as short as the router's");
+    
+    // a segment that neither tree uses (one whose far end is reached some other way) doesn't drop the depot
+    long long invalidations = cache.stats().invalidations;
+    int unused = -1;
+    for (int edge = 0; edge < graph->numEdges()  &&  unused == -1; ++edge)
+    {
+        if (graph->edgeFrom(edge) == graph->findNode(depot)  ||  graph->edgeTo(edge) == graph->findNode(depot))
+            continue;
+        vector<int> to;
+        vector<int> from;
+        double ignored;
+        DeliveryResult toResult;
+        DeliveryResult fromResult;
+        cache.findRoute(depot, graph->coord(graph->edgeTo(edge)), to, ignored, toResult);
+        cache.findRoute(graph->coord(graph->edgeFrom(edge)), depot, from, ignored, fromResult);
+        if (toResult == DELIVERY_SUCCESS  &&  !to.empty()  &&  to.back() != edge  &&
+            fromResult == DELIVERY_SUCCESS  &&  !from.empty()  &&  from.front() != edge)
+            unused = edge;
+    }
+    check(unused != -1, "some segment is on neither of the depot's trees");
+    if (unused != -1)
+    {
+        SegmentChange other;
+        other.kind = SegmentChangeKind::CLOSE;
+        other.start = graph->coord(graph->edgeFrom(unused));
+        other.end = graph->coord(graph->edgeTo(unused));
+        other.bothWays = false;
+        other.name = graph->edgeName(unused);
+        check(updateStreetMap(&sm, { other }, error), "segment off the depot's trees closes: " + error);
+        check(cache.stats().depots == 1  &&  cache.stats().invalidations == invalidations,
+              "closure off the trees keeps the depot");
+    }
+    
+    SegmentChange reopen = change;
+    reopen.kind = SegmentChangeKind::REOPEN;
+    check(updateStreetMap(&sm, { reopen }, error), "segment reopens: " + error);
+    check(cache.stats().depots == 0  &&  cache.stats().invalidations == invalidations + 1, "reopening drops the depot");
+}
+
+/*
+ Adds one-way segments toward a depot to the map: a shortcut straight to it, and a detour through a coordinate that
+ was on no street, whose only way on is to the depot. Routes to the depot from the cache's trees have to use them
+ as the router does, though neither has a segment going back the other way.
+ */
+void testOneWayToDepot(const string& mapFile)
+{
+    StreetMap sm;
+    check(sm.load(mapFile), "map loads");
+    const GeoCoord depot("34.0625329", "-118.4470263");
+    const GeoCoord start("34.0547000", "-118.4794734");
+    const GeoCoord detour("34.0600000", "-118.4600000");
+    SegmentChange shortcut;
+    shortcut.kind = SegmentChangeKind::ADD;
+    shortcut.start = start;
+    shortcut.end = depot;
+    shortcut.name = "Shortcut";
+    shortcut.bothWays = false;
+    SegmentChange toDetour = shortcut;
+    toDetour.end = detour;
+    toDetour.name = "Detour";
+    SegmentChange fromDetour = toDetour;
+    fromDetour.start = detour;
+    fromDetour.end = depot;
+    StreetMap updated;
+    string error;
+    check(loadUpdatedStreetMap(&updated, &sm, { shortcut, toDetour, fromDetour }, error),
+          "one-way segments add: " + error);
+    
+    const StreetGraph* graph = getStreetGraph(&updated);
+    DepotRouteCache cache(&updated);
+    GraphRouter router(&updated);
+    check(cache.addDepot(depot), "depot is cached");
+    mt19937 generator(TEST_SEED + 7);
+    uniform_int_distribution<int> anyNode(0, graph->numNodes() - 1);
+    vector<GeoCoord> starts = { start, detour };
+    for (int i = 0; i < 50; ++i)
+        starts.push_back(graph->coord(anyNode(generator)));
+    for (auto it = starts.begin(); it != starts.end(); ++it)
+    {
+        vector<int> cached;
+        vector<int> routed;
+        double cachedMiles;
+        double routedMiles;
+        DeliveryResult cachedResult;
+        string what = "leg to the depot from " + it->latitudeText + " " + it->longitudeText;
+        check(cache.findRoute(*it, depot, cached, cachedMiles, cachedResult), what + " comes from the cache");
+        DeliveryResult routedResult = router.generatePointToPointRoute(*it, depot, routed, routedMiles);
+        check(cachedResult == routedResult, what + " has a route in the cache if the router finds one");
+        check(cachedResult != DELIVERY_SUCCESS  ||  fabs(cachedMiles - routedMiles) < TOLERANCE,
+              what + " is as short as the router's");
+    }
+    vector<int> edges;
+    double miles;
+    DeliveryResult result;
+    cache.findRoute(start, depot, edges, miles, result);
+    check(result == DELIVERY_SUCCESS  &&  edges.size() == 1, "leg from the shortcut's start takes the shortcut");
+}
+
+//******************** runner **************************************************
+
+struct Test
+{
+    string name;
+    function<void(const string&)> run;     // given the map file
+};
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        cout << "Usage: " << argv[0] << " mapdata.txt [filter]" << endl;
+        return 1;
+    }
+    string filter = argc > 2 ? argv[2] : "";
+    
+    vector<Test> tests = {
+        { "HeldKarp", testHeldKarp },
+        { "BranchAndBound", testBranchAndBound },
+        { "TimeWindows", testTimeWindows },
+        { "GraphRouter", testGraphRouter },
+        { "Components", testComponents },
+        { "DeliveryTour", testDeliveryTour },
+        { "DepotCacheUpdates", testDepotCacheUpdates },
+        { "OneWayToDepot", testOneWayToDepot },
+    };
+    int numRun = 0;
+    for (auto it = tests.begin(); it != tests.end(); ++it)
+    {
+        if (it->name.find(filter) == string::npos)
+            continue;
+        int failuresBefore = numFailures;
+        cout << it->name << endl;
+        it->run(argv[1]);
+        cout << "  " << (numFailures == failuresBefore ? "passed" : "FAILED") << endl;
+        ++numRun;
+    }
+    if (numRun == 0)
+    {
+        cout << "No test matches " << filter << endl;
+        return 1;
+    }
+    return numFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,85 @@
+#ifndef TimedDelivery_h
+#define TimedDelivery_h
+
+#include "provided.h"
+#include <string>
+#include <vector>
+
+// TimedDelivery.h
+
+// Deliveries that must be made within a time window. All times are in minutes (e.g. minutes after midnight) and all
+// speeds are in miles per hour; travel time between stops is the distance travelled divided by the driver's speed.
+
+struct TimedDeliveryRequest
+{
+    TimedDeliveryRequest(std::string it, const GeoCoord& loc, double earliest, double latest, double service)
+     : item(it), location(loc), earliestArrival(earliest), latestArrival(latest), serviceMinutes(service)
+    {}
+    std::string item;
+    GeoCoord location;
+    double earliestArrival;     // a driver arriving sooner waits until this time to deliver
+    double latestArrival;       // delivery has to begin by this time
+    double serviceMinutes;      // time spent at the stop making the delivery
+};
+
+struct DeliveryArrival
+{
+    std::string item;           // item delivered at this stop
+    double arrivalTime;         // when the driver reaches the stop
+    double serviceStart;        // when the delivery begins, after waiting for the window to open
+    bool onTime;                // whether the delivery began within its window
+};
+
+class DeliveryOptimizerImpl;
+
+class TimedDeliveryOptimizer
+{
+public:
+    TimedDeliveryOptimizer(const StreetMap* sm);
+    ~TimedDeliveryOptimizer();
+
+      // Reorders deliveries to minimize crow distance while meeting every time window, given the time the driver
+      // leaves the depot. Returns whether an order that meets every window was found; if not, the order that misses
+      // them by the least total time is used.
+    bool optimizeDeliveryOrder(
+        const GeoCoord& depot,
+        double departureTime,
+        double milesPerHour,
+        std::vector<TimedDeliveryRequest>& deliveries,
+        double& oldCrowDistance,
+        double& newCrowDistance) const;
+
+      // We prevent a TimedDeliveryOptimizer object from being copied or assigned.
+    TimedDeliveryOptimizer(const TimedDeliveryOptimizer&) = delete;
+    TimedDeliveryOptimizer& operator=(const TimedDeliveryOptimizer&) = delete;
+private:
+    DeliveryOptimizerImpl* m_impl;
+};
+
+class DeliveryPlannerImpl;
+
+class TimedDeliveryPlanner
+{
+public:
+    TimedDeliveryPlanner(const StreetMap* sm);
+    ~TimedDeliveryPlanner();
+
+      // Plans a route like DeliveryPlanner does, ordering the deliveries by their time windows. arrivals gets one entry
+      // per delivery in the order they're made, timed with the distance actually travelled on the streets.
+    DeliveryResult generateDeliveryPlan(
+        const GeoCoord& depot,
+        double departureTime,
+        double milesPerHour,
+        const std::vector<TimedDeliveryRequest>& deliveries,
+        std::vector<DeliveryCommand>& commands,
+        std::vector<DeliveryArrival>& arrivals,
+        double& totalDistanceTravelled) const;
+
+      // We prevent a TimedDeliveryPlanner object from being copied or assigned.
+    TimedDeliveryPlanner(const TimedDeliveryPlanner&) = delete;
+    TimedDeliveryPlanner& operator=(const TimedDeliveryPlanner&) = delete;
+private:
+    DeliveryPlannerImpl* m_impl;
+};
+
+#endif /* TimedDelivery_h */
@@ -0,0 +1,52 @@
+#ifndef TourSolvers_h
+#define TourSolvers_h
+
+#include <vector>
+#include <algorithm>
+
+// TourSolvers.h
+
+// The parts of DeliveryOptimizer that work on a matrix of distances or on summaries of time windows rather than on
+// deliveries: the exact solvers for small batches and the time-window arithmetic the timed local search is built on.
+// A distance matrix has the depot as node 0 and the deliveries as nodes 1 to n, stored row by row, and an order is a
+// list of delivery indices (node - 1).
+
+  // Summary of a sequence of stops that lets time windows be checked without walking the sequence: the time it takes
+  // to visit every stop, the total lateness ("time warp") needed to meet every window, and the earliest and latest
+  // times service at the first stop can begin while keeping waiting and lateness to a minimum.
+struct TimeWindowData
+{
+    double duration;
+    double timeWarp;
+    double earliest;
+    double latest;
+};
+
+  // Returns the data of one sequence of stops followed by another, given the travel time from the first sequence's
+  // last stop to the second sequence's first stop. This is O(1) no matter how long the sequences are.
+inline
+TimeWindowData concatenate(const TimeWindowData& first, double travel, const TimeWindowData& second)
+{
+    // time from beginning service in the first sequence to arriving at the second
+    double delta = first.duration - first.timeWarp + travel;
+    // waiting forced by arriving before the second sequence's window opens, and lateness from arriving after it closes
+    double addedWait = std::max(second.earliest - delta - first.latest, 0.0);
+    double addedWarp = std::max(first.earliest + delta - second.latest, 0.0);
+
+    TimeWindowData joined;
+    joined.duration = first.duration + second.duration + travel + addedWait;
+    joined.timeWarp = first.timeWarp + second.timeWarp + addedWarp;
+    joined.earliest = std::max(second.earliest - delta, first.earliest) - addedWait;
+    joined.latest = std::min(second.latest - delta, first.latest) + addedWarp;
+    return joined;
+}
+
+  // Passes back the shortest round trip from the depot through every delivery, found with Held-Karp dynamic
+  // programming; its table takes 2^n * n floats.
+void solveHeldKarp(const std::vector<float>& miles, int numDeliveries, std::vector<int>& order);
+
+  // Searches for an order shorter than visiting the deliveries in matrix order with branch and bound. Returns whether
+  // one was found, in which case it's passed back through order.
+bool searchBranchAndBound(const std::vector<float>& miles, int numDeliveries, std::vector<int>& order);
+
+#endif /* TourSolvers_h */
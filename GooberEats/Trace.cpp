@@ -0,0 +1,147 @@
+#include "Trace.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <cstdio>
+using namespace std;
+
+// Most buffers of finished threads that are kept; older ones are dropped as threads finish
+const size_t MAX_RETIRED_BUFFERS = 64;
+
+atomic<bool> tracingEnabled(false);
+
+struct TraceEvent
+{
+    const char* name;
+    const char* argName;
+    long long arg;
+    long long startNanos;
+    long long endNanos;
+};
+
+/*
+ One thread's ring of events. Only its thread adds to it, but traceJson() reads it from another, so both lock its
+ mutex; nothing else ever does, so adding an event never waits unless a trace is being exported.
+ */
+struct TraceBuffer
+{
+    mutex lock;
+    vector<TraceEvent> events;      // allocated with the first event
+    long long numRecorded = 0;      // events ever added; the newest is at (numRecorded - 1) % TRACE_BUFFER_EVENTS
+    int threadId = 0;
+};
+
+// Buffers of live threads, and of the latest threads to finish
+mutex traceRegistryMutex;
+vector<shared_ptr<TraceBuffer>> liveBuffers;
+deque<shared_ptr<TraceBuffer>> retiredBuffers;
+int nextThreadId = 1;
+
+/*
+ Owns the calling thread's buffer and registers it, and moves it to the retired buffers when the thread finishes so
+ its events can still be exported.
+ */
+struct ThreadTraceBuffer
+{
+    shared_ptr<TraceBuffer> buffer;
+    
+    ThreadTraceBuffer()
+     : buffer(make_shared<TraceBuffer>())
+    {
+        lock_guard<mutex> lock(traceRegistryMutex);
+        buffer->threadId = nextThreadId++;
+        liveBuffers.push_back(buffer);
+    }
+    ~ThreadTraceBuffer()
+    {
+        lock_guard<mutex> lock(traceRegistryMutex);
+        for (auto it = liveBuffers.begin(); it != liveBuffers.end(); ++it)
+        {
+            if (*it == buffer)
+            {
+                liveBuffers.erase(it);
+                break;
+            }
+        }
+        retiredBuffers.push_back(buffer);
+        if (retiredBuffers.size() > MAX_RETIRED_BUFFERS)
+            retiredBuffers.pop_front();
+    }
+};
+
+void startTracing()
+{
+    tracingEnabled.store(true);
+}
+
+void stopTracing()
+{
+    tracingEnabled.store(false);
+}
+
+/*
+ Forgets every event recorded so far, and the buffers of threads that have finished.
+ */
+void clearTrace()
+{
+    lock_guard<mutex> lock(traceRegistryMutex);
+    retiredBuffers.clear();
+    for (auto it = liveBuffers.begin(); it != liveBuffers.end(); ++it)
+    {
+        lock_guard<mutex> bufferLock((*it)->lock);
+        (*it)->numRecorded = 0;
+    }
+}
+
+void recordTraceEvent(const char* name, const char* argName, long long arg, long long startNanos, long long endNanos)
+{
+    static thread_local ThreadTraceBuffer threadBuffer;
+    TraceBuffer& buffer = *threadBuffer.buffer;
+    lock_guard<mutex> lock(buffer.lock);
+    if (buffer.events.empty())
+        buffer.events.resize(TRACE_BUFFER_EVENTS);
+    TraceEvent& event = buffer.events[buffer.numRecorded % TRACE_BUFFER_EVENTS];
+    event.name = name;
+    event.argName = argName;
+    event.arg = arg;
+    event.startNanos = startNanos;
+    event.endNanos = endNanos;
+    ++buffer.numRecorded;
+}
+
+/*
+ Appends a buffer's events, oldest first, as complete ("X") events. Chrome traces count time in microseconds.
+ */
+void appendEvents(string& out, TraceBuffer& buffer, bool& first)
+{
+    lock_guard<mutex> lock(buffer.lock);
+    long long begin = buffer.numRecorded > TRACE_BUFFER_EVENTS ? buffer.numRecorded - TRACE_BUFFER_EVENTS : 0;
+    for (long long i = begin; i < buffer.numRecorded; ++i)
+    {
+        const TraceEvent& event = buffer.events[i % TRACE_BUFFER_EVENTS];
+        char times[96];
+        snprintf(times, sizeof(times), "\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d", event.startNanos / 1000.0,
+                 (event.endNanos - event.startNanos) / 1000.0, buffer.threadId);
+        out += first ? "" : ",";
+        out += string("{\"name\":\"") + event.name + "\",\"cat\":\"goobereats\",\"ph\":\"X\"," + times;
+        if (event.argName != nullptr)
+            out += string(",\"args\":{\"") + event.argName + "\":" + to_string(event.arg) + "}";
+        out += "}";
+        first = false;
+    }
+}
+
+string traceJson()
+{
+    string out = "{\"traceEvents\":[";
+    bool first = true;
+    lock_guard<mutex> lock(traceRegistryMutex);
+    for (auto it = retiredBuffers.begin(); it != retiredBuffers.end(); ++it)
+        appendEvents(out, **it, first);
+    for (auto it = liveBuffers.begin(); it != liveBuffers.end(); ++it)
+        appendEvents(out, **it, first);
+    return out + "],\"displayTimeUnit\":\"ms\"}";
+}
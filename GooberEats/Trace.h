@@ -0,0 +1,74 @@
+#ifndef Trace_h
+#define Trace_h
+
+#include <string>
+#include <atomic>
+#include <chrono>
+
+// Trace.h
+
+// A tracer for the slow stages of loading and planning. A TraceScope placed at the top of a block records when the
+// block started and how long it took, in a ring buffer kept by each thread (so recording costs a clock read and an
+// uncontended lock, and the oldest events are overwritten once a thread has recorded TRACE_BUFFER_EVENTS of them).
+// traceJson() gathers every thread's events in the Chrome trace event format, which chrome://tracing and Perfetto
+// open directly, so a slow plan shows which stage and which leg took the time.
+//
+// Tracing is off until startTracing() is called; until then a scope costs one load of a flag. Building with
+// GOOBEREATS_TRACING defined as 0 removes the scopes altogether.
+
+#ifndef GOOBEREATS_TRACING
+#define GOOBEREATS_TRACING 1
+#endif
+
+  // Whether scopes are compiled in; they check this, so the compiler drops them when it's false.
+const bool TRACING = GOOBEREATS_TRACING != 0;
+
+  // Most events each thread keeps
+const int TRACE_BUFFER_EVENTS = 1 << 16;
+
+  // Starts or stops recording events; events already recorded are kept until clearTrace() is called.
+void startTracing();
+void stopTracing();
+void clearTrace();
+
+  // Returns every thread's events as a Chrome trace: {"traceEvents": [...], "displayTimeUnit": "ms"}.
+std::string traceJson();
+
+  // Used by TraceScope: whether events are being recorded, and adds one to the calling thread's buffer.
+extern std::atomic<bool> tracingEnabled;
+void recordTraceEvent(const char* name, const char* argName, long long arg, long long startNanos, long long endNanos);
+
+class TraceScope
+{
+public:
+      // The name (and argName, if there is one) must be string literals, or otherwise outlive the trace; arg is shown
+      // under argName in the event's details (e.g. which leg of a plan the scope is routing).
+    TraceScope(const char* name, const char* argName = nullptr, long long arg = 0)
+     : m_name(name), m_argName(argName), m_arg(arg), m_start(-1)
+    {
+        if (TRACING  &&  tracingEnabled.load(std::memory_order_relaxed))
+            m_start = now();
+    }
+    ~TraceScope()
+    {
+        if (TRACING  &&  m_start >= 0)
+            recordTraceEvent(m_name, m_argName, m_arg, m_start, now());
+    }
+
+      // We prevent a TraceScope object from being copied or assigned.
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+private:
+    const char* m_name;
+    const char* m_argName;
+    long long m_arg;
+    long long m_start;      // when the scope started in nanoseconds, or -1 if it isn't being traced
+
+    static long long now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+};
+
+#endif /* Trace_h */
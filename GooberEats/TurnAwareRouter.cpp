@@ -0,0 +1,327 @@
+#include "provided.h"
+#include "TurnAwareRouter.h"
+#include "StreetGraph.h"
+#include <list>
+#include <vector>
+#include <queue>
+#include <functional>
+#include <utility>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+using namespace std;
+
+/*
+ Per-thread arrays for the search, sized for the biggest graph searched so far. Instead of being cleared, every entry
+ is stamped with the search that last wrote it, so starting a search costs nothing however big the map is.
+ */
+struct EdgeSearchScratch
+{
+    vector<double> cost;
+    vector<int> parent;
+    vector<unsigned int> reached;
+    vector<unsigned int> settled;
+    unsigned int search = 0;
+    
+    void begin(int numEdges)
+    {
+        if (static_cast<int>(cost.size()) < numEdges)
+        {
+            cost.resize(numEdges);
+            parent.resize(numEdges);
+            reached.resize(numEdges, 0);
+            settled.resize(numEdges, 0);
+        }
+        // after four billion searches the stamps wrap around, so the old ones have to be wiped
+        if (++search == 0)
+        {
+            fill(reached.begin(), reached.end(), 0);
+            fill(settled.begin(), settled.end(), 0);
+            search = 1;
+        }
+    }
+};
+
+/*
+ Definition of TurnAwareRouterImpl.
+ */
+class TurnAwareRouterImpl
+{
+public:
+    TurnAwareRouterImpl(const StreetMap* sm, const TurnCosts& costs, const vector<TurnRestriction>& restrictions);
+    ~TurnAwareRouterImpl();
+    DeliveryResult generatePointToPointRoute(
+        const GeoCoord& start,
+        const GeoCoord& end,
+        list<StreetSegment>& route,
+        double& totalDistanceTravelled) const;
+    DeliveryResult generatePointToPointRoute(
+        const GeoCoord& start,
+        const GeoCoord& end,
+        vector<int>& edges,
+        double& totalDistanceTravelled,
+        SearchStats& stats) const;
+    int numRestrictedTurns() const;
+private:
+    const StreetGraph* GRAPH;
+    
+    // cost of every kind of turn, indexed by TurnKind, and whether each of the graph's turns is forbidden (empty if
+    // none are)
+    double m_turnCost[NUM_TURN_KINDS];
+    vector<bool> m_restricted;
+    int m_numRestricted;
+    
+    int findEdge(int from, int to) const;
+    DeliveryResult search(int startNode, int endNode, const GeoCoord& end, const EdgeCosts& costs, vector<int>& edges,
+                          double& totalDistanceTravelled, SearchStats& stats) const;
+};
+
+TurnAwareRouterImpl::TurnAwareRouterImpl(const StreetMap* sm, const TurnCosts& costs,
+                                         const vector<TurnRestriction>& restrictions)
+    : GRAPH(getStreetGraph(sm)), m_numRestricted(0)
+{
+    m_turnCost[static_cast<int>(TurnKind::STRAIGHT)] = costs.straight;
+    m_turnCost[static_cast<int>(TurnKind::SLIGHT_LEFT)] = costs.slight;
+    m_turnCost[static_cast<int>(TurnKind::SLIGHT_RIGHT)] = costs.slight;
+    m_turnCost[static_cast<int>(TurnKind::LEFT)] = costs.left;
+    m_turnCost[static_cast<int>(TurnKind::RIGHT)] = costs.right;
+    m_turnCost[static_cast<int>(TurnKind::SHARP_LEFT)] = costs.sharp;
+    m_turnCost[static_cast<int>(TurnKind::SHARP_RIGHT)] = costs.sharp;
+    m_turnCost[static_cast<int>(TurnKind::U_TURN)] = costs.uTurn;
+    
+    // a restriction forbids the turn between the edge into its via node and the edge out of it
+    if (restrictions.empty())
+        return;
+    m_restricted.assign(GRAPH->numTurns(), false);
+    for (auto it = restrictions.begin(); it != restrictions.end(); ++it)
+    {
+        int into = findEdge(GRAPH->findNode(it->from), GRAPH->findNode(it->via));
+        int outOf = findEdge(GRAPH->findNode(it->via), GRAPH->findNode(it->to));
+        if (into == -1  ||  outOf == -1  ||  m_restricted[GRAPH->turnId(into, outOf)])
+            continue;
+        m_restricted[GRAPH->turnId(into, outOf)] = true;
+        ++m_numRestricted;
+    }
+}
+
+TurnAwareRouterImpl::~TurnAwareRouterImpl()
+{
+}
+
+/*
+ Times the search and adds its stats to this thread's histograms; routes between components that can't reach each
+ other are turned down without one. The search keeps the costs that were latest when it started, even if new ones
+ are published while it runs.
+ */
+DeliveryResult TurnAwareRouterImpl::generatePointToPointRoute(
+        const GeoCoord& start,
+        const GeoCoord& end,
+        vector<int>& edges,
+        double& totalDistanceTravelled,
+        SearchStats& stats) const
+{
+    stats = SearchStats();
+    edges.clear();
+    totalDistanceTravelled = 0;
+    int startNode = GRAPH->findNode(start);
+    int endNode = GRAPH->findNode(end);
+    if (startNode == NO_NODE  ||  endNode == NO_NODE)
+        return BAD_COORD;
+    if (startNode == endNode)
+        return DELIVERY_SUCCESS;
+    // no route joins their components, which a search would only find out by exploring everything it can reach
+    if (!GRAPH->mayReach(startNode, endNode))
+        return NO_ROUTE;
+    
+    shared_ptr<const EdgeCosts> costs = GRAPH->costs();
+    if (!SEARCH_STATS)
+        return search(startNode, endNode, end, *costs, edges, totalDistanceTravelled, stats);
+    auto startTime = chrono::steady_clock::now();
+    DeliveryResult result = search(startNode, endNode, end, *costs, edges, totalDistanceTravelled, stats);
+    stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+    recordSearch(SearchKind::TURN_AWARE, stats);
+    return result;
+}
+
+/*
+ Finds a route with A* over edges: the cost of reaching an edge is the cost of the edges driven to its end plus every
+ turn taken on the way, and the heuristic is the crow distance from the edge's end to the destination. Edges never
+ cost less than their length and turn costs are never negative, so the first edge taken off the queue that ends at the
+ destination ends the cheapest route. Closed edges are never taken.
+ */
+DeliveryResult TurnAwareRouterImpl::search(int startNode, int endNode, const GeoCoord& end, const EdgeCosts& costs,
+                                           vector<int>& edges, double& totalDistanceTravelled,
+                                           SearchStats& stats) const
+{
+    static thread_local EdgeSearchScratch scratch;
+    scratch.begin(GRAPH->numEdges());
+    const unsigned int SEARCH = scratch.search;
+    
+    // queue of (cost plus heuristic, edge) with the smallest first; edges can be queued more than once, and all but
+    // their cheapest entry are skipped
+    typedef pair<double, int> QueueEntry;
+    priority_queue<QueueEntry, vector<QueueEntry>, greater<QueueEntry>> open;
+    for (int edge = GRAPH->firstEdge(startNode); edge != GRAPH->endEdge(startNode); ++edge)
+    {
+        double cost = costs.edgeCost[edge];
+        if (cost == CLOSED_COST)
+            continue;
+        if (scratch.reached[edge] == SEARCH  &&  scratch.cost[edge] <= cost)
+            continue;
+        scratch.reached[edge] = SEARCH;
+        scratch.cost[edge] = cost;
+        scratch.parent[edge] = -1;
+        open.push(QueueEntry(cost + distanceEarthMiles(GRAPH->coord(GRAPH->edgeTo(edge)), end), edge));
+        if (SEARCH_STATS)
+        {
+            ++stats.edgesRelaxed;
+            ++stats.heapPushes;
+        }
+    }
+    if (SEARCH_STATS)
+        stats.peakQueueSize = open.size();
+    
+    int last = -1;
+    while (!open.empty())
+    {
+        int edge = open.top().second;
+        open.pop();
+        if (SEARCH_STATS)
+            ++stats.heapPops;
+        if (scratch.settled[edge] == SEARCH)
+        {
+            if (SEARCH_STATS)
+                ++stats.duplicatePops;
+            continue;
+        }
+        scratch.settled[edge] = SEARCH;
+        if (SEARCH_STATS)
+            ++stats.nodesSettled;
+        int node = GRAPH->edgeTo(edge);
+        if (node == endNode)
+        {
+            last = edge;
+            break;
+        }
+        
+        // every edge leaving the node is one turn away; its turns are numbered in the same order as the edges
+        int turn = GRAPH->firstTurn(edge);
+        for (int next = GRAPH->firstEdge(node); next != GRAPH->endEdge(node); ++next, ++turn)
+        {
+            if (scratch.settled[next] == SEARCH  ||  (!m_restricted.empty()  &&  m_restricted[turn])  ||
+                costs.edgeCost[next] == CLOSED_COST)
+                continue;
+            double cost = scratch.cost[edge] + m_turnCost[static_cast<int>(GRAPH->turnKind(turn))] +
+                          costs.edgeCost[next];
+            if (scratch.reached[next] == SEARCH  &&  scratch.cost[next] <= cost)
+                continue;
+            scratch.reached[next] = SEARCH;
+            scratch.cost[next] = cost;
+            scratch.parent[next] = edge;
+            open.push(QueueEntry(cost + distanceEarthMiles(GRAPH->coord(GRAPH->edgeTo(next)), end), next));
+            if (SEARCH_STATS)
+            {
+                ++stats.edgesRelaxed;
+                ++stats.heapPushes;
+                stats.peakQueueSize = max(stats.peakQueueSize, static_cast<long long>(open.size()));
+            }
+        }
+    }
+    if (last == -1)
+        return NO_ROUTE;
+    
+    // walk back from the last edge, then put the edges in driving order
+    for (int edge = last; edge != -1; edge = scratch.parent[edge])
+    {
+        edges.push_back(edge);
+        totalDistanceTravelled += GRAPH->edgeMiles(edge);
+    }
+    reverse(edges.begin(), edges.end());
+    return DELIVERY_SUCCESS;
+}
+
+/*
+ Finds a route exactly like the edge version does and builds the StreetSegments it's made of.
+ */
+DeliveryResult TurnAwareRouterImpl::generatePointToPointRoute(
+        const GeoCoord& start,
+        const GeoCoord& end,
+        list<StreetSegment>& route,
+        double& totalDistanceTravelled) const
+{
+    route.clear();
+    vector<int> edges;
+    SearchStats stats;
+    DeliveryResult result = generatePointToPointRoute(start, end, edges, totalDistanceTravelled, stats);
+    for (auto it = edges.begin(); it != edges.end(); ++it)
+        route.push_back(GRAPH->segment(*it));
+    return result;
+}
+
+int TurnAwareRouterImpl::numRestrictedTurns() const
+{
+    return m_numRestricted;
+}
+
+/*
+ Returns the edge from one node to another, or -1 if there isn't one (or either node is missing).
+ */
+int TurnAwareRouterImpl::findEdge(int from, int to) const
+{
+    if (from == NO_NODE  ||  to == NO_NODE)
+        return -1;
+    for (int edge = GRAPH->firstEdge(from); edge != GRAPH->endEdge(from); ++edge)
+    {
+        if (GRAPH->edgeTo(edge) == to)
+            return edge;
+    }
+    return -1;
+}
+
+//******************** TurnAwareRouter functions ******************************
+
+// These functions simply delegate to TurnAwareRouterImpl's functions.
+
+TurnAwareRouter::TurnAwareRouter(const StreetMap* sm, const TurnCosts& costs, const vector<TurnRestriction>& restrictions)
+{
+    m_impl = new TurnAwareRouterImpl(sm, costs, restrictions);
+}
+
+TurnAwareRouter::~TurnAwareRouter()
+{
+    delete m_impl;
+}
+
+DeliveryResult TurnAwareRouter::generatePointToPointRoute(
+        const GeoCoord& start,
+        const GeoCoord& end,
+        list<StreetSegment>& route,
+        double& totalDistanceTravelled) const
+{
+    return m_impl->generatePointToPointRoute(start, end, route, totalDistanceTravelled);
+}
+
+DeliveryResult TurnAwareRouter::generatePointToPointRoute(
+        const GeoCoord& start,
+        const GeoCoord& end,
+        vector<int>& edges,
+        double& totalDistanceTravelled) const
+{
+    SearchStats stats;
+    return m_impl->generatePointToPointRoute(start, end, edges, totalDistanceTravelled, stats);
+}
+
+DeliveryResult TurnAwareRouter::generatePointToPointRoute(
+        const GeoCoord& start,
+        const GeoCoord& end,
+        vector<int>& edges,
+        double& totalDistanceTravelled,
+        SearchStats& stats) const
+{
+    return m_impl->generatePointToPointRoute(start, end, edges, totalDistanceTravelled, stats);
+}
+
+int TurnAwareRouter::numRestrictedTurns() const
+{
+    return m_impl->numRestrictedTurns();
+}
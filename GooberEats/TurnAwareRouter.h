@@ -0,0 +1,85 @@
+#ifndef TurnAwareRouter_h
+#define TurnAwareRouter_h
+
+#include "provided.h"
+#include "SearchStats.h"
+#include <list>
+#include <vector>
+
+// TurnAwareRouter.h
+
+// Routes between two coordinates like PointToPointRouter does, except that turns cost something. The search runs over
+// the map's edges instead of its coordinates (an edge-based, or line-graph, search), so the cost of turning from one
+// edge onto the next is part of every path it compares, and routes stop zig-zagging through street grids to save a few
+// feet. The kind of every turn is worked out once when the map is loaded (see StreetGraph.h); a router only keeps a
+// table of what each kind costs and one bit per turn for the turns it isn't allowed to make.
+
+struct TurnCosts
+{
+      // Reasonable penalties: right turns cost about 100 feet of driving, left turns (across traffic) twice that, and
+      // U-turns a fifth of a mile.
+    TurnCosts()
+     : straight(0), slight(0.005), right(0.02), left(0.04), sharp(0.06), uTurn(0.2)
+    {}
+
+    // Miles of driving each kind of turn is treated as costing
+    double straight;
+    double slight;
+    double right;
+    double left;
+    double sharp;
+    double uTurn;
+};
+
+  // Forbids driving from "from" to "via" and then straight on to "to"; all three are ends of segments on the map.
+struct TurnRestriction
+{
+    GeoCoord from;
+    GeoCoord via;
+    GeoCoord to;
+};
+
+class TurnAwareRouterImpl;
+
+class TurnAwareRouter
+{
+public:
+      // The map must already be loaded; restrictions that don't match a turn on the map are ignored.
+    TurnAwareRouter(const StreetMap* sm,
+                    const TurnCosts& costs = TurnCosts(),
+                    const std::vector<TurnRestriction>& restrictions = std::vector<TurnRestriction>());
+    ~TurnAwareRouter();
+
+      // Finds the route with the smallest distance plus turn costs. totalDistanceTravelled is only the distance.
+    DeliveryResult generatePointToPointRoute(
+        const GeoCoord& start,
+        const GeoCoord& end,
+        std::list<StreetSegment>& route,
+        double& totalDistanceTravelled) const;
+
+      // Same as above, but gives the route as the ids of its edges in the map's StreetGraph (see StreetGraph.h).
+    DeliveryResult generatePointToPointRoute(
+        const GeoCoord& start,
+        const GeoCoord& end,
+        std::vector<int>& edges,
+        double& totalDistanceTravelled) const;
+
+      // The same, also filling in stats with the work the search did (see SearchStats.h).
+    DeliveryResult generatePointToPointRoute(
+        const GeoCoord& start,
+        const GeoCoord& end,
+        std::vector<int>& edges,
+        double& totalDistanceTravelled,
+        SearchStats& stats) const;
+
+      // Returns how many of the restrictions matched a turn on the map.
+    int numRestrictedTurns() const;
+
+      // We prevent a TurnAwareRouter object from being copied or assigned.
+    TurnAwareRouter(const TurnAwareRouter&) = delete;
+    TurnAwareRouter& operator=(const TurnAwareRouter&) = delete;
+private:
+    TurnAwareRouterImpl* m_impl;
+};
+
+#endif /* TurnAwareRouter_h */
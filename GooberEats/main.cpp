@@ -1,22 +1,134 @@
 #include "provided.h"
+#include "CompactPlan.h"
+#include "RouteServer.h"
+#include "PlanStreamWriter.h"
+#include "DeliveryLoader.h"
+#include "TurnAwareRouter.h"
+#include "SearchStats.h"
+#include "Trace.h"
+#include "MemoryUsage.h"
+#include "StreetGraph.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <string>
 #include <vector>
+#include <algorithm>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdlib>
+#include <cctype>
+#include <dirent.h>
+#include <sys/stat.h>
 using namespace std;
 
-bool loadDeliveryRequests(string deliveriesFile, GeoCoord& depot, vector<DeliveryRequest>& v);
-bool parseDelivery(string line, string& lat, string& lon, string& item);
+bool loadDeliveryRequests(const DeliveryLoader& loader, string deliveriesFile, GeoCoord& depot, vector<DeliveryRequest>& v,
+                          bool& onMap, ostream& out);
+bool writeDeliveryPlan(const CompactDeliveryPlanner& dp, const DeliveryLoader& loader, string deliveriesFile, int format,
+                       const GeometryOptions& geometry, ostream& out, ostream& errors);
+bool listBatchJobs(string jobsSource, vector<string>& jobs);
+bool loadTurnRestrictions(string restrictionsFile, vector<TurnRestriction>& restrictions);
+bool writeTraceFile(string traceFile);
+int runBatch(const CompactDeliveryPlanner& dp, const DeliveryLoader& loader, const vector<string>& jobs, int numThreads,
+             int format, const GeometryOptions& geometry, ostream& out);
+
+// Ways a plan can be written out; the structured formats are described in PlanStreamWriter.h
+const int TEXT_FORMAT = 0;
+const int NDJSON_FORMAT = 1;
+const int BINARY_FORMAT = 2;
 
 int main(int argc, char *argv[])
 {
-    if (argc != 3)
+    // the map comes first, then a deliveries file or a mode with its source, then options in any order
+    string mode;
+    string target;
+    int numThreads = static_cast<int>(thread::hardware_concurrency());
+    int format = TEXT_FORMAT;
+    string outputFile;
+    bool turnCosts = false;
+    string restrictionsFile;
+    GeometryOptions geometry;
+    size_t depotCacheBytes = 0;
+    string searchStatsFormat;
+    string traceFile;
+    bool memoryReport = false;
+    bool componentReport = false;
+    bool valid = argc >= 3;
+    for (int i = 2; i < argc  &&  valid; ++i)
+    {
+        string arg = argv[i];
+        if ((arg == "--batch"  ||  arg == "--serve")  &&  i + 1 < argc  &&  target.empty())
+        {
+            mode = arg;
+            target = argv[++i];
+            if (i + 1 < argc  &&  isdigit(argv[i + 1][0]))
+                numThreads = atoi(argv[++i]);
+        }
+        else if (arg == "--format"  &&  i + 1 < argc)
+        {
+            string name = argv[++i];
+            format = name == "text" ? TEXT_FORMAT : name == "ndjson" ? NDJSON_FORMAT : name == "binary" ? BINARY_FORMAT : -1;
+            valid = format >= 0;
+        }
+        else if (arg == "--output"  &&  i + 1 < argc)
+            outputFile = argv[++i];
+        else if (arg == "--simplify"  &&  i + 1 < argc)
+        {
+            geometry.simplify = true;
+            geometry.toleranceFeet = atof(argv[++i]);
+        }
+        else if (arg == "--polyline")
+            geometry.polyline = true;
+        else if (arg == "--depot-cache"  &&  i + 1 < argc)
+        {
+            depotCacheBytes = static_cast<size_t>(atof(argv[++i]) * 1024 * 1024);
+            valid = depotCacheBytes > 0;
+        }
+        else if (arg == "--search-stats"  &&  i + 1 < argc)
+        {
+            searchStatsFormat = argv[++i];
+            valid = searchStatsFormat == "prometheus"  ||  searchStatsFormat == "json";
+        }
+        else if (arg == "--memory")
+            memoryReport = true;
+        else if (arg == "--components")
+            componentReport = true;
+        else if (arg == "--trace"  &&  i + 1 < argc)
+            traceFile = argv[++i];
+        else if (arg == "--turn-costs")
+            turnCosts = true;
+        else if (arg == "--turn-restrictions"  &&  i + 1 < argc)
+        {
+            turnCosts = true;
+            restrictionsFile = argv[++i];
+        }
+        else if (target.empty()  &&  arg.compare(0, 2, "--") != 0)
+            target = arg;
+        else
+            valid = false;
+    }
+    if (!valid  ||  target.empty())
     {
-        cout << "Usage: " << argv[0] << " mapdata.txt deliveries.txt" << endl;
+        cout << "Usage: " << argv[0] << " mapdata.txt deliveries.txt [options]" << endl;
+        cout << "       " << argv[0] << " mapdata.txt --batch manifest.txt|directory|- [threads] [options]" << endl;
+        cout << "       " << argv[0] << " mapdata.txt --serve port|socket-path [threads]" << endl;
+        cout << "Options: --format text|ndjson|binary   --output file   --turn-costs   --turn-restrictions file" << endl;
+        cout << "         --simplify feet   --polyline   (geometry of ndjson and binary plans)" << endl;
+        cout << "         --depot-cache megabytes   (remember routes out of and into depots; on by default when serving)" << endl;
+        cout << "         --search-stats prometheus|json   (histograms of the routers' searches, written to stderr)" << endl;
+        cout << "         --trace file   (time the load and every stage of planning, as a Chrome trace)" << endl;
+        cout << "         --memory   (write what the loaded map takes up to stderr)" << endl;
+        cout << "         --components   (write the sizes of the map's connected components to stderr)" << endl;
         return 1;
     }
 
+    // the trace is written when the program is done, or when the server stops
+    if (!traceFile.empty())
+        startTracing();
     StreetMap sm;
         
     if (!sm.load(argv[1]))
@@ -24,79 +136,320 @@ int main(int argc, char *argv[])
         cout << "Unable to load map data file " << argv[1] << endl;
         return 1;
     }
+    if (memoryReport)
+        getStreetMapMemoryUsage(&sm).write(cerr);
+    if (componentReport)
+        getStreetGraph(&sm)->writeComponents(cerr);
 
-    GeoCoord depot;
-    vector<DeliveryRequest> deliveries;
-    if (!loadDeliveryRequests(argv[2], depot, deliveries))
+    if (mode == "--serve")
     {
-        cout << "Unable to load delivery request file " << argv[2] << endl;
+        RouteServer rs(&sm, depotCacheBytes > 0 ? depotCacheBytes : DEFAULT_DEPOT_CACHE_BYTES);
+        cerr << "Serving requests on " << target << endl;
+        if (!rs.serve(target, max(1, numThreads)))
+        {
+            cout << "Unable to listen on " << target << endl;
+            return 1;
+        }
+        return traceFile.empty()  ||  writeTraceFile(traceFile) ? 0 : 1;
+    }
+
+    ofstream outputStream;
+    if (!outputFile.empty())
+    {
+        outputStream.open(outputFile, ios::out | ios::binary);
+        if (!outputStream)
+        {
+            cout << "Unable to write output file " << outputFile << endl;
+            return 1;
+        }
+    }
+    ostream& out = outputFile.empty() ? cout : outputStream;
+
+    // with turn costs, every leg is routed over the map's edges so turns (and forbidden turns) count against a route
+    vector<TurnRestriction> restrictions;
+    if (!restrictionsFile.empty()  &&  !loadTurnRestrictions(restrictionsFile, restrictions))
+    {
+        cout << "Unable to load turn restriction file " << restrictionsFile << endl;
         return 1;
     }
+    unique_ptr<CompactDeliveryPlanner> planner(turnCosts ? new CompactDeliveryPlanner(&sm, TurnCosts(), restrictions)
+                                                         : new CompactDeliveryPlanner(&sm));
+    if (depotCacheBytes > 0)
+        planner->cacheDepotRoutes(depotCacheBytes);
+    const CompactDeliveryPlanner& dp = *planner;
+    DeliveryLoader loader(&sm);
+    int status;
+    if (mode.empty())
+        status = writeDeliveryPlan(dp, loader, target, format, geometry, out, format == TEXT_FORMAT ? out : cerr) ? 0 : 1;
+    else
+    {
+        vector<string> jobs;
+        if (!listBatchJobs(target, jobs))
+        {
+            cout << "Unable to read batch jobs from " << target << endl;
+            return 1;
+        }
+        status = runBatch(dp, loader, jobs, max(1, numThreads), format, geometry, out);
+    }
 
-    cout << "Generating route...\n\n";
+    // the batch's threads have finished by now, so their searches are all in the totals
+    if (searchStatsFormat == "prometheus")
+        cerr << searchStatsPrometheus();
+    else if (searchStatsFormat == "json")
+        cerr << searchStatsJson() << endl;
+    if (!traceFile.empty()  &&  !writeTraceFile(traceFile))
+        return 1;
+    return status;
+}
 
-    DeliveryPlanner dp(&sm);
-    vector<DeliveryCommand> dcs;
+// Plans the deliveries in one file and writes the plan (or why there isn't one) to out; returns whether a plan was made.
+// Text plans include their own diagnostics; structured plans only hold records, so diagnostics go to errors instead.
+// A file with a coordinate that isn't on the map is turned down without routing anything.
+bool writeDeliveryPlan(const CompactDeliveryPlanner& dp, const DeliveryLoader& loader, string deliveriesFile, int format,
+                       const GeometryOptions& geometry, ostream& out, ostream& errors)
+{
+    GeoCoord depot;
+    vector<DeliveryRequest> deliveries;
+    bool onMap;
+    CompactPlan plan;
     double totalMiles;
-    DeliveryResult result = dp.generateDeliveryPlan(depot, deliveries, dcs, totalMiles);
+    if (format != TEXT_FORMAT)
+    {
+        PlanStreamWriter writer(out, format == NDJSON_FORMAT ? PlanFormat::NDJSON : PlanFormat::BINARY, geometry);
+        if (!loadDeliveryRequests(loader, deliveriesFile, depot, deliveries, onMap, errors))
+        {
+            errors << "Unable to load delivery request file " << deliveriesFile << endl;
+            writer.beginPlan(deliveriesFile, depot, 0);
+            writer.endUnreadablePlan();
+            return false;
+        }
+        writer.beginPlan(deliveriesFile, depot, deliveries.size());
+        if (!onMap)
+        {
+            writer.endPlan(BAD_COORD, 0);
+            return false;
+        }
+        DeliveryResult result = dp.generateDeliveryPlan(depot, deliveries, plan, totalMiles, writer);
+        writer.endPlan(result, result == DELIVERY_SUCCESS ? totalMiles : 0);
+        return result == DELIVERY_SUCCESS;
+    }
+
+    if (!loadDeliveryRequests(loader, deliveriesFile, depot, deliveries, onMap, out))
+    {
+        out << "Unable to load delivery request file " << deliveriesFile << endl;
+        return false;
+    }
+    if (!onMap)
+    {
+        out << "One or more depot or delivery coordinates are invalid." << endl;
+        return false;
+    }
+
+    out << "Generating route...\n\n";
+
+    DeliveryResult result = dp.generateDeliveryPlan(depot, deliveries, plan, totalMiles);
     if (result == BAD_COORD)
     {
-        cout << "One or more depot or delivery coordinates are invalid." << endl;
-        return 1;
+        out << "One or more depot or delivery coordinates are invalid." << endl;
+        return false;
     }
     if (result == NO_ROUTE)
     {
-        cout << "No route can be found to deliver all items." << endl;
-        return 1;
+        out << "No route can be found to deliver all items." << endl;
+        return false;
+    }
+    {
+        PlanTextWriter writer(out);
+        writer.writeText("Starting at the depot...\n");
+        writer.writePlan(plan);
+        writer.writeText("You are back at the depot and your deliveries are done!\n");
     }
-    cout << "Starting at the depot...\n";
-    for (const auto& dc : dcs)
-        cout << dc.description() << endl;
-    cout << "You are back at the depot and your deliveries are done!\n";
-    cout.setf(ios::fixed);
-    cout.precision(2);
-    cout << totalMiles << " miles travelled for all deliveries." << endl;
+    out.setf(ios::fixed);
+    out.precision(2);
+    out << totalMiles << " miles travelled for all deliveries." << endl;
+    return true;
 }
 
-bool loadDeliveryRequests(string deliveriesFile, GeoCoord& depot, vector<DeliveryRequest>& v)
+// Fills jobs with the deliveries files to plan: every line of a manifest file, every file in a directory (in name
+// order), or every line of standard input if the source is "-". Blank lines are skipped.
+bool listBatchJobs(string jobsSource, vector<string>& jobs)
 {
-    ifstream inf(deliveriesFile);
-    if (!inf)
-        return false;
-    string lat;
-    string lon;
-    inf >> lat >> lon;
-    inf.ignore(10000, '\n');
-    depot = GeoCoord(lat, lon);
+    struct stat info;
+    if (jobsSource != "-"  &&  stat(jobsSource.c_str(), &info) == 0  &&  S_ISDIR(info.st_mode))
+    {
+        DIR* dir = opendir(jobsSource.c_str());
+        if (dir == nullptr)
+            return false;
+        for (dirent* entry = readdir(dir); entry != nullptr; entry = readdir(dir))
+        {
+            string path = jobsSource + "/" + entry->d_name;
+            if (stat(path.c_str(), &info) == 0  &&  S_ISREG(info.st_mode))
+                jobs.push_back(path);
+        }
+        closedir(dir);
+        sort(jobs.begin(), jobs.end());
+        return true;
+    }
+
+    ifstream manifest;
+    if (jobsSource != "-")
+    {
+        manifest.open(jobsSource);
+        if (!manifest)
+            return false;
+    }
+    istream& in = jobsSource == "-" ? cin : manifest;
     string line;
-    while (getline(inf, line))
+    while (getline(in, line))
     {
-        string item;
-        if (parseDelivery(line, lat, lon, item))
-            v.push_back(DeliveryRequest(item, GeoCoord(lat, lon)));
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+        if (!line.empty())
+            jobs.push_back(line);
     }
     return true;
 }
 
-bool parseDelivery(string line, string& lat, string& lon, string& item)
+// Plans every job on a pool of threads sharing one planner (and the map it was made with), writing each job's output
+// to out in the order the jobs were listed as soon as it and every job before it are done. Each job's output is
+// followed by a line saying how it went and how long it took (on cerr for structured formats); a summary goes to cerr
+// at the end. Returns 0 if every job was planned.
+int runBatch(const CompactDeliveryPlanner& dp, const DeliveryLoader& loader, const vector<string>& jobs, int numThreads,
+             int format, const GeometryOptions& geometry, ostream& out)
 {
-    const size_t colon = line.find(':');
-    if (colon == string::npos)
+    const int NUM_JOBS = static_cast<int>(jobs.size());
+    vector<string> outputs(NUM_JOBS);
+    vector<string> diagnostics(NUM_JOBS);
+    vector<double> milliseconds(NUM_JOBS, 0);
+    vector<char> succeeded(NUM_JOBS, false);
+    vector<char> done(NUM_JOBS, false);
+    mutex doneMutex;
+    condition_variable jobDone;
+    atomic<int> nextJob(0);
+    auto startTime = chrono::steady_clock::now();
+
+    // every worker takes the next job nobody has started yet
+    auto planJobs = [&]()
     {
-        cout << "Missing colon in deliveries file line: " << line << endl;
-        return false;
+        for (int j = nextJob++; j < NUM_JOBS; j = nextJob++)
+        {
+            auto jobStart = chrono::steady_clock::now();
+            ostringstream jobOutput;
+            ostringstream jobErrors;
+            bool success = writeDeliveryPlan(dp, loader, jobs[j], format, geometry, jobOutput,
+                                             format == TEXT_FORMAT ? jobOutput : jobErrors);
+            double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - jobStart).count();
+            lock_guard<mutex> lock(doneMutex);
+            outputs[j] = jobOutput.str();
+            diagnostics[j] = jobErrors.str();
+            milliseconds[j] = elapsed;
+            succeeded[j] = success;
+            done[j] = true;
+            jobDone.notify_one();
+        }
+    };
+    vector<thread> workers;
+    for (int i = 0; i < min(numThreads, NUM_JOBS); ++i)
+        workers.push_back(thread(planJobs));
+
+    // write out every job in order, waiting for it if it isn't done yet; structured output holds nothing but plans, so
+    // the lines that frame each job go to cerr instead
+    int numFailed = 0;
+    ostream& status = format == TEXT_FORMAT ? out : cerr;
+    status.setf(ios::fixed);
+    for (int j = 0; j < NUM_JOBS; ++j)
+    {
+        string output;
+        {
+            unique_lock<mutex> lock(doneMutex);
+            jobDone.wait(lock, [&]() { return done[j] != 0; });
+            output.swap(outputs[j]);
+        }
+        if (format == TEXT_FORMAT)
+            out << "=== " << jobs[j] << "\n" << output;
+        else
+        {
+            out << output;
+            cerr << diagnostics[j];
+        }
+        status.precision(1);
+        status << "=== " << jobs[j] << ": " << (succeeded[j] ? "planned" : "failed") << " in " << milliseconds[j] << " ms\n";
+        if (!succeeded[j])
+            ++numFailed;
     }
-    istringstream iss(line.substr(0, colon));
-    if (!(iss >> lat >> lon))
+    out.flush();
+    for (auto it = workers.begin(); it != workers.end(); ++it)
+        it->join();
+
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+    cerr.setf(ios::fixed);
+    cerr.precision(2);
+    cerr << NUM_JOBS << " jobs (" << numFailed << " failed) planned in " << elapsed << " s on " << min(numThreads, NUM_JOBS)
+         << " threads" << endl;
+    DepotCacheStats cache = dp.depotCacheStats();
+    if (cache.maxBytes > 0)
     {
-        cout << "Bad format in deliveries file line: " << line << endl;
-        return false;
+        cerr << "Depot cache: " << cache.depots << " depots in " << cache.bytes / 1024 << " of " << cache.maxBytes / 1024
+             << " KB, " << cache.hits << " legs from trees, " << cache.misses << " searched, trees grown for "
+             << cache.builds << " depots, " << cache.evictions << " evicted" << endl;
     }
-    item = line.substr(colon + 1);
-    if (item.empty())
+    return numFailed == 0 ? 0 : 1;
+}
+
+// Writes every event traced so far to a file that chrome://tracing or Perfetto can open.
+bool writeTraceFile(string traceFile)
+{
+    ofstream outf(traceFile);
+    if (outf)
+        outf << traceJson() << endl;
+    if (!outf)
     {
-        cout << "Missing item in deliveries file line: " << line << endl;
+        cout << "Unable to write trace file " << traceFile << endl;
         return false;
     }
     return true;
 }
+
+// Reads turn restrictions, one per line as the coordinates of the three points of the forbidden turn:
+// "fromLat fromLon viaLat viaLon toLat toLon". Returns false if the file can't be read or a line isn't six numbers.
+bool loadTurnRestrictions(string restrictionsFile, vector<TurnRestriction>& restrictions)
+{
+    ifstream inf(restrictionsFile);
+    if (!inf)
+        return false;
+    string line;
+    while (getline(inf, line))
+    {
+        istringstream iss(line);
+        string text[6];
+        if (!(iss >> text[0]))
+            continue;
+        if (!(iss >> text[1] >> text[2] >> text[3] >> text[4] >> text[5]))
+            return false;
+        try
+        {
+            restrictions.push_back({ GeoCoord(text[0], text[1]), GeoCoord(text[2], text[3]), GeoCoord(text[4], text[5]) });
+        }
+        catch (const exception&)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Loads a deliveries file, describing every line that had to be left out (or has a coordinate that isn't on the map)
+// to out. Returns false if the file couldn't be read; onMap says whether every coordinate in it is on the map.
+bool loadDeliveryRequests(const DeliveryLoader& loader, string deliveriesFile, GeoCoord& depot, vector<DeliveryRequest>& v,
+                          bool& onMap, ostream& out)
+{
+    vector<DeliveryFileError> errors;
+    bool loaded = loader.load(deliveriesFile, depot, v, errors);
+    onMap = true;
+    for (auto it = errors.begin(); it != errors.end(); ++it)
+    {
+        out << problemDescription(it->problem) << " in deliveries file line " << it->line << ": " << it->text << endl;
+        if (it->problem == DeliveryProblem::BAD_COORD)
+            onMap = false;
+    }
+    return loaded;
+}